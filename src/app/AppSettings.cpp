@@ -88,6 +88,7 @@ void AppSettings::load()
     LOAD_DEF(showPythonMatrices, Bool, false);
     LOAD_DEF(skipFuncWindowsLoading, Bool, false);
     LOAD_DEF(useOnlineHelp, Bool, false);
+    LOAD_DEF(pythonTimeoutSec, Int, 60);
 
     s.beginGroup("Debug");
     LOAD_DEF(showProtocolAtStart, Bool, false);
@@ -166,6 +167,7 @@ void AppSettings::save()
     SAVE(showPythonMatrices);
     SAVE(skipFuncWindowsLoading);
     SAVE(useOnlineHelp);
+    SAVE(pythonTimeoutSec);
 
     s.beginGroup("Debug");
     SAVE(showProtocolAtStart);
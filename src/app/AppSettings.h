@@ -64,6 +64,7 @@ public:
     bool showPythonMatrices;     ///< Show Python code for matrices in info function windows.
     bool skipFuncWindowsLoading; ///< Don't load function windows when opening schema.
     bool useOnlineHelp;          ///< Navigate to online help instead of opening Assistant
+    int pythonTimeoutSec;        ///< Interrupt custom Python code running longer than this, 0 means no timeout.
 
     bool layoutExportTransparent; ///< Use transparent background in exported images of layout.
 
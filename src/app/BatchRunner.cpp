@@ -0,0 +1,619 @@
+#include "BatchRunner.h"
+
+#include "AppSettings.h"
+#include "../core/Format.h"
+#include "../core/Protocol.h"
+#include "../core/Schema.h"
+#include "../io/CommonUtils.h"
+#include "../io/JsonUtils.h"
+#include "../io/SchemaReaderJson.h"
+#include "../math/BeamParamsAtElemsFunction.h"
+#include "../math/CausticFunction.h"
+#include "../math/StabilityMapFunction.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSet>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <optional>
+
+namespace {
+
+/// Function arguments given in the command line.
+/// Arguments prefixed with the function alias (e.g. `Caustic.points`) override common ones,
+/// they must be known by the function. Common arguments are given to all functions in a file
+/// and each function takes those it knows, see `unusedArgs()`.
+class BatchArgs
+{
+public:
+    BatchArgs(const QMap<QString, QString>& args, const QString& alias)
+    {
+        const QString prefix = alias + '.';
+        for (auto it = args.cbegin(); it != args.cend(); it++)
+            if (it.key().startsWith(prefix))
+                _own[it.key().mid(prefix.size())] = it.value();
+            else if (!it.key().contains('.'))
+                _common[it.key()] = it.value();
+    }
+
+    std::optional<QString> take(const QString& name)
+    {
+        std::optional<QString> res;
+        if (_common.contains(name))
+            res = _common.take(name);
+        if (_own.contains(name))
+            res = _own.take(name);
+        if (res)
+            _taken << name;
+        return res;
+    }
+
+    QString unknownArgsError() const
+    {
+        if (_own.isEmpty())
+            return QString();
+        return QString("Unknown arguments: %1").arg(_own.keys().join(", "));
+    }
+
+    const QSet<QString>& taken() const { return _taken; }
+
+private:
+    QMap<QString, QString> _own;
+    QMap<QString, QString> _common;
+    QSet<QString> _taken;
+};
+
+/// Returns common arguments that were not taken by any of functions, they are probably misspelled.
+QStringList unusedArgs(const QMap<QString, QString>& args, const QSet<QString>& taken)
+{
+    QStringList res;
+    for (auto it = args.cbegin(); it != args.cend(); it++)
+        if (!it.key().contains('.') && !taken.contains(it.key()))
+            res << it.key();
+    return res;
+}
+
+/// Parses a value with an optional unit, e.g. "100mm" or "1e-3m".
+/// The default unit is used if no unit is given.
+std::optional<Z::Value> parseValue(const QString& str, Z::Unit defaultUnit)
+{
+    QString s = str.trimmed();
+    int i = s.size();
+    while (i > 0 && s.at(i-1).isLetter()) i--;
+    bool ok;
+    double value = s.left(i).trimmed().toDouble(&ok);
+    if (!ok) return {};
+    auto unitStr = s.mid(i);
+    if (unitStr.isEmpty())
+        return Z::Value(value, defaultUnit);
+    auto unit = Z::Units::findByAlias(unitStr);
+    if (!unit || Z::Units::guessDim(unit) != Z::Units::guessDim(defaultUnit))
+        return {};
+    return Z::Value(value, unit);
+}
+
+std::optional<bool> parseBool(const QString& str)
+{
+    if (str == "true" || str == "1") return true;
+    if (str == "false" || str == "0") return false;
+    return {};
+}
+
+QString applyGlobalParams(Schema *schema, const QMap<QString, QString>& params)
+{
+    for (auto it = params.constBegin(); it != params.constEnd(); it++)
+    {
+        auto param = schema->param(it.key());
+        if (!param)
+            return QString("There is no global parameter '%1'").arg(it.key());
+        auto value = parseValue(it.value(), param->value().unit());
+        if (!value)
+            return QString("Invalid value of global parameter '%1': %2").arg(it.key(), it.value());
+        auto res = param->verify(*value);
+        if (!res.isEmpty())
+            return QString("Invalid value of global parameter '%1': %2").arg(it.key(), res);
+        param->setValue(*value);
+    }
+    return QString();
+}
+
+/// Applies arguments of a function variable: element, param, start, stop, step, points.
+/// Caustic has the parameter defined by the element, so it doesn't take the `param` argument.
+QString applyVariableArgs(Z::Variable *var, Schema *schema, BatchArgs& args, bool takeParam)
+{
+    if (auto label = args.take("element"); label)
+    {
+        auto elem = schema->elementByLabel(*label);
+        if (!elem)
+            return QString("There is no element '%1'").arg(*label);
+        if (var->element != elem)
+        {
+            var->element = elem;
+            // Try to keep the same parameter in the new element
+            var->parameter = var->parameter ? elem->param(var->parameter->alias()) : nullptr;
+        }
+    }
+    if (takeParam)
+    {
+        if (auto alias = args.take("param"); alias)
+        {
+            if (!var->element)
+                return QString("Argument 'element' is required for argument 'param'");
+            auto param = var->element->param(*alias);
+            if (!param)
+                return QString("Element '%1' has no parameter '%2'").arg(var->element->displayLabel(), *alias);
+            var->parameter = param;
+        }
+    }
+    Z::Unit unit = var->range.start.unit();
+    if (var->parameter && Z::Units::guessDim(unit) != Z::Units::guessDim(var->parameter->value().unit()))
+        unit = var->parameter->value().unit();
+    for (auto [name, target] : {
+            std::make_pair("start", &var->range.start),
+            std::make_pair("stop", &var->range.stop),
+            std::make_pair("step", &var->range.step) })
+    {
+        auto str = args.take(name);
+        if (!str) continue;
+        auto value = parseValue(*str, unit);
+        if (!value)
+            return QString("Invalid value of argument '%1': %2").arg(name, *str);
+        *target = *value;
+        if (target == &var->range.step)
+            var->range.useStep = true;
+    }
+    if (auto str = args.take("points"); str)
+    {
+        bool ok;
+        int points = str->toInt(&ok);
+        if (!ok || points < 2)
+            return QString("Invalid value of argument 'points': %1").arg(*str);
+        var->range.points = points;
+        var->range.useStep = false;
+    }
+    return QString();
+}
+
+QString csvField(const QString& s)
+{
+    if (!s.contains(',') && !s.contains('"') && !s.contains('\n'))
+        return s;
+    return '"' + QString(s).replace('"', "\"\"") + '"';
+}
+
+QString csvNumber(double v)
+{
+    return QString::number(v, 'g', 16);
+}
+
+void writePlotResults(const PlotFunction& func, BatchRunner::Result& result)
+{
+    QTextStream csv(&result.csv);
+    csv << "plane,segment,x,y\n";
+    for (auto plane : {Z::T, Z::S})
+    {
+        QJsonArray segments;
+        for (int i = 0; i < func.resultCount(plane); i++)
+        {
+            const auto& res = func.result(plane, i);
+            QJsonArray xs, ys;
+            for (int j = 0; j < res.pointsCount(); j++)
+            {
+                double x = res.x().at(j);
+                double y = res.y().at(j);
+                csv << (plane == Z::T ? 'T' : 'S') << ',' << i << ',' << csvNumber(x) << ',' << csvNumber(y) << '\n';
+                xs.append(x);
+                ys.append(y);
+            }
+            segments.append(QJsonObject({{"x", xs}, {"y", ys}}));
+        }
+        result.json[plane == Z::T ? "T" : "S"] = segments;
+    }
+}
+
+void writeTableResults(TableFunction& func, BatchRunner::Result& result)
+{
+    const auto& columns = func.columns();
+    QTextStream csv(&result.csv);
+    csv << "element,position";
+    QJsonArray columnsJson;
+    for (const auto& col : columns)
+    {
+        csv << ',' << csvField(col.label + "_T") << ',' << csvField(col.label + "_S");
+        columnsJson.append(col.label);
+    }
+    csv << '\n';
+
+    QJsonArray rowsJson;
+    for (const auto& res : func.results())
+    {
+        auto label = res.element->displayLabel();
+        auto position = TableFunction::resultPositionInfo(res.position).ascii;
+        csv << csvField(label) << ',' << csvField(position);
+        QJsonArray valuesT, valuesS;
+        for (int i = 0; i < columns.size(); i++)
+        {
+            if (i < res.values.size())
+            {
+                const auto& v = res.values.at(i);
+                csv << ',' << csvNumber(v.T) << ',' << csvNumber(v.S);
+                valuesT.append(v.T);
+                valuesS.append(v.S);
+            }
+            else
+            {
+                csv << ",,";
+                valuesT.append(QJsonValue());
+                valuesS.append(QJsonValue());
+            }
+        }
+        csv << '\n';
+        rowsJson.append(QJsonObject({
+            {"element", label},
+            {"position", position},
+            {"T", valuesT},
+            {"S", valuesS},
+        }));
+    }
+    result.json["columns"] = columnsJson;
+    result.json["rows"] = rowsJson;
+}
+
+QString calcCaustic(Schema *schema, const QJsonObject& json, BatchArgs& args, BatchRunner::Result& result)
+{
+    CausticFunction func(schema);
+    if (!json.isEmpty())
+    {
+        func.setMode(Z::IO::Utils::enumFromStr(json["mode"].toString(), CausticFunction::BeamRadius));
+        auto res = Z::IO::Json::readVariable(json["arg"].toObject(), func.arg(), schema);
+        if (!res.isEmpty()) return res;
+    }
+    if (auto mode = args.take("mode"); mode)
+    {
+        bool ok;
+        int value = QMetaEnum::fromType<CausticFunction::Mode>().keyToValue(mode->toLatin1().data(), &ok);
+        if (!ok) return QString("Invalid value of argument 'mode': %1").arg(*mode);
+        func.setMode(CausticFunction::Mode(value));
+    }
+    auto res = applyVariableArgs(func.arg(), schema, args, false);
+    if (!res.isEmpty()) return res;
+    res = args.unknownArgsError();
+    if (!res.isEmpty()) return res;
+
+    auto range = Z::Utils::asRange(func.arg()->element);
+    if (!range)
+        return QString("Argument 'element' must be a range element");
+    func.arg()->parameter = range->paramLength();
+
+    func.calculate();
+    if (!func.ok()) return func.errorText();
+    writePlotResults(func, result);
+    return QString();
+}
+
+QString calcStabMap(Schema *schema, const QJsonObject& json, BatchArgs& args, BatchRunner::Result& result)
+{
+    StabilityMapFunction func(schema);
+    if (!json.isEmpty())
+    {
+        func.setStabilityCalcMode(Z::IO::Utils::enumFromStr(
+            json["stab_calc_mode"].toString(), Z::Enums::StabilityCalcMode::Normal));
+        auto res = Z::IO::Json::readVariable(json["arg"].toObject(), func.arg(), schema);
+        if (!res.isEmpty()) return res;
+    }
+    if (auto mode = args.take("stab_calc_mode"); mode)
+    {
+        bool ok;
+        int value = QMetaEnum::fromType<Z::Enums::StabilityCalcMode>().keyToValue(mode->toLatin1().data(), &ok);
+        if (!ok) return QString("Invalid value of argument 'stab_calc_mode': %1").arg(*mode);
+        func.setStabilityCalcMode(Z::Enums::StabilityCalcMode(value));
+    }
+    auto res = applyVariableArgs(func.arg(), schema, args, true);
+    if (!res.isEmpty()) return res;
+    res = args.unknownArgsError();
+    if (!res.isEmpty()) return res;
+
+    func.calculate();
+    if (!func.ok()) return func.errorText();
+    writePlotResults(func, result);
+    return QString();
+}
+
+QString calcBeamParamsAtElems(Schema *schema, const QJsonObject& json, BatchArgs& args, BatchRunner::Result& result)
+{
+    BeamParamsAtElemsFunction func(schema);
+    TableFunction::Params params;
+    for (auto [name, target] : {
+            std::make_pair("calcMediumEnds", &params.calcMediumEnds),
+            std::make_pair("calcEmptySpaces", &params.calcEmptySpaces),
+            std::make_pair("calcSpaceMids", &params.calcSpaceMids) })
+    {
+        *target = json[name].toBool(false);
+        if (auto str = args.take(name); str)
+        {
+            auto value = parseBool(*str);
+            if (!value) return QString("Invalid value of argument '%1': %2").arg(name, *str);
+            *target = *value;
+        }
+    }
+    auto res = args.unknownArgsError();
+    if (!res.isEmpty()) return res;
+
+    func.setParams(params);
+    func.calculate();
+    if (!func.ok()) return func.errorText();
+    writeTableResults(func, result);
+    return QString();
+}
+
+typedef QString (*CalcFunc)(Schema*, const QJsonObject&, BatchArgs&, BatchRunner::Result&);
+
+const QMap<QString, CalcFunc>& calcFuncs()
+{
+    static QMap<QString, CalcFunc> funcs {
+        { CausticFunction::_alias_(), calcCaustic },
+        { StabilityMapFunction::_alias_(), calcStabMap },
+        { BeamParamsAtElemsFunction::_alias_(), calcBeamParamsAtElems },
+    };
+    return funcs;
+}
+
+QMap<QString, QString> parseNameValueList(const QStringList& items, QString& error)
+{
+    QMap<QString, QString> res;
+    for (const auto& item : items)
+    {
+        int pos = item.indexOf('=');
+        if (pos < 1)
+        {
+            error = QString("Invalid argument, name=value expected: %1").arg(item);
+            return {};
+        }
+        res[item.left(pos).trimmed()] = item.mid(pos+1).trimmed();
+    }
+    return res;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+//                               BatchRunner
+//------------------------------------------------------------------------------
+
+QStringList BatchRunner::supportedFuncs()
+{
+    return calcFuncs().keys();
+}
+
+QVector<BatchRunner::Result> BatchRunner::processFile(const QString& fileName) const
+{
+    auto fail = [&fileName](const QString& error) {
+        Result result { .fileName = fileName, .error = error };
+        result.json = QJsonObject({{ "file", fileName }, { "error", error }});
+        return QVector<Result>({ result });
+    };
+
+    if (Z::IO::Utils::isOldSchema(fileName))
+        return fail("Old file format is not supported in batch mode, resave the file in the application");
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return fail(QString("Unable to open file for reading: %1").arg(file.errorString()));
+    auto data = file.readAll();
+    file.close();
+
+    Schema schema;
+    SchemaReaderJson reader(&schema);
+    // Function windows can't be created without GUI, their functions are read below
+    reader.skipFuncWindows = true;
+    reader.readFromUtf8(data);
+    if (reader.report().hasErrors())
+        return fail(reader.report().str());
+    schema.setFileName(fileName);
+
+    auto res = applyGlobalParams(&schema, _opts.params);
+    if (!res.isEmpty())
+        return fail(res);
+
+    struct FuncItem
+    {
+        QString alias;
+        QJsonObject json;
+    };
+    QVector<FuncItem> items;
+    const auto windowsJson = QJsonDocument::fromJson(data).object()["windows"].toArray();
+    for (const auto& it : windowsJson)
+    {
+        auto windowJson = it.toObject();
+        auto alias = windowJson["type"].toString();
+        if (!calcFuncs().contains(alias))
+            continue;
+        if (!_opts.funcs.isEmpty() && !_opts.funcs.contains(alias))
+            continue;
+        items << FuncItem{ alias, windowJson["function"].toObject() };
+    }
+    // Requested functions not stored in the file are calculated with given arguments only
+    for (const auto& alias : _opts.funcs)
+        if (!std::any_of(items.cbegin(), items.cend(), [&alias](const FuncItem& item){ return item.alias == alias; }))
+            items << FuncItem{ alias, {} };
+    if (items.isEmpty())
+        return fail("There are no functions to calculate in the file");
+
+    QVector<Result> results;
+    QSet<QString> takenArgs;
+    bool hasErrors = false;
+    for (const auto& item : std::as_const(items))
+    {
+        Result result { .fileName = fileName, .funcAlias = item.alias };
+        result.json["file"] = fileName;
+        result.json["function"] = item.alias;
+        BatchArgs args(_opts.args, item.alias);
+        result.error = calcFuncs()[item.alias](&schema, item.json, args, result);
+        takenArgs.unite(args.taken());
+        if (!result.error.isEmpty())
+        {
+            hasErrors = true;
+            result.csv.clear();
+            result.json = QJsonObject({
+                { "file", fileName },
+                { "function", item.alias },
+                { "error", result.error },
+            });
+        }
+        results << result;
+    }
+    // A function can fail before it takes its arguments, then unused ones are not reliable
+    if (!hasErrors)
+        if (auto unused = unusedArgs(_opts.args, takenArgs); !unused.isEmpty())
+            return fail(QString("Unknown arguments: %1").arg(unused.join(", ")));
+    return results;
+}
+
+int BatchRunner::main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("reZonator");
+    app.setOrganizationName("orion-project.org");
+    app.setApplicationVersion(Z::Strs::appVersion());
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Calculates functions of project files without GUI.");
+    parser.addHelpOption();
+    parser.setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
+    QCommandLineOption optionBatch("batch", "Run in batch mode.");
+    QCommandLineOption optionFunc("func", QString("Function to calculate: %1. Can be given several times. "
+        "All supported functions stored in a project are calculated if omitted.").arg(supportedFuncs().join(", ")), "alias");
+    QCommandLineOption optionArg("arg", "Override a function argument, e.g. points=500. Can be given several times. "
+        "An argument is given to all functions knowing it, prefix it with a function alias to set it "
+        "for that function only, e.g. Caustic.points=500. Arguments are: element, param, start, stop, step, points (Caustic, StabMap), mode (Caustic), stab_calc_mode (StabMap), "
+        "calcMediumEnds, calcEmptySpaces, calcSpaceMids (BeamParamsAtElems).", "name=value");
+    QCommandLineOption optionParam("param", "Override a global parameter, e.g. a=10mm. Can be given several times.", "name=value");
+    QCommandLineOption optionFormat("format", "Result format: csv or json. Default is csv.", "format", "csv");
+    QCommandLineOption optionOutput("output", "Directory for result files. Results are written to stdout if omitted.", "dir");
+    QCommandLineOption optionJobs("jobs", "Number of files calculated in parallel. Default is the number of CPU cores.", "count");
+    parser.addOptions({optionBatch, optionFunc, optionArg, optionParam, optionFormat, optionOutput, optionJobs});
+    parser.addPositionalArgument("files", "Project files to calculate.", "files...");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Options opts;
+    opts.funcs = parser.values(optionFunc);
+    for (const auto& alias : std::as_const(opts.funcs))
+        if (!calcFuncs().contains(alias))
+        {
+            err << "Unsupported function: " << alias << Qt::endl;
+            return 1;
+        }
+    QString error;
+    opts.args = parseNameValueList(parser.values(optionArg), error);
+    for (auto it = opts.args.cbegin(); it != opts.args.cend() && error.isEmpty(); it++)
+        if (int pos = it.key().indexOf('.'); pos >= 0 && !calcFuncs().contains(it.key().left(pos)))
+            error = QString("Unsupported function in argument: %1").arg(it.key());
+    if (error.isEmpty())
+        opts.params = parseNameValueList(parser.values(optionParam), error);
+    if (!error.isEmpty())
+    {
+        err << error << Qt::endl;
+        return 1;
+    }
+    auto format = parser.value(optionFormat).toLower();
+    if (format == "json")
+        opts.format = JSON;
+    else if (format != "csv")
+    {
+        err << "Unsupported format: " << format << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet(optionOutput))
+    {
+        opts.outputDir = parser.value(optionOutput);
+        if (!QDir().mkpath(opts.outputDir))
+        {
+            err << "Unable to create output directory: " << opts.outputDir << Qt::endl;
+            return 1;
+        }
+    }
+    auto files = parser.positionalArguments();
+    if (files.isEmpty())
+    {
+        err << "No project files given" << Qt::endl;
+        return 1;
+    }
+
+    // There is no protocol window, calculation messages would only pollute the output
+    Z::Protocol::isEnabled = false;
+    Z::Protocol::isDebugEnabled = false;
+
+    // Settings are used when reading files, load them before starting worker threads
+    AppSettings::instance();
+
+    BatchRunner runner(opts);
+    QVector<QVector<Result>> results(files.size());
+    auto resultsData = results.data();
+    QThreadPool pool;
+    if (parser.isSet(optionJobs))
+        pool.setMaxThreadCount(qMax(1, parser.value(optionJobs).toInt()));
+    for (int i = 0; i < files.size(); i++)
+        pool.start([&runner, &files, resultsData, i]{ resultsData[i] = runner.processFile(files.at(i)); });
+    pool.waitForDone();
+
+    bool ok = true;
+    QJsonArray allJson;
+    for (int i = 0; i < files.size(); i++)
+    {
+        QMap<QString, int> funcCounts;
+        for (const auto& result : std::as_const(results.at(i)))
+        {
+            if (!result.error.isEmpty())
+            {
+                ok = false;
+                err << result.fileName;
+                if (!result.funcAlias.isEmpty())
+                    err << ": " << result.funcAlias;
+                err << ": " << result.error << Qt::endl;
+                // Errors are only written into results in JSON format
+                if (opts.format == CSV || (result.funcAlias.isEmpty() && !opts.outputDir.isEmpty()))
+                    continue;
+            }
+            if (opts.outputDir.isEmpty())
+            {
+                if (opts.format == JSON)
+                    allJson.append(result.json);
+                else
+                    out << "# " << result.fileName << ": " << result.funcAlias << '\n' << result.csv << '\n';
+                continue;
+            }
+            // Several functions of the same type can be stored in the file
+            int count = ++funcCounts[result.funcAlias];
+            auto outName = QFileInfo(result.fileName).completeBaseName() + '.' + result.funcAlias;
+            if (count > 1)
+                outName += QString("_%1").arg(count);
+            outName = QDir(opts.outputDir).filePath(outName + (opts.format == JSON ? ".json" : ".csv"));
+            QFile outFile(outName);
+            if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+            {
+                ok = false;
+                err << "Unable to open file for writing: " << outName << ": " << outFile.errorString() << Qt::endl;
+                continue;
+            }
+            if (opts.format == JSON)
+                outFile.write(QJsonDocument(result.json).toJson());
+            else
+                outFile.write(result.csv.toUtf8());
+        }
+    }
+    if (opts.outputDir.isEmpty() && opts.format == JSON)
+        out << QJsonDocument(allJson).toJson();
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+    Calculates functions of project files without GUI.
+
+    Functions are taken from windows stored in a project file, so they are calculated
+    with the same arguments as they have been configured in the GUI. Arguments can be
+    overridden and functions not stored in the file can be calculated too if all their
+    required arguments are given. Results are written in CSV or JSON format,
+    all values are in SI units.
+
+    The runner is used by the application started with the `--batch` option, see @a main().
+*/
+class BatchRunner
+{
+public:
+    enum Format { CSV, JSON };
+
+    struct Options
+    {
+        /// Aliases of functions to calculate. All supported functions stored in a file are calculated when empty.
+        QStringList funcs;
+
+        /// Overridden function arguments.
+        /// Arguments prefixed with a function alias (e.g. `Caustic.points`) are only for that function,
+        /// others are for all functions knowing them.
+        QMap<QString, QString> args;
+
+        /// Overridden values of global parameters.
+        QMap<QString, QString> params;
+
+        Format format = CSV;
+
+        /// Directory for result files. Results are written to stdout when empty.
+        QString outputDir;
+    };
+
+    struct Result
+    {
+        QString fileName;
+        QString funcAlias;
+        QString error;
+        QString csv;
+        QJsonObject json;
+    };
+
+    explicit BatchRunner(const Options& opts): _opts(opts) {}
+
+    /// Calculates requested functions of a project file.
+    /// It can be called from several threads simultaneously for different files.
+    QVector<Result> processFile(const QString& fileName) const;
+
+    static QStringList supportedFuncs();
+
+    /// Entry point of the batch mode. It creates its own QCoreApplication and parses command line.
+    static int main(int argc, char* argv[]);
+
+private:
+    Options _opts;
+};
+
+#endif // BATCH_RUNNER_H
@@ -6,6 +6,9 @@
 
 #include <QApplication>
 
+#include <algorithm>
+#include <atomic>
+
 //------------------------------------------------------------------------------
 //                                ElementOwner
 //------------------------------------------------------------------------------
@@ -20,7 +23,8 @@ ElementOwner::~ElementOwner()
 
 Element::Element()
 {
-    static int id = 0;
+    // Schemas can be loaded in parallel, see BatchRunner
+    static std::atomic<int> id = 0;
     _id = ++id;
 }
 
@@ -108,14 +112,39 @@ void Element::calcMatrix(const char *reason)
     Q_UNUSED(reason)
     //qDebug() << "Calc matrix" << type() << displayLabel() << reason;
     calcMatrixInternal();
+    _matrixRevision++;
 }
 
 void Element::calcMatrixInternal()
 {
-    _mt.unity();
-    _ms.unity();
-    _mt_inv.unity();
-    _ms_inv.unity();
+    auto kernel = matrixKernel();
+    if (!kernel.isValid())
+    {
+        _mt.unity();
+        _ms.unity();
+        _mt_inv.unity();
+        _ms_inv.unity();
+        return;
+    }
+    Z::KernelMatrices m;
+    kernel.calcMatrices(kernelParams().constData(), m);
+    assignMatrices(m);
+}
+
+void Element::assignMatrices(const Z::KernelMatrices& m)
+{
+    _mt = m.mt;
+    _ms = m.ms;
+    _mt_inv = m.mt_inv;
+    _ms_inv = m.ms_inv;
+}
+
+Z::KernelParams Element::kernelParams() const
+{
+    Z::KernelParams values(_params.size());
+    for (int i = 0; i < _params.size(); i++)
+        values[i] = _params.at(i)->value().toSi();
+    return values;
 }
 
 void Element::setLabel(const QString& value)
@@ -209,6 +238,24 @@ Z::Value ElementRange::axisLen() const
     return {unit->fromSi(axisLengthSI()), unit};
 }
 
+void ElementRange::calcSubmatrices()
+{
+    auto kernel = matrixKernel();
+    if (!kernel.calcSubmatrices)
+        return;
+    Z::KernelMatrices m;
+    kernel.calcSubmatrices(kernelParams().constData(), _subRangeSI, m);
+    assignSubmatrices(m);
+}
+
+void ElementRange::assignSubmatrices(const Z::KernelMatrices& m)
+{
+    _mt1 = m.mt1;
+    _ms1 = m.ms1;
+    _mt2 = m.mt2;
+    _ms2 = m.ms2;
+}
+
 //------------------------------------------------------------------------------
 //                            ElementInterface
 //------------------------------------------------------------------------------
@@ -266,7 +313,9 @@ ElementEventsLocker::ElementEventsLocker(Element* elem, const char *reason): _re
 
 ElementEventsLocker::ElementEventsLocker(Z::Parameter* param, const char *reason): _reason(reason)
 {
-    collectElems(param);
+    _elems = Z::Utils::dependentElements(param);
+    for (auto elem : std::as_const(_elems))
+        elem->_eventsLocked = true;
     //qDebug() << "Lock events" << Z::Utils::displayStr(_elems) << reason;
 }
 
@@ -277,25 +326,100 @@ ElementEventsLocker::~ElementEventsLocker()
         elem->_eventsLocked = false;
 }
 
-void ElementEventsLocker::collectElems(Z::Parameter *param)
+//------------------------------------------------------------------------------
+//                                 ParamSweep
+//------------------------------------------------------------------------------
+
+ParamSweep::ParamSweep(Z::Parameter *param, const char *reason) : _param(param), _reason(reason)
 {
-    for (auto listener : param->listeners()) {
-        if (auto elem = dynamic_cast<Element*>(listener); elem) {
-            _elems << elem;
-            elem->_eventsLocked = true;
+    _backup.emplace(param, reason);
+
+    // Steps are collected in reversed topological order of the dependency graph,
+    // so after reversing each formula goes only once and after all its dependencies,
+    // even if they are reachable from the parameter by different paths
+    QSet<Z::ParameterListener*> visited;
+    collectSteps(param, visited);
+    std::reverse(_steps.begin(), _steps.end());
+}
+
+ParamSweep::~ParamSweep()
+{
+    // Restoring goes with usual notifications, so links and formulas
+    // get the error state corresponding to the original value here
+    _backup.reset();
+
+    for (auto it = _errors.cbegin(); it != _errors.cend(); it++)
+        Z_ERROR(QString("Param sweep %1: Unable to set value to '%2': %3").arg(_reason, it.key()->alias(), it.value()))
+}
+
+void ParamSweep::collectSteps(Z::Parameter *param, QSet<Z::ParameterListener*> &visited)
+{
+    for (auto listener : param->listeners())
+    {
+        if (auto elem = dynamic_cast<Element*>(listener); elem)
+        {
+            if (!_elems.contains(elem))
+                _elems << elem;
         }
-        else if (auto link = dynamic_cast<Z::ParamLink*>(listener); link) {
-            for (auto listener : link->target()->listeners())
-                if (auto elem = dynamic_cast<Element*>(listener); elem) {
-                    _elems << elem;
-                    elem->_eventsLocked = true;
-                }
-        } else if (auto formula = dynamic_cast<Z::Formula*>(listener); formula) {
-            collectElems(formula->target());
+        else if (auto link = dynamic_cast<Z::ParamLink*>(listener); link)
+        {
+            if (link->source() != param) continue;
+            if (visited.contains(link)) continue;
+            visited.insert(link);
+            collectSteps(link->target(), visited);
+            _steps << Step { link, nullptr };
+        }
+        else if (auto formula = dynamic_cast<Z::Formula*>(listener); formula)
+        {
+            if (visited.contains(formula)) continue;
+            visited.insert(formula);
+            collectSteps(formula->target(), visited);
+            _steps << Step { nullptr, formula };
         }
     }
 }
 
+void ParamSweep::setValue(const Z::Value& value)
+{
+    Z_PERF_BEGIN("ParamSweep::setValue")
+
+    _param->setRawValue(value);
+
+    for (const auto& step : std::as_const(_steps))
+    {
+        if (step.link)
+        {
+            auto target = step.link->target();
+            auto res = Z::ParamLink::getTargetValue(step.link->source(), target);
+            if (res.ok())
+            {
+                target->setRawValue(res.result());
+                target->setRawError(QString());
+            }
+            else
+            {
+                target->setRawError(res.error());
+                _errors.insert(target, res.error());
+            }
+        }
+        else
+        {
+            step.formula->calculate(false);
+            if (!step.formula->ok())
+                _errors.insert(step.formula->target(), step.formula->error());
+        }
+    }
+
+    // Locked matrices are recalculated once when the lock is released, as in Element::parameterChanged()
+    for (auto elem : std::as_const(_elems))
+        if (elem->_calcMatrixLocked)
+            elem->_calcMatrixNeeded = true;
+        else
+            elem->calcMatrix(_reason);
+
+    Z_PERF_END
+}
+
 //------------------------------------------------------------------------------
 //                                ElementParamsBackup
 //------------------------------------------------------------------------------
@@ -319,6 +443,29 @@ ElementParamsBackup::~ElementParamsBackup()
 namespace Z {
 namespace Utils {
 
+static void collectDependentElements(Z::Parameter *param, Elements& elems)
+{
+    for (auto listener : param->listeners()) {
+        if (auto elem = dynamic_cast<Element*>(listener); elem) {
+            elems << elem;
+        }
+        else if (auto link = dynamic_cast<Z::ParamLink*>(listener); link) {
+            for (auto listener : link->target()->listeners())
+                if (auto elem = dynamic_cast<Element*>(listener); elem)
+                    elems << elem;
+        } else if (auto formula = dynamic_cast<Z::Formula*>(listener); formula) {
+            collectDependentElements(formula->target(), elems);
+        }
+    }
+}
+
+Elements dependentElements(Z::Parameter* param)
+{
+    Elements elems;
+    collectDependentElements(param, elems);
+    return elems;
+}
+
 void setElemWavelen(Element* elem, const Z::Value& lambda)
 {
     QString paramName = QStringLiteral("Lambda");
@@ -6,7 +6,10 @@
 
 #include <optional>
 
+#include <QMap>
+#include <QSet>
 #include <QSize>
+#include <QVarLengthArray>
 
 #define DECLARE_ELEMENT(class_name, base_class)\
     class class_name : public base_class\
@@ -39,9 +42,62 @@
 #define AXIS_LEN\
     double axisLengthSI() const override;
 
+#define MATRIX_KERNEL\
+    static void calcMatrixKernel(const double* p, Z::KernelMatrices& m);\
+    Z::MatrixKernel matrixKernel() const override { return { &calcMatrixKernel, nullptr }; }
+
+#define MATRIX_KERNEL_SUB_RANGE\
+    static void calcMatrixKernel(const double* p, Z::KernelMatrices& m);\
+    static void calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m);\
+    Z::MatrixKernel matrixKernel() const override { return { &calcMatrixKernel, &calcSubmatricesKernel }; }
+
 class Element;
 class PumpCalculator;
 
+namespace Z {
+
+class Formula;
+
+/// Matrices produced by a stateless element kernel, see MatrixKernel.
+struct KernelMatrices
+{
+    Matrix mt, ms, mt_inv, ms_inv;
+
+    /// Matrices of the left and right parts of a range element
+    /// split at some point inside the element, see ElementRange::setSubRangeSI().
+    Matrix mt1, ms1, mt2, ms2;
+
+    /// Value that is expensive to derive from parameters, e.g. the solved IOR gradient.
+    /// It's set by MatrixKernel::calcMatrices and reused by MatrixKernel::calcSubmatrices,
+    /// so a caller should keep it between calls until parameters of the element change.
+    std::optional<double> derived;
+};
+
+/**
+    Pure function calculating matrices of an element type.
+
+    Kernels take SI values of element parameters in the same order as they are
+    in Element::params() and don't touch any element object, so they can be called
+    from any thread without making a copy of the schema.
+    Range elements also provide a function for calculating sub-range matrices.
+*/
+struct MatrixKernel
+{
+    typedef void (*CalcMatrices)(const double* params, KernelMatrices& m);
+    typedef void (*CalcSubmatrices)(const double* params, double subRangeSI, KernelMatrices& m);
+
+    CalcMatrices calcMatrices = nullptr;
+    CalcSubmatrices calcSubmatrices = nullptr;
+
+    bool isValid() const { return calcMatrices; }
+};
+
+/// SI values of element parameters as they are passed to MatrixKernel.
+/// Built-in elements have not more than 8 parameters so this doesn't allocate.
+typedef QVarLengthArray<double, 8> KernelParams;
+
+} // namespace Z
+
 //------------------------------------------------------------------------------
 /**
     Base class for objects who wish to own optical elements.
@@ -180,6 +236,18 @@ public:
 
     void calcMatrix(const char* reason);
 
+    /// Returns the stateless matrix kernel of the element type.
+    /// The kernel is invalid for elements whose matrices can't be calculated
+    /// from parameter values only, e.g. for dynamic or formula elements.
+    virtual Z::MatrixKernel matrixKernel() const { return {}; }
+
+    /// Returns SI values of element parameters in the order expected by the matrix kernel.
+    Z::KernelParams kernelParams() const;
+
+    /// The number is increased every time when element matrices are recalculated.
+    /// Calculators can use it to check if their cached products of matrices are still valid.
+    int matrixRevision() const { return _matrixRevision; }
+
     const Z::Matrix& Mt() const { return _mt; }
     const Z::Matrix& Ms() const { return _ms; }
     const Z::Matrix* pMt() const { return &_mt; }
@@ -213,15 +281,21 @@ protected:
     bool _disabled = false;
     Z::Parameters _params;
     int _options = 0;
+    int _matrixRevision = 0;
 
+    /// Default implementation calculates matrices using the element's kernel
+    /// or sets them to unity if there is no kernel.
     virtual void calcMatrixInternal();
 
+    void assignMatrices(const Z::KernelMatrices& m);
+
     void parameterChanged(Z::ParameterBase*) override;
     void parameterFailed(Z::ParameterBase*) override;
 
     bool _calcMatrixLocked = false;
     bool _calcMatrixNeeded = false;
     friend class ElementMatrixLocker;
+    friend class ParamSweep;
 
     int _eventsLocked = false;
     friend class ElementEventsLocker;
@@ -243,7 +317,7 @@ Q_DECLARE_METATYPE(Element*);
 class ElementRange : public Element
 {
 public:
-    void setSubRangeSI(double value) { _subRangeSI = value; calcSubmatrices(); }
+    void setSubRangeSI(double value) { _subRangeSI = value; calcSubmatrices(); _matrixRevision++; }
     void setSubRange(const Z::Value& value);
     double subRangeSI() const { return _subRangeSI; }
     Z::Value subRangeLf() const;
@@ -287,7 +361,10 @@ protected:
     Z::Parameter *_ior;
     double _subRangeSI;
 
-    virtual void calcSubmatrices() {}
+    /// Default implementation calculates sub-range matrices using the element's kernel.
+    virtual void calcSubmatrices();
+
+    void assignSubmatrices(const Z::KernelMatrices& m);
 };
 
 //------------------------------------------------------------------------------
@@ -364,8 +441,52 @@ public:
 private:
     Elements _elems;
     const char *_reason;
+};
+
+//------------------------------------------------------------------------------
+/**
+    Sweep mode for varying a parameter many times in a row, e.g. when plotting a function.
+
+    New values are assigned without notifying parameter listeners, they are propagated
+    through parameter links and formulas directly, and only matrices of dependent elements
+    are recalculated. The original value is restored in destructor via regular setValue(),
+    so listeners (including UI ones) receive the single notification when the sweep ends.
+
+    Links and formulas are collected once in constructor,
+    they must not be changed while the sweep exists.
+
+    Errors of links and formulas are not notified either, they are marked in target
+    parameters silently and collected to be reported after the original value is restored.
+*/
+class ParamSweep
+{
+public:
+    ParamSweep(Z::Parameter *param, const char *reason);
+    ~ParamSweep();
 
-    void collectElems(Z::Parameter *param);
+    void setValue(const Z::Value& value);
+
+    /// Returns elements whose matrices are recalculated when the parameter changes.
+    const Elements& elems() const { return _elems; }
+
+    /// Returns errors occurred in dependent parameters during the sweep, the last one per parameter.
+    const QMap<Z::Parameter*, QString>& errors() const { return _errors; }
+
+private:
+    struct Step
+    {
+        Z::ParamLink *link;
+        Z::Formula *formula;
+    };
+
+    Z::Parameter *_param;
+    std::optional<Z::ParamValueBackup> _backup;
+    QVector<Step> _steps;
+    Elements _elems;
+    QMap<Z::Parameter*, QString> _errors;
+    const char *_reason;
+
+    void collectSteps(Z::Parameter *param, QSet<Z::ParameterListener*> &visited);
 };
 
 //------------------------------------------------------------------------------
@@ -421,6 +542,11 @@ inline ElementInterface* asInterface(Element *elem) { return dynamic_cast<Elemen
 
 void setElemWavelen(Element* elem, const Z::Value& lambda);
 
+/// Returns elements whose matrices depend on the parameter.
+/// These are elements owning the parameter or its link targets,
+/// or elements whose parameters are calculated by formulas involving the parameter.
+Elements dependentElements(Z::Parameter* param);
+
 /// Gives a filter of parameters for regular users' usage.
 /// These are parameters that can be edited in Element properties dialog,
 /// or they can be selected as functions' arguments.
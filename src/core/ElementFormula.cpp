@@ -5,7 +5,20 @@
 
 #include <QApplication>
 
-ElemFormula::ElemFormula()
+namespace {
+
+// Names of matrix elements, see ElemFormula::getResult()
+const QStringList& resultNames()
+{
+    static QStringList names {"A", "B", "C", "D", "At", "Bt", "Ct", "Dt", "As", "Bs", "Cs", "Ds"};
+    return names;
+}
+
+enum { RESULT_A = 0, RESULT_AT = 4, RESULT_AS = 8 };
+
+} // namespace
+
+ElemFormula::ElemFormula() : _codeRef(Z::Lua::NO_REF)
 {
 }
 
@@ -18,6 +31,9 @@ bool ElemFormula::reopenLua()
 {
     if (_lua) delete _lua;
 
+    _codeRef = Z::Lua::NO_REF;
+    _resultRefs.clear();
+
     _lua = new Z::Lua;
     _error = _lua->open();
     if (!_error.isEmpty())
@@ -26,6 +42,10 @@ bool ElemFormula::reopenLua()
         _lua = nullptr;
         return false;
     }
+
+    // Result names are resolved only once, they are the same for any formula
+    for (const auto& name : resultNames())
+        _resultRefs << _lua->nameRef(name);
     return true;
 }
 
@@ -37,6 +57,34 @@ void ElemFormula::reset()
         _lua->removeGlobalVar(var);
 }
 
+void ElemFormula::setFormula(const QString& formula)
+{
+    if (formula == _formula) return;
+
+    _formula = formula;
+    releaseCode();
+}
+
+bool ElemFormula::compile()
+{
+    auto res = _lua->compile(_formula);
+    if (!res.ok())
+    {
+        _error = res.error();
+        return false;
+    }
+    _codeRef = res.value();
+    return true;
+}
+
+void ElemFormula::releaseCode()
+{
+    if (_codeRef == Z::Lua::NO_REF) return;
+
+    if (_lua) _lua->release(_codeRef);
+    _codeRef = Z::Lua::NO_REF;
+}
+
 void ElemFormula::calcMatrixInternal()
 {
     if (_formula.isEmpty())
@@ -52,17 +100,18 @@ void ElemFormula::calcMatrixInternal()
         return;
     }
 
-    for (auto param : _params)
-        _lua->setGlobalVar(param->alias(), param->value().toSi());
-
-    _error = _lua->setCode(_formula);
-    if (!_error.isEmpty())
+    // The code is parsed only when the formula changes,
+    // only parameter values are passed into it on each recalculation
+    if (_codeRef == Z::Lua::NO_REF && !compile())
     {
         setUnity();
         return;
     }
 
-    _error = _lua->execute();
+    for (auto param : _params)
+        _lua->setGlobalVar(_lua->nameRef(param->alias()), param->value().toSi());
+
+    _error = _lua->run(_codeRef);
     if (!_error.isEmpty())
     {
         setUnity();
@@ -71,40 +120,40 @@ void ElemFormula::calcMatrixInternal()
 
     double A, B, C, D;
 
-    auto results = _lua->getGlobalVars();
     if (_hasMatricesTS)
     {
-        if (!getResult(results, QStringLiteral("At"), A)) return;
-        if (!getResult(results, QStringLiteral("Bt"), B)) return;
-        if (!getResult(results, QStringLiteral("Ct"), C)) return;
-        if (!getResult(results, QStringLiteral("Dt"), D)) return;
+        if (!getResult(RESULT_AT+0, A)) return;
+        if (!getResult(RESULT_AT+1, B)) return;
+        if (!getResult(RESULT_AT+2, C)) return;
+        if (!getResult(RESULT_AT+3, D)) return;
         _mt.assign(A, B, C, D);
-        if (!getResult(results, QStringLiteral("As"), A)) return;
-        if (!getResult(results, QStringLiteral("Bs"), B)) return;
-        if (!getResult(results, QStringLiteral("Cs"), C)) return;
-        if (!getResult(results, QStringLiteral("Ds"), D)) return;
+        if (!getResult(RESULT_AS+0, A)) return;
+        if (!getResult(RESULT_AS+1, B)) return;
+        if (!getResult(RESULT_AS+2, C)) return;
+        if (!getResult(RESULT_AS+3, D)) return;
         _ms.assign(A, B, C, D);
     }
     else
     {
-        if (!getResult(results, QStringLiteral("A"), A)) return;
-        if (!getResult(results, QStringLiteral("B"), B)) return;
-        if (!getResult(results, QStringLiteral("C"), C)) return;
-        if (!getResult(results, QStringLiteral("D"), D)) return;
+        if (!getResult(RESULT_A+0, A)) return;
+        if (!getResult(RESULT_A+1, B)) return;
+        if (!getResult(RESULT_A+2, C)) return;
+        if (!getResult(RESULT_A+3, D)) return;
         _mt.assign(A, B, C, D);
         _ms.assign(A, B, C, D);
     }
 }
 
-bool ElemFormula::getResult(const QMap<QString, double>& results, const QString& name, double& result)
+bool ElemFormula::getResult(int index, double& result)
 {
-    if (!results.contains(name))
+    auto value = _lua->getGlobalVar(_resultRefs.at(index));
+    if (!value)
     {
-        _error = qApp->translate("ElemFormula", "Formula doesn't contain an expression for '%1' or it is not a number").arg(name);
+        _error = qApp->translate("ElemFormula", "Formula doesn't contain an expression for '%1' or it is not a number").arg(resultNames().at(index));
         setUnity();
         return false;
     }
-    result = results[name];
+    result = *value;
     return true;
 }
 
@@ -190,6 +239,6 @@ void ElemFormula::assign(const ElemFormula* other)
         paramCopy->setValue(p->value());
         addParam(paramCopy);
     }
-    _formula = other->formula();
+    setFormula(other->formula());
     _hasMatricesTS = other->hasMatricesTS();
 }
@@ -20,7 +20,7 @@ DECLARE_ELEMENT(ElemFormula, Element)
     QString formula() const { return _formula; }
     QString error() const { return _error; }
     bool ok() const { return _error.isEmpty(); }
-    void setFormula(const QString& formula) { _formula = formula; }
+    void setFormula(const QString& formula);
     void addParam(Z::Parameter* param, int index = -1);
     void removeParam(Z::Parameter* param);
     void moveParamUp(Z::Parameter* param);
@@ -32,9 +32,13 @@ private:
     QString _formula;
     QString _error;
     Z::Lua* _lua = nullptr;
+    int _codeRef;
+    QVector<int> _resultRefs;
     bool reopenLua();
+    bool compile();
+    void releaseCode();
     void setUnity();
-    bool getResult(const QMap<QString, double>& results, const QString& name, double& result);
+    bool getResult(int index, double& result);
 DECLARE_ELEMENT_END
 
 #endif // ELEMENT_FORMULA_H
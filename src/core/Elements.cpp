@@ -58,26 +58,30 @@ FocalLengthVerifier* globalFocalLengthVerifier()
 //                             ElemEmptyRange
 //------------------------------------------------------------------------------
 
-void ElemEmptyRange::calcMatrixInternal()
+void ElemEmptyRange::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    Z_PERF_BEGIN("ElemEmptyRange::calcMatrixInternal")
+    Z_PERF_BEGIN("ElemEmptyRange::calcMatrixKernel")
 
-    _mt.assign(1, lengthSI(), 0, 1);
-    _ms = _mt;
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    const double L = p[0];
+
+    m.mt.assign(1, L, 0, 1);
+    m.ms = m.mt;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 
     Z_PERF_END
 }
 
-void ElemEmptyRange::calcSubmatrices()
+void ElemEmptyRange::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    Z_PERF_BEGIN("ElemEmptyRange::calcSubmatrices")
+    Z_PERF_BEGIN("ElemEmptyRange::calcSubmatricesKernel")
+
+    const double L = p[0];
 
-    _mt1.assign(1, _subRangeSI, 0, 1);
-    _ms1 = _mt1;
-    _mt2.assign(1, lengthSI() - _subRangeSI, 0, 1);
-    _ms2 = _mt2;
+    m.mt1.assign(1, subRangeSI, 0, 1);
+    m.ms1 = m.mt1;
+    m.mt2.assign(1, L - subRangeSI, 0, 1);
+    m.ms2 = m.mt2;
 
     Z_PERF_END
 }
@@ -91,20 +95,24 @@ ElemMediumRange::ElemMediumRange() : ElementRange()
     _ior->setVisible(true);
 }
 
-void ElemMediumRange::calcMatrixInternal()
+void ElemMediumRange::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.assign(1, lengthSI(), 0, 1);
-    _ms = _mt;
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    const double L = p[0];
+
+    m.mt.assign(1, L, 0, 1);
+    m.ms = m.mt;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemMediumRange::calcSubmatrices()
+void ElemMediumRange::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    _mt1.assign(1, _subRangeSI, 0, 1);
-    _ms1 = _mt1;
-    _mt2.assign(1, lengthSI() - _subRangeSI, 0, 1);
-    _ms2 = _mt2;
+    const double L = p[0];
+
+    m.mt1.assign(1, subRangeSI, 0, 1);
+    m.ms1 = m.mt1;
+    m.mt2.assign(1, L - subRangeSI, 0, 1);
+    m.ms2 = m.mt2;
 }
 
 //------------------------------------------------------------------------------
@@ -116,20 +124,26 @@ ElemPlate::ElemPlate() : ElementRange()
     _ior->setVisible(true);
 }
 
-void ElemPlate::calcMatrixInternal()
+void ElemPlate::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.assign(1, lengthSI() / ior(), 0, 1);
-    _ms = _mt;
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    const double L = p[0];
+    const double n = p[1];
+
+    m.mt.assign(1, L / n, 0, 1);
+    m.ms = m.mt;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemPlate::calcSubmatrices()
+void ElemPlate::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    _mt1.assign(1, _subRangeSI / ior(), 0, 1/ior());
-    _ms1 = _mt1;
-    _mt2.assign(1, lengthSI() - _subRangeSI, 0, ior());
-    _ms2 = _mt2;
+    const double L = p[0];
+    const double n = p[1];
+
+    m.mt1.assign(1, subRangeSI / n, 0, 1/n);
+    m.ms1 = m.mt1;
+    m.mt2.assign(1, L - subRangeSI, 0, n);
+    m.ms2 = m.mt2;
 }
 
 //------------------------------------------------------------------------------
@@ -140,6 +154,15 @@ ElemFlatMirror::ElemFlatMirror() : Element()
 {
 }
 
+void ElemFlatMirror::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
+{
+    Q_UNUSED(p)
+    m.mt.unity();
+    m.ms.unity();
+    m.mt_inv.unity();
+    m.ms_inv.unity();
+}
+
 //------------------------------------------------------------------------------
 //                              ElemCurveMirror
 //------------------------------------------------------------------------------
@@ -164,12 +187,15 @@ ElemCurveMirror::ElemCurveMirror()
     _radius->setVerifier(globalCurvatureRadiusVerifier());
 }
 
-void ElemCurveMirror::calcMatrixInternal()
+void ElemCurveMirror::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.assign(1, 0, -2.0 / radius() / cos(alpha()), 1);
-    _ms.assign(1, 0, -2.0 / radius() * cos(alpha()), 1);
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    const double R = p[0];
+    const double alpha = p[1];
+
+    m.mt.assign(1, 0, -2.0 / R / cos(alpha), 1);
+    m.ms.assign(1, 0, -2.0 / R * cos(alpha), 1);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
@@ -196,36 +222,45 @@ ElemThinLens::ElemThinLens()
     _focus->setVerifier(globalFocalLengthVerifier());
 }
 
-void ElemThinLens::calcMatrixInternal()
+void ElemThinLens::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.assign(1.0, 0.0, -1.0 / focus() / cos(alpha()), 1.0);
-    _ms.assign(1.0, 0.0, -1.0 / focus() * cos(alpha()), 1.0);
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    const double F = p[0];
+    const double alpha = p[1];
+
+    m.mt.assign(1.0, 0.0, -1.0 / F / cos(alpha), 1.0);
+    m.ms.assign(1.0, 0.0, -1.0 / F * cos(alpha), 1.0);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
 //                              ElemCylinderLensT
 //------------------------------------------------------------------------------
 
-void ElemCylinderLensT::calcMatrixInternal()
+void ElemCylinderLensT::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.assign(1.0, 0.0, -1.0 / focus() / cos(alpha()), 1.0);
-    _ms.unity();
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    const double F = p[0];
+    const double alpha = p[1];
+
+    m.mt.assign(1.0, 0.0, -1.0 / F / cos(alpha), 1.0);
+    m.ms.unity();
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
 //                              ElemCylinderLensS
 //------------------------------------------------------------------------------
 
-void ElemCylinderLensS::calcMatrixInternal()
+void ElemCylinderLensS::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.unity();
-    _ms.assign(1.0, 0.0, -1.0 / focus() * cos(alpha()), 1.0);
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    const double F = p[0];
+    const double alpha = p[1];
+
+    m.mt.unity();
+    m.ms.assign(1.0, 0.0, -1.0 / F * cos(alpha), 1.0);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
@@ -245,76 +280,84 @@ ElemTiltedCrystal::ElemTiltedCrystal() : ElementRange()
     addParam(_alpha);
 }
 
-void ElemTiltedCrystal::calcMatrixInternal()
+void ElemTiltedCrystal::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double L = lengthSI();
-    const double a = alpha();
-    const double n = ior();
+    const double L = p[0];
+    const double n = p[1];
+    const double a = p[2];
 
-    _mt.assign(1, L * n * SQR(cos(a)) / (SQR(n) - SQR(sin(a))), 0.0, 1.0);
-    _ms.assign(1, L / n, 0, 1);
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt.assign(1, L * n * SQR(cos(a)) / (SQR(n) - SQR(sin(a))), 0.0, 1.0);
+    m.ms.assign(1, L / n, 0, 1);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemTiltedCrystal::calcSubmatrices()
+void ElemTiltedCrystal::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    const double n = ior();
-    const double cos_a = cos(alpha());
-    const double cos_b = cos(asin(sin(alpha()) / n)); // cosine of angle inside medium
+    const double L = p[0];
+    const double n = p[1];
+    const double alpha = p[2];
+    const double cos_a = cos(alpha);
+    const double cos_b = cos(asin(sin(alpha) / n)); // cosine of angle inside medium
     const double cos_ab = cos_a / cos_b;
     const double cos_ba = cos_b / cos_a;
-    const double L1 = _subRangeSI;
-    const double L2 = lengthSI() - _subRangeSI;
+    const double L1 = subRangeSI;
+    const double L2 = L - subRangeSI;
 
     //  --> /:: -->  half lengh * input to medium
-    _mt1.assign(cos_ba, L1/n * cos_ab, 0, 1/n * cos_ab);
-    _ms1.assign(1, L1/n, 0, 1/n);
+    m.mt1.assign(cos_ba, L1/n * cos_ab, 0, 1/n * cos_ab);
+    m.ms1.assign(1, L1/n, 0, 1/n);
 
     //  --> ::/ -->  output from media * half length
-    _mt2.assign(cos_ab, L2 * cos_ab, 0, n * cos_ba);
-    _ms2.assign(1, L2, 0, n);
+    m.mt2.assign(cos_ab, L2 * cos_ab, 0, n * cos_ba);
+    m.ms2.assign(1, L2, 0, n);
 }
 
 //------------------------------------------------------------------------------
 //                              ElemTiltedPlate
 //------------------------------------------------------------------------------
 
-void ElemTiltedPlate::calcMatrixInternal()
+static double tiltedPlateAxisLength(double L, double n, double alpha)
 {
-    const double L = lengthSI();
-    const double n = ior();
-    const double sin_a = sin(alpha());
+    return L / cos( asin( sin( alpha ) / n ) );
+}
+
+void ElemTiltedPlate::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
+{
+    const double L = p[0];
+    const double n = p[1];
+    const double sin_a = sin(p[2]);
     const double s = n*n - sin_a*sin_a;
 
-    _mt.assign(1, L * n*n * (1 - sin_a*sin_a) / sqrt(s*s*s), 0, 1);
-    _ms.assign(1, L / sqrt(s), 0, 1);
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt.assign(1, L * n*n * (1 - sin_a*sin_a) / sqrt(s*s*s), 0, 1);
+    m.ms.assign(1, L / sqrt(s), 0, 1);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemTiltedPlate::calcSubmatrices()
+void ElemTiltedPlate::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    const double n = ior();
-    const double cos_a = cos(alpha());
-    const double cos_b = cos(asin( sin(alpha()) / n)); // cosine of angle inside medium
+    const double n = p[1];
+    const double alpha = p[2];
+    const double cos_a = cos(alpha);
+    const double cos_b = cos(asin( sin(alpha) / n)); // cosine of angle inside medium
     const double cos_ab = cos_a / cos_b;
     const double cos_ba = cos_b / cos_a;
-    const double L1 = _subRangeSI;
-    const double L2 = axisLengthSI() - _subRangeSI;
+    const double L1 = subRangeSI;
+    const double L2 = tiltedPlateAxisLength(p[0], n, alpha) - subRangeSI;
 
     //  --> /:: -->  half lengh * input to medium
-    _mt1.assign(cos_ba, L1/n * cos_ab, 0, 1/n * cos_ab);
-    _ms1.assign(1, L1/n, 0, 1/n);
+    m.mt1.assign(cos_ba, L1/n * cos_ab, 0, 1/n * cos_ab);
+    m.ms1.assign(1, L1/n, 0, 1/n);
 
     //  --> ::/ -->  output from medium * half length
-    _mt2.assign(cos_ab, L2 * cos_ab, 0, n * cos_ba);
-    _ms2.assign(1, L2, 0, n);
+    m.mt2.assign(cos_ab, L2 * cos_ab, 0, n * cos_ba);
+    m.ms2.assign(1, L2, 0, n);
 }
 
 double ElemTiltedPlate::axisLengthSI() const
 {
-    return lengthSI() / cos( asin( sin( alpha() ) / ior() ) );
+    return tiltedPlateAxisLength(lengthSI(), ior(), alpha());
 }
 
 //------------------------------------------------------------------------------
@@ -326,30 +369,30 @@ ElemBrewsterCrystal::ElemBrewsterCrystal() : ElementRange()
     _ior->setVisible(true);
 }
 
-void ElemBrewsterCrystal::calcMatrixInternal()
+void ElemBrewsterCrystal::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double L = lengthSI();
-    const double n = ior();
+    const double L = p[0];
+    const double n = p[1];
 
-    _ms.assign(1, L / n, 0, 1);
-    _mt.assign(1, _ms.B / SQR(n), 0, 1);
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.ms.assign(1, L / n, 0, 1);
+    m.mt.assign(1, m.ms.B / SQR(n), 0, 1);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemBrewsterCrystal::calcSubmatrices()
+void ElemBrewsterCrystal::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    const double n = ior();
-    const double L1 = _subRangeSI;
-    const double L2 = lengthSI() - L1;
+    const double n = p[1];
+    const double L1 = subRangeSI;
+    const double L2 = p[0] - L1;
 
     //  --> /:: -->  half lengh * input to medium
-    _mt1.assign(n, L1/n/n, 0, 1/n/n);
-    _ms1.assign(1, L1/n,   0, 1/n);
+    m.mt1.assign(n, L1/n/n, 0, 1/n/n);
+    m.ms1.assign(1, L1/n,   0, 1/n);
 
     //  --> ::/ -->  output from media * half length
-    _mt2.assign(1/n, L2/n, 0, n*n);
-    _ms2.assign(1, L2, 0, n);
+    m.mt2.assign(1/n, L2/n, 0, n*n);
+    m.ms2.assign(1, L2, 0, n);
 }
 
 //------------------------------------------------------------------------------
@@ -361,36 +404,40 @@ ElemBrewsterPlate::ElemBrewsterPlate() : ElementRange()
     _ior->setVisible(true);
 }
 
-void ElemBrewsterPlate::calcMatrixInternal()
+static double brewsterPlateAxisLength(double L, double n)
 {
-    const double n = ior();
+    // L_eff = L / cos( asin( sin( atan(n) )/n ) ) = L * Sqrt(n^2 + 1) / n
+    return L * sqrt(n*n + 1) / n;
+}
 
-    _ms.assign(1, axisLengthSI() / n, 0, 1);
-    _mt.assign(1, _ms.B / SQR(n), 0, 1);
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+void ElemBrewsterPlate::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
+{
+    const double n = p[1];
+
+    m.ms.assign(1, brewsterPlateAxisLength(p[0], n) / n, 0, 1);
+    m.mt.assign(1, m.ms.B / SQR(n), 0, 1);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemBrewsterPlate::calcSubmatrices()
+void ElemBrewsterPlate::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    const double L1 = _subRangeSI;
-    const double L2 = axisLengthSI() - L1;
-    const double n = ior();
+    const double n = p[1];
+    const double L1 = subRangeSI;
+    const double L2 = brewsterPlateAxisLength(p[0], n) - L1;
 
     //  --> /:: -->  half lengh * input to medium
-    _mt1.assign(n, L1/n/n, 0, 1/n/n);
-    _ms1.assign(1, L1/n, 0, 1/n);
+    m.mt1.assign(n, L1/n/n, 0, 1/n/n);
+    m.ms1.assign(1, L1/n, 0, 1/n);
 
     //  --> ::/ -->  output from media * half length
-    _mt2.assign(1/n, L2/n, 0, n*n);
-    _ms2.assign(1, L2, 0, n);
+    m.mt2.assign(1/n, L2/n, 0, n*n);
+    m.ms2.assign(1, L2, 0, n);
 }
 
 double ElemBrewsterPlate::axisLengthSI() const
 {
-    // L_eff = L / cos( asin( sin( atan(n) )/n ) ) = L * Sqrt(n^2 + 1) / n
-    const double n = ior();
-    return lengthSI() * sqrt(n*n + 1) / n;
+    return brewsterPlateAxisLength(lengthSI(), ior());
 }
 
 //------------------------------------------------------------------------------
@@ -437,14 +484,12 @@ void ElemMatrix::setMatrix(int offset, const double& a, const double& b, const d
 
 // TODO:NEXT-VER checkParameter(): can A and D be 0 and what does it mean?
 
-void ElemMatrix::calcMatrixInternal()
+void ElemMatrix::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.assign(_params.at(0)->value().toSi(), _params.at(1)->value().toSi(),
-               _params.at(2)->value().toSi(), _params.at(3)->value().toSi());
-    _ms.assign(_params.at(4)->value().toSi(), _params.at(5)->value().toSi(),
-               _params.at(6)->value().toSi(), _params.at(7)->value().toSi());
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt.assign(p[0], p[1], p[2], p[3]);
+    m.ms.assign(p[4], p[5], p[6], p[7]);
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
@@ -477,13 +522,12 @@ void ElemMatrix1::setMatrix(const double& a, const double& b, const double& c, c
     params().at(3)->setValue(Z::Value(d, Z::Units::none()));
 }
 
-void ElemMatrix1::calcMatrixInternal()
+void ElemMatrix1::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    _mt.assign(_params.at(0)->value().toSi(), _params.at(1)->value().toSi(),
-               _params.at(2)->value().toSi(), _params.at(3)->value().toSi());
-    _ms = _mt;
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt.assign(p[0], p[1], p[2], p[3]);
+    m.ms = m.mt;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
@@ -495,36 +539,45 @@ ElemPoint::ElemPoint() : Element()
     setOption(Element_Unity);
 }
 
+void ElemPoint::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
+{
+    Q_UNUSED(p)
+    m.mt.unity();
+    m.ms.unity();
+    m.mt_inv.unity();
+    m.ms_inv.unity();
+}
+
 //------------------------------------------------------------------------------
 //                             ElemNormalInterface
 //------------------------------------------------------------------------------
 
-void ElemNormalInterface::calcMatrixInternal()
+void ElemNormalInterface::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double n1 = ior1();
-    const double n2 = ior2();
+    const double n1 = p[0];
+    const double n2 = p[1];
 
-    _mt.assign(1, 0, 0, n1 / n2);
-    _ms = _mt;
+    m.mt.assign(1, 0, 0, n1 / n2);
+    m.ms = m.mt;
 
-    _mt_inv.assign(1, 0, 0, n2 / n1);
-    _ms_inv = _mt_inv;
+    m.mt_inv.assign(1, 0, 0, n2 / n1);
+    m.ms_inv = m.mt_inv;
 }
 
 //------------------------------------------------------------------------------
 //                             ElemBrewsterInterface
 //------------------------------------------------------------------------------
 
-void ElemBrewsterInterface::calcMatrixInternal()
+void ElemBrewsterInterface::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double n1 = ior1();
-    const double n2 = ior2();
+    const double n1 = p[0];
+    const double n2 = p[1];
 
-    _mt.assign(n2/n1, 0, 0, (n1/n2)*(n1/n2));
-    _ms.assign(1, 0, 0, n1/n2);
+    m.mt.assign(n2/n1, 0, 0, (n1/n2)*(n1/n2));
+    m.ms.assign(1, 0, 0, n1/n2);
 
-    _mt_inv.assign(n1/n2, 0, 0, (n2/n1)*(n2/n1));
-    _ms_inv.assign(1, 0, 0, n2/n1);
+    m.mt_inv.assign(n1/n2, 0, 0, (n2/n1)*(n2/n1));
+    m.ms_inv.assign(1, 0, 0, n2/n1);
 }
 
 //------------------------------------------------------------------------------
@@ -542,11 +595,11 @@ ElemTiltedInterface::ElemTiltedInterface() : ElementInterface()
     addParam(_alpha);
 }
 
-void ElemTiltedInterface::calcMatrixInternal()
+void ElemTiltedInterface::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double n1 = ior1();
-    const double n2 = ior2();
-    const double angle = alpha();
+    const double n1 = p[0];
+    const double n2 = p[1];
+    const double angle = p[2];
     /*    \ |
        n1  \| alpha      Positive angle value means we set angle Alpha (angle at the side of medium n1)
      -------+-------     Negative angle value means we set angle Beta (angle at the side of medium n2)
@@ -555,11 +608,11 @@ void ElemTiltedInterface::calcMatrixInternal()
     const double cos_a = angle < 0 ? cos(asin( sin(angle) * n2 / n1)) : cos(angle);
     const double cos_b = angle < 0 ? cos(qAbs(angle)): cos(asin( sin(angle) * n1 / n2));
 
-    _mt.assign(cos_b/cos_a, 0, 0, (n1/n2)*(cos_a/cos_b));
-    _ms.assign(1, 0, 0, n1/n2);
+    m.mt.assign(cos_b/cos_a, 0, 0, (n1/n2)*(cos_a/cos_b));
+    m.ms.assign(1, 0, 0, n1/n2);
 
-    _mt_inv.assign(cos_a/cos_b, 0, 0, (n2/n1)*(cos_b/cos_a));
-    _ms_inv.assign(1, 0, 0, n2/n1);
+    m.mt_inv.assign(cos_a/cos_b, 0, 0, (n2/n1)*(cos_b/cos_a));
+    m.ms_inv.assign(1, 0, 0, n2/n1);
 }
 
 //------------------------------------------------------------------------------
@@ -580,23 +633,23 @@ ElemSphericalInterface::ElemSphericalInterface() : ElementInterface()
     _radius->setVerifier(globalCurvatureRadiusVerifier());
 }
 
-void ElemSphericalInterface::calcMatrixInternal()
+void ElemSphericalInterface::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double n1 = ior1();
-    const double n2 = ior2();
-    const double R = radius();
+    const double n1 = p[0];
+    const double n2 = p[1];
+    const double R = p[2];
     const bool flat = qIsInf(R);
 
     if (flat) {
-        _mt.assign(1, 0, 0, n1/n2);
-        _mt_inv.assign(1, 0, 0, n2/n1);
+        m.mt.assign(1, 0, 0, n1/n2);
+        m.mt_inv.assign(1, 0, 0, n2/n1);
     } else {
-        _mt.assign(1, 0, (n1-n2)/R/n2, n1/n2);
-        _mt_inv.assign(1, 0, (n2-n1)/(-R)/n1, n2/n1);
+        m.mt.assign(1, 0, (n1-n2)/R/n2, n1/n2);
+        m.mt_inv.assign(1, 0, (n2-n1)/(-R)/n1, n2/n1);
     }
     
-    _ms = _mt;
-    _ms_inv = _mt_inv;
+    m.ms = m.mt;
+    m.ms_inv = m.mt_inv;
 }
 
 QList<QPair<Z::Parameter*, Z::Parameter*>> ElemSphericalInterface::flip()
@@ -637,12 +690,12 @@ ElemThickLens::ElemThickLens() : ElementRange()
     setOption(Element_Asymmetrical);
 }
 
-void ElemThickLens::calcMatrixInternal()
+void ElemThickLens::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double L = lengthSI();
-    const double n = ior();
-    const double R1 = radius1();
-    const double R2 = radius2();
+    const double L = p[0];
+    const double n = p[1];
+    const double R1 = p[2];
+    const double R2 = p[3];
     const double R1_inv = -R2;
     const double R2_inv = -R1;
     const bool flat1 = qIsInf(R1);
@@ -689,19 +742,19 @@ void ElemThickLens::calcMatrixInternal()
         D_inv = 1 + (L/R2_inv)*(n-1)/n;
     }
 
-    _mt.assign(A, B, C, D);
-    _mt_inv.assign(A_inv, B_inv, C_inv, D_inv);
-    _ms = _mt;
-    _ms_inv = _mt_inv;
+    m.mt.assign(A, B, C, D);
+    m.mt_inv.assign(A_inv, B_inv, C_inv, D_inv);
+    m.ms = m.mt;
+    m.ms_inv = m.mt_inv;
 }
 
-void ElemThickLens::calcSubmatrices()
+void ElemThickLens::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m)
 {
-    const double n = ior();
-    const double L1 = _subRangeSI;
-    const double L2 = lengthSI() - L1;
-    const double R1 = radius1();
-    const double R2 = radius2();
+    const double n = p[1];
+    const double L1 = subRangeSI;
+    const double L2 = p[0] - L1;
+    const double R1 = p[2];
+    const double R2 = p[3];
     const bool flat1 = qIsInf(R1);
     const bool flat2 = qIsInf(R2);
     
@@ -760,10 +813,10 @@ void ElemThickLens::calcSubmatrices()
         D2 = L2*(n-1)/R2 + n;
     }
 
-    _mt1.assign(A1, B1, C1, D1);
-    _mt2.assign(A2, B2, C2, D2);
-    _ms1 = _mt1;
-    _ms2 = _mt2;
+    m.mt1.assign(A1, B1, C1, D1);
+    m.mt2.assign(A2, B2, C2, D2);
+    m.ms1 = m.mt1;
+    m.ms2 = m.mt2;
 }
 
 QList<QPair<Z::Parameter*, Z::Parameter*>> ElemThickLens::flip()
@@ -804,65 +857,65 @@ ElemGrinLens::ElemGrinLens() : ElementRange() {
     addParam(_ior2s);
 }
 
-void ElemGrinLens::calcMatrixInternal() {
-    const double L = qAbs(lengthSI());
-    const double n0 = qAbs(ior());
-    const double n2t = ior2t();
-    const double n2s = ior2s();
+void ElemGrinLens::calcMatrixKernel(const double* p, Z::KernelMatrices& m) {
+    const double L = qAbs(p[0]);
+    const double n0 = qAbs(p[1]);
+    const double n2t = p[2];
+    const double n2s = p[3];
 
     // When n2 = 0 then A = 1, C = 0, D = 1, B = 0/0 -> L/n0
 
     if (n2t > 0) {
         const double g = sqrt(n2t / n0);
-        _mt.assign(cos(g*L), sin(g*L)/n0/g, -n0*g*sin(g*L), cos(g*L));
+        m.mt.assign(cos(g*L), sin(g*L)/n0/g, -n0*g*sin(g*L), cos(g*L));
     } else if (n2t < 0) {
         const double g = sqrt(-n2t / n0);
-        _mt.assign(cosh(g*L), sinh(g*L)/n0/g, n0*g*sinh(g*L), cosh(g*L));
-    } else _mt.assign(1, L/n0, 0, 1);
+        m.mt.assign(cosh(g*L), sinh(g*L)/n0/g, n0*g*sinh(g*L), cosh(g*L));
+    } else m.mt.assign(1, L/n0, 0, 1);
 
     if (n2s > 0) {
         const double g = sqrt(n2s / n0);
-        _ms.assign(cos(g*L), sin(g*L)/n0/g, -n0*g*sin(g*L), cos(g*L));
+        m.ms.assign(cos(g*L), sin(g*L)/n0/g, -n0*g*sin(g*L), cos(g*L));
     } else if (n2s < 0) {
         const double g = sqrt(-n2s / n0);
-        _ms.assign(cosh(g*L), sinh(g*L)/n0/g, n0*g*sinh(g*L), cosh(g*L));
-    } else _ms.assign(1, L/n0, 0, 1);
+        m.ms.assign(cosh(g*L), sinh(g*L)/n0/g, n0*g*sinh(g*L), cosh(g*L));
+    } else m.ms.assign(1, L/n0, 0, 1);
 
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemGrinLens::calcSubmatrices() {
-    const double L1 = _subRangeSI;
-    const double L2 = qAbs(lengthSI()) - L1;
-    const double n0 = qAbs(ior());
-    const double n2t = ior2t();
-    const double n2s = ior2s();
+void ElemGrinLens::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m) {
+    const double L1 = subRangeSI;
+    const double L2 = qAbs(p[0]) - L1;
+    const double n0 = qAbs(p[1]);
+    const double n2t = p[2];
+    const double n2s = p[3];
 
     if (n2t > 0) {
         const double g = sqrt(n2t / n0);
-        _mt1.assign(cos(g*L1), sin(g*L1)/n0/g, -g*sin(g*L1), cos(g*L1)/n0);
-        _mt2.assign(cos(g*L2), sin(g*L2)/g, -n0*g*sin(g*L2), n0*cos(g*L2));
+        m.mt1.assign(cos(g*L1), sin(g*L1)/n0/g, -g*sin(g*L1), cos(g*L1)/n0);
+        m.mt2.assign(cos(g*L2), sin(g*L2)/g, -n0*g*sin(g*L2), n0*cos(g*L2));
     } else if (n2t < 0) {
         const double g = sqrt(-n2t / n0);
-        _mt1.assign(cosh(g*L1), sinh(g*L1)/n0/g, g*sinh(g*L1), cosh(g*L1)/n0);
-        _mt2.assign(cosh(g*L2), sinh(g*L2)/g, n0*g*sinh(g*L2), n0*cosh(g*L2));
+        m.mt1.assign(cosh(g*L1), sinh(g*L1)/n0/g, g*sinh(g*L1), cosh(g*L1)/n0);
+        m.mt2.assign(cosh(g*L2), sinh(g*L2)/g, n0*g*sinh(g*L2), n0*cosh(g*L2));
     } else {
-        _mt1.assign(1, L1/n0, 0, 1/n0);
-        _mt2.assign(1, L2, 0, n0);
+        m.mt1.assign(1, L1/n0, 0, 1/n0);
+        m.mt2.assign(1, L2, 0, n0);
     }
 
     if (n2s > 0) {
         const double g = sqrt(n2s / n0);
-        _ms1.assign(cos(g*L1), sin(g*L1)/n0/g, -g*sin(g*L1), cos(g*L1)/n0);
-        _ms2.assign(cos(g*L2), sin(g*L2)/g, -n0*g*sin(g*L2), n0*cos(g*L2));
+        m.ms1.assign(cos(g*L1), sin(g*L1)/n0/g, -g*sin(g*L1), cos(g*L1)/n0);
+        m.ms2.assign(cos(g*L2), sin(g*L2)/g, -n0*g*sin(g*L2), n0*cos(g*L2));
     } else if (n2s < 0) {
         const double g = sqrt(-n2s / n0);
-        _ms1.assign(cosh(g*L1), sinh(g*L1)/n0/g, g*sinh(g*L1), cosh(g*L1)/n0);
-        _ms2.assign(cosh(g*L2), sinh(g*L2)/g, n0*g*sinh(g*L2), n0*cosh(g*L2));
+        m.ms1.assign(cosh(g*L1), sinh(g*L1)/n0/g, g*sinh(g*L1), cosh(g*L1)/n0);
+        m.ms2.assign(cosh(g*L2), sinh(g*L2)/g, n0*g*sinh(g*L2), n0*cosh(g*L2));
     } else {
-        _ms1.assign(1, L1/n0, 0, 1/n0);
-        _ms2.assign(1, L2, 0, n0);
+        m.ms1.assign(1, L1/n0, 0, 1/n0);
+        m.ms2.assign(1, L2, 0, n0);
     }
 }
 
@@ -896,65 +949,65 @@ ElemGrinMedium::ElemGrinMedium() : ElemMediumRange() {
     addParam(_ior2s);
 }
 
-void ElemGrinMedium::calcMatrixInternal() {
-    const double L = qAbs(lengthSI());
-    const double n0 = qAbs(ior());
-    const double n2t = ior2t();
-    const double n2s = ior2s();
+void ElemGrinMedium::calcMatrixKernel(const double* p, Z::KernelMatrices& m) {
+    const double L = qAbs(p[0]);
+    const double n0 = qAbs(p[1]);
+    const double n2t = p[2];
+    const double n2s = p[3];
 
     // When n2 = 0 then A = 1, C = 0, D = 1, B = 0/0 -> L
 
     if (n2t > 0) {
         const double g = sqrt(n2t / n0);
-        _mt.assign(cos(g*L), sin(g*L)/g, -g*sin(g*L), cos(g*L));
+        m.mt.assign(cos(g*L), sin(g*L)/g, -g*sin(g*L), cos(g*L));
     } else if (n2t < 0) {
         const double g = sqrt(-n2t / n0);
-        _mt.assign(cosh(g*L), sinh(g*L)/g, g*sinh(g*L), cosh(g*L));
-    } else _mt.assign(1, L, 0, 1);
+        m.mt.assign(cosh(g*L), sinh(g*L)/g, g*sinh(g*L), cosh(g*L));
+    } else m.mt.assign(1, L, 0, 1);
 
     if (n2s > 0) {
         const double g = sqrt(n2s / n0);
-        _ms.assign(cos(g*L), sin(g*L)/g, -g*sin(g*L), cos(g*L));
+        m.ms.assign(cos(g*L), sin(g*L)/g, -g*sin(g*L), cos(g*L));
     } else if (n2s < 0) {
         const double g = sqrt(-n2s / n0);
-        _ms.assign(cosh(g*L), sinh(g*L)/g, g*sinh(g*L), cosh(g*L));
-    } else _ms.assign(1, L, 0, 1);
+        m.ms.assign(cosh(g*L), sinh(g*L)/g, g*sinh(g*L), cosh(g*L));
+    } else m.ms.assign(1, L, 0, 1);
 
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemGrinMedium::calcSubmatrices() {
-    const double L1 = _subRangeSI;
-    const double L2 = qAbs(lengthSI()) - L1;
-    const double n0 = qAbs(ior());
-    const double n2t = ior2t();
-    const double n2s = ior2s();
+void ElemGrinMedium::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m) {
+    const double L1 = subRangeSI;
+    const double L2 = qAbs(p[0]) - L1;
+    const double n0 = qAbs(p[1]);
+    const double n2t = p[2];
+    const double n2s = p[3];
 
     if (n2t > 0) {
         const double g = sqrt(n2t / n0);
-        _mt1.assign(cos(g*L1), sin(g*L1)/g, -g*sin(g*L1), cos(g*L1));
-        _mt2.assign(cos(g*L2), sin(g*L2)/g, -g*sin(g*L2), cos(g*L2));
+        m.mt1.assign(cos(g*L1), sin(g*L1)/g, -g*sin(g*L1), cos(g*L1));
+        m.mt2.assign(cos(g*L2), sin(g*L2)/g, -g*sin(g*L2), cos(g*L2));
     } else if (n2t < 0) {
         const double g = sqrt(-n2t / n0);
-        _mt1.assign(cosh(g*L1), sinh(g*L1)/g, g*sinh(g*L1), cosh(g*L1));
-        _mt2.assign(cosh(g*L2), sinh(g*L2)/g, g*sinh(g*L2), cosh(g*L2));
+        m.mt1.assign(cosh(g*L1), sinh(g*L1)/g, g*sinh(g*L1), cosh(g*L1));
+        m.mt2.assign(cosh(g*L2), sinh(g*L2)/g, g*sinh(g*L2), cosh(g*L2));
     } else {
-        _mt1.assign(1, L1, 0, 1);
-        _mt2.assign(1, L2, 0, 1);
+        m.mt1.assign(1, L1, 0, 1);
+        m.mt2.assign(1, L2, 0, 1);
     }
 
     if (n2s > 0) {
         const double g = sqrt(n2s / n0);
-        _ms1.assign(cos(g*L1), sin(g*L1)/g, -g*sin(g*L1), cos(g*L1));
-        _ms2.assign(cos(g*L2), sin(g*L2)/g, -g*sin(g*L2), cos(g*L2));
+        m.ms1.assign(cos(g*L1), sin(g*L1)/g, -g*sin(g*L1), cos(g*L1));
+        m.ms2.assign(cos(g*L2), sin(g*L2)/g, -g*sin(g*L2), cos(g*L2));
     } else if (n2s < 0) {
         const double g = sqrt(-n2s / n0);
-        _ms1.assign(cosh(g*L1), sinh(g*L1)/g, g*sinh(g*L1), cosh(g*L1));
-        _ms2.assign(cosh(g*L2), sinh(g*L2)/g, g*sinh(g*L2), cosh(g*L2));
+        m.ms1.assign(cosh(g*L1), sinh(g*L1)/g, g*sinh(g*L1), cosh(g*L1));
+        m.ms2.assign(cosh(g*L2), sinh(g*L2)/g, g*sinh(g*L2), cosh(g*L2));
     } else {
-        _ms1.assign(1, L1, 0, 1);
-        _ms2.assign(1, L2, 0, 1);
+        m.ms1.assign(1, L1, 0, 1);
+        m.ms2.assign(1, L2, 0, 1);
     }
 }
 
@@ -979,46 +1032,79 @@ ElemThermoLens::ElemThermoLens() : ElementRange() {
     addParam(_focus);
 }
 
-void ElemThermoLens::calcMatrixInternal() {
-    const double L = qAbs(lengthSI());
-    const double F = focus();
-    const double n0 = qAbs(ior());
+// Returns NaN when the gradient can't be found for given focal length.
+static double thermoIor2(double L, double n0, double F)
+{
+    if (Double(F).is(0))
+        return NaN;
+    auto n2 = GrinCalculator::solve_n2(L, n0, F);
+    return n2.ok() ? n2.result() : NaN;
+}
 
-    if (Double(F).isNot(0)) {
-        auto n2 = GrinCalculator::solve_n2(L, n0, F);
-        if (n2.ok()) {
-            _n2 = n2.result();
-            if (_n2 > 0) {
-                const double g = sqrt(_n2 / n0);
-                _mt.assign(cos(g*L), sin(g*L)/n0/g, -n0*g*sin(g*L), cos(g*L));
-            } else {
-                const double g = sqrt(-_n2 / n0);
-                _mt.assign(cosh(g*L), sinh(g*L)/n0/g, n0*g*sinh(g*L), cosh(g*L));
-            }
-        } else _mt.assign(NaN, NaN, NaN, NaN);
-    } else _mt.assign(NaN, NaN, NaN, NaN);
+static void thermoLensMatrices(double L, double n0, double n2, Z::KernelMatrices& m)
+{
+    if (qIsNaN(n2)) {
+        m.mt.assign(NaN, NaN, NaN, NaN);
+    } else if (n2 > 0) {
+        const double g = sqrt(n2 / n0);
+        m.mt.assign(cos(g*L), sin(g*L)/n0/g, -n0*g*sin(g*L), cos(g*L));
+    } else {
+        const double g = sqrt(-n2 / n0);
+        m.mt.assign(cosh(g*L), sinh(g*L)/n0/g, n0*g*sinh(g*L), cosh(g*L));
+    }
 
-    _ms = _mt;
+    m.ms = m.mt;
 
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemThermoLens::calcSubmatrices() {
-    const double L1 = _subRangeSI;
-    const double L2 = qAbs(lengthSI()) - L1;
-    const double n0 = qAbs(ior());
-    if (_n2 > 0) {
-        const double g = sqrt(_n2 / n0);
-        _mt1.assign(cos(g*L1), sin(g*L1)/n0/g, -g*sin(g*L1), cos(g*L1)/n0);
-        _mt2.assign(cos(g*L2), sin(g*L2)/g, -n0*g*sin(g*L2), n0*cos(g*L2));
+static void thermoLensSubmatrices(double L1, double L2, double n0, double n2, Z::KernelMatrices& m)
+{
+    if (n2 > 0) {
+        const double g = sqrt(n2 / n0);
+        m.mt1.assign(cos(g*L1), sin(g*L1)/n0/g, -g*sin(g*L1), cos(g*L1)/n0);
+        m.mt2.assign(cos(g*L2), sin(g*L2)/g, -n0*g*sin(g*L2), n0*cos(g*L2));
     } else {
-        const double g = sqrt(-_n2 / n0);
-        _mt1.assign(cosh(g*L1), sinh(g*L1)/n0/g, g*sinh(g*L1), cosh(g*L1)/n0);
-        _mt2.assign(cosh(g*L2), sinh(g*L2)/g, n0*g*sinh(g*L2), n0*cosh(g*L2));
+        const double g = sqrt(-n2 / n0);
+        m.mt1.assign(cosh(g*L1), sinh(g*L1)/n0/g, g*sinh(g*L1), cosh(g*L1)/n0);
+        m.mt2.assign(cosh(g*L2), sinh(g*L2)/g, n0*g*sinh(g*L2), n0*cosh(g*L2));
     }
-    _ms1 = _mt1;
-    _ms2 = _mt2;
+    m.ms1 = m.mt1;
+    m.ms2 = m.mt2;
+}
+
+void ElemThermoLens::calcMatrixKernel(const double* p, Z::KernelMatrices& m) {
+    const double L = qAbs(p[0]);
+    const double n0 = qAbs(p[1]);
+    m.derived = thermoIor2(L, n0, p[2]);
+    thermoLensMatrices(L, n0, *m.derived, m);
+}
+
+void ElemThermoLens::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m) {
+    const double L = qAbs(p[0]);
+    const double n0 = qAbs(p[1]);
+    // Solving for the gradient is iterative, so do it only when there is no value
+    // found for the same parameters by calcMatrixKernel or by a previous sub-range
+    if (!m.derived)
+        m.derived = thermoIor2(L, n0, p[2]);
+    thermoLensSubmatrices(subRangeSI, L - subRangeSI, n0, *m.derived, m);
+}
+
+void ElemThermoLens::calcMatrixInternal() {
+    const double L = qAbs(lengthSI());
+    const double n0 = qAbs(ior());
+    _n2 = thermoIor2(L, n0, focus());
+
+    Z::KernelMatrices m;
+    thermoLensMatrices(L, n0, _n2, m);
+    assignMatrices(m);
+}
+
+void ElemThermoLens::calcSubmatrices() {
+    Z::KernelMatrices m;
+    thermoLensSubmatrices(_subRangeSI, qAbs(lengthSI()) - _subRangeSI, qAbs(ior()), _n2, m);
+    assignSubmatrices(m);
 }
 
 //------------------------------------------------------------------------------
@@ -1043,44 +1129,67 @@ ElemThermoMedium::ElemThermoMedium() : ElemMediumRange() {
     addParam(_focus);
 }
 
+static void thermoMediumMatrices(double L, double n0, double n2, Z::KernelMatrices& m)
+{
+    if (qIsNaN(n2)) {
+        m.mt.assign(NaN, NaN, NaN, NaN);
+    } else if (n2 > 0) {
+        const double g = sqrt(n2 / n0);
+        m.mt.assign(cos(g*L), sin(g*L)/g, -g*sin(g*L), cos(g*L));
+    } else {
+        const double g = sqrt(-n2 / n0);
+        m.mt.assign(cosh(g*L), sinh(g*L)/g, g*sinh(g*L), cosh(g*L));
+    }
+    m.ms = m.mt;
+
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
+}
+
+static void thermoMediumSubmatrices(double L1, double L2, double n0, double n2, Z::KernelMatrices& m)
+{
+    if (n2 > 0) {
+        const double g = sqrt(n2 / n0);
+        m.mt1.assign(cos(g*L1), sin(g*L1)/g, -g*sin(g*L1), cos(g*L1));
+        m.mt2.assign(cos(g*L2), sin(g*L2)/g, -g*sin(g*L2), cos(g*L2));
+    } else {
+        const double g = sqrt(-n2 / n0);
+        m.mt1.assign(cosh(g*L1), sinh(g*L1)/g, g*sinh(g*L1), cosh(g*L1));
+        m.mt2.assign(cosh(g*L2), sinh(g*L2)/g, g*sinh(g*L2), cosh(g*L2));
+    }
+    m.ms1 = m.mt1;
+    m.ms2 = m.mt2;
+}
+
+void ElemThermoMedium::calcMatrixKernel(const double* p, Z::KernelMatrices& m) {
+    const double L = qAbs(p[0]);
+    const double n0 = qAbs(p[1]);
+    m.derived = thermoIor2(L, n0, p[2]);
+    thermoMediumMatrices(L, n0, *m.derived, m);
+}
+
+void ElemThermoMedium::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m) {
+    const double L = qAbs(p[0]);
+    const double n0 = qAbs(p[1]);
+    if (!m.derived)
+        m.derived = thermoIor2(L, n0, p[2]);
+    thermoMediumSubmatrices(subRangeSI, L - subRangeSI, n0, *m.derived, m);
+}
+
 void ElemThermoMedium::calcMatrixInternal() {
     const double L = qAbs(lengthSI());
     const double n0 = qAbs(ior());
-    const double F = focus();
-    if (Double(F).isNot(0)) {
-        auto n2 = GrinCalculator::solve_n2(L, n0, F);
-        if (n2.ok()) {
-            _n2 = n2.result();
-            if (_n2 > 0) {
-                const double g = sqrt(_n2 / n0);
-                _mt.assign(cos(g*L), sin(g*L)/g, -g*sin(g*L), cos(g*L));
-            } else {
-                const double g = sqrt(-_n2 / n0);
-                _mt.assign(cosh(g*L), sinh(g*L)/g, g*sinh(g*L), cosh(g*L));
-            }
-        } else _mt.assign(NaN, NaN, NaN, NaN);
-    } else _mt.assign(NaN, NaN, NaN, NaN);
-    _ms = _mt;
-
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    _n2 = thermoIor2(L, n0, focus());
+
+    Z::KernelMatrices m;
+    thermoMediumMatrices(L, n0, _n2, m);
+    assignMatrices(m);
 }
 
 void ElemThermoMedium::calcSubmatrices() {
-    const double L1 = _subRangeSI;
-    const double L2 = qAbs(lengthSI()) - L1;
-    const double n0 = qAbs(ior());
-    if (_n2 > 0) {
-        const double g = sqrt(_n2 / n0);
-        _mt1.assign(cos(g*L1), sin(g*L1)/g, -g*sin(g*L1), cos(g*L1));
-        _mt2.assign(cos(g*L2), sin(g*L2)/g, -g*sin(g*L2), cos(g*L2));
-    } else {
-        const double g = sqrt(-_n2 / n0);
-        _mt1.assign(cosh(g*L1), sinh(g*L1)/g, g*sinh(g*L1), cosh(g*L1));
-        _mt2.assign(cosh(g*L2), sinh(g*L2)/g, g*sinh(g*L2), cosh(g*L2));
-    }
-    _ms1 = _mt1;
-    _ms2 = _mt2;
+    Z::KernelMatrices m;
+    thermoMediumSubmatrices(_subRangeSI, qAbs(lengthSI()) - _subRangeSI, qAbs(ior()), _n2, m);
+    assignSubmatrices(m);
 }
 
 //------------------------------------------------------------------------------
@@ -1187,17 +1296,17 @@ ElemGaussAperture::ElemGaussAperture() : Element()
     setOption(Element_Complex);
 }
 
-void ElemGaussAperture::calcMatrixInternal()
+void ElemGaussAperture::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double wl = _lambda->value().toSi();
-    const double a2t = _alpha2t->value().toSi();
-    const double a2s = _alpha2s->value().toSi();
+    const double wl = p[0];
+    const double a2t = p[1];
+    const double a2s = p[2];
 
-    _mt.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(0, -wl*a2t/_2PI), Z::Complex(1, 0));
-    _ms.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(0, -wl*a2s/_2PI), Z::Complex(1, 0));
+    m.mt.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(0, -wl*a2t/_2PI), Z::Complex(1, 0));
+    m.ms.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(0, -wl*a2s/_2PI), Z::Complex(1, 0));
 
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
@@ -1250,19 +1359,19 @@ ElemGaussApertureLens::ElemGaussApertureLens() : Element()
     _focusS->setVerifier(globalFocalLengthVerifier());
 }
 
-void ElemGaussApertureLens::calcMatrixInternal()
+void ElemGaussApertureLens::calcMatrixKernel(const double* p, Z::KernelMatrices& m)
 {
-    const double wl = _lambda->value().toSi();
-    const double ft = _focusT->value().toSi();
-    const double fs = _focusS->value().toSi();
-    const double a2t = _alpha2t->value().toSi();
-    const double a2s = _alpha2s->value().toSi();
+    const double wl = p[0];
+    const double ft = p[1];
+    const double fs = p[2];
+    const double a2t = p[3];
+    const double a2s = p[4];
 
-    _mt.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(-1.0/ft, -wl*a2t/_2PI), Z::Complex(1, 0));
-    _ms.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(-1.0/fs, -wl*a2s/_2PI), Z::Complex(1, 0));
+    m.mt.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(-1.0/ft, -wl*a2t/_2PI), Z::Complex(1, 0));
+    m.ms.assign(Z::Complex(1, 0), Z::Complex(0, 0), Z::Complex(-1.0/fs, -wl*a2s/_2PI), Z::Complex(1, 0));
 
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
 //------------------------------------------------------------------------------
@@ -1319,42 +1428,42 @@ ElemGaussDuctMedium::ElemGaussDuctMedium() : ElementRange() {
     setOption(Element_Complex);
 }
 
-void ElemGaussDuctMedium::calcMatrixInternal() {
-    const double L = lengthSI();
-    const double n0 = ior();
-    const double wl = _lambda->value().toSi();
-    const double n2t = _ior2t->value().toSi();
-    const double n2s = _ior2s->value().toSi();
-    const double a2t = _alpha2t->value().toSi();
-    const double a2s = _alpha2s->value().toSi();
+void ElemGaussDuctMedium::calcMatrixKernel(const double* p, Z::KernelMatrices& m) {
+    const double L = p[0];
+    const double n0 = p[1];
+    const double wl = p[2];
+    const double n2t = p[3];
+    const double n2s = p[4];
+    const double a2t = p[5];
+    const double a2s = p[6];
 
     const Z::Complex gt = sqrt(Z::Complex(n2t/n0, wl*a2t/n0/_2PI));
-    _mt.assign(cos(gt*L), sin(gt*L)/gt, -gt*sin(gt*L), cos(gt*L));
+    m.mt.assign(cos(gt*L), sin(gt*L)/gt, -gt*sin(gt*L), cos(gt*L));
 
     const Z::Complex gs = sqrt(Z::Complex(n2s/n0, wl*a2s/n0/_2PI));
-    _ms.assign(cos(gs*L), sin(gs*L)/gs, -gs*sin(gs*L), cos(gs*L));
+    m.ms.assign(cos(gs*L), sin(gs*L)/gs, -gs*sin(gs*L), cos(gs*L));
 
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemGaussDuctMedium::calcSubmatrices() {
-    const double L1 = _subRangeSI;
-    const double L2 = lengthSI() - L1;
-    const double n0 = ior();
-    const double lambda = _lambda->value().toSi();
-    const double n2t = _ior2t->value().toSi();
-    const double n2s = _ior2s->value().toSi();
-    const double a2t = _alpha2t->value().toSi();
-    const double a2s = _alpha2s->value().toSi();
+void ElemGaussDuctMedium::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m) {
+    const double L1 = subRangeSI;
+    const double L2 = p[0] - L1;
+    const double n0 = p[1];
+    const double lambda = p[2];
+    const double n2t = p[3];
+    const double n2s = p[4];
+    const double a2t = p[5];
+    const double a2s = p[6];
 
     const Z::Complex gt = sqrt(Z::Complex(n2t/n0, lambda*a2t/n0/_2PI));
-    _mt1.assign(cos(gt*L1), sin(gt*L1)/gt, -gt*sin(gt*L1), cos(gt*L1));
-    _mt2.assign(cos(gt*L2), sin(gt*L2)/gt, -gt*sin(gt*L2), cos(gt*L2));
+    m.mt1.assign(cos(gt*L1), sin(gt*L1)/gt, -gt*sin(gt*L1), cos(gt*L1));
+    m.mt2.assign(cos(gt*L2), sin(gt*L2)/gt, -gt*sin(gt*L2), cos(gt*L2));
 
     const Z::Complex gs = sqrt(Z::Complex(n2s/n0, lambda*a2s/n0/_2PI));
-    _ms1.assign(cos(gs*L1), sin(gs*L1)/gs, -gs*sin(gs*L1), cos(gs*L1));
-    _ms2.assign(cos(gs*L2), sin(gs*L2)/gs, -gs*sin(gs*L2), cos(gs*L2));
+    m.ms1.assign(cos(gs*L1), sin(gs*L1)/gs, -gs*sin(gs*L1), cos(gs*L1));
+    m.ms2.assign(cos(gs*L2), sin(gs*L2)/gs, -gs*sin(gs*L2), cos(gs*L2));
 }
 
 //------------------------------------------------------------------------------
@@ -1411,40 +1520,40 @@ ElemGaussDuctSlab::ElemGaussDuctSlab() : ElementRange() {
     setOption(Element_Complex);
 }
 
-void ElemGaussDuctSlab::calcMatrixInternal() {
-    const double L = lengthSI();
-    const double n0 = ior();
-    const double wl = _lambda->value().toSi();
-    const double n2t = _ior2t->value().toSi();
-    const double n2s = _ior2s->value().toSi();
-    const double a2t = _alpha2t->value().toSi();
-    const double a2s = _alpha2s->value().toSi();
+void ElemGaussDuctSlab::calcMatrixKernel(const double* p, Z::KernelMatrices& m) {
+    const double L = p[0];
+    const double n0 = p[1];
+    const double wl = p[2];
+    const double n2t = p[3];
+    const double n2s = p[4];
+    const double a2t = p[5];
+    const double a2s = p[6];
 
     const Z::Complex gt = sqrt(Z::Complex(n2t/n0, wl*a2t/n0/_2PI));
-    _mt.assign(cos(gt*L), sin(gt*L)/gt/n0, -gt*n0*sin(gt*L), cos(gt*L));
+    m.mt.assign(cos(gt*L), sin(gt*L)/gt/n0, -gt*n0*sin(gt*L), cos(gt*L));
 
     const Z::Complex gs = sqrt(Z::Complex(n2s/n0, wl*a2s/n0/_2PI));
-    _ms.assign(cos(gs*L), sin(gs*L)/gs/n0, -gs*n0*sin(gs*L), cos(gs*L));
+    m.ms.assign(cos(gs*L), sin(gs*L)/gs/n0, -gs*n0*sin(gs*L), cos(gs*L));
 
-    _mt_inv = _mt;
-    _ms_inv = _ms;
+    m.mt_inv = m.mt;
+    m.ms_inv = m.ms;
 }
 
-void ElemGaussDuctSlab::calcSubmatrices() {
-    const double L1 = _subRangeSI;
-    const double L2 = lengthSI() - L1;
-    const double n0 = ior();
-    const double lambda = _lambda->value().toSi();
-    const double n2t = _ior2t->value().toSi();
-    const double n2s = _ior2s->value().toSi();
-    const double a2t = _alpha2t->value().toSi();
-    const double a2s = _alpha2s->value().toSi();
+void ElemGaussDuctSlab::calcSubmatricesKernel(const double* p, double subRangeSI, Z::KernelMatrices& m) {
+    const double L1 = subRangeSI;
+    const double L2 = p[0] - L1;
+    const double n0 = p[1];
+    const double lambda = p[2];
+    const double n2t = p[3];
+    const double n2s = p[4];
+    const double a2t = p[5];
+    const double a2s = p[6];
 
     const Z::Complex gt = sqrt(Z::Complex(n2t/n0, lambda*a2t/n0/_2PI));
-    _mt1.assign(cos(gt*L1), sin(gt*L1)/gt/n0, -gt*sin(gt*L1), cos(gt*L1)/n0);
-    _mt2.assign(cos(gt*L2), sin(gt*L2)/gt, -gt*n0*sin(gt*L2), cos(gt*L2)*n0);
+    m.mt1.assign(cos(gt*L1), sin(gt*L1)/gt/n0, -gt*sin(gt*L1), cos(gt*L1)/n0);
+    m.mt2.assign(cos(gt*L2), sin(gt*L2)/gt, -gt*n0*sin(gt*L2), cos(gt*L2)*n0);
 
     const Z::Complex gs = sqrt(Z::Complex(n2s/n0, lambda*a2s/n0/_2PI));
-    _ms1.assign(cos(gs*L1), sin(gs*L1)/gs/n0, -gs*sin(gs*L1), cos(gs*L1)/n0);
-    _ms2.assign(cos(gs*L2), sin(gs*L2)/gs, -gs*n0*sin(gs*L2), cos(gs*L2)*n0);
+    m.ms1.assign(cos(gs*L1), sin(gs*L1)/gs/n0, -gs*sin(gs*L1), cos(gs*L1)/n0);
+    m.ms2.assign(cos(gs*L2), sin(gs*L2)/gs, -gs*n0*sin(gs*L2), cos(gs*L2)*n0);
 }
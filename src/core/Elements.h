@@ -8,8 +8,7 @@
 DECLARE_ELEMENT(ElemEmptyRange, ElementRange)
     TYPE_NAME(qApp->translate("Elements", "Empty space"))
     DEFAULT_LABEL("d")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -18,8 +17,7 @@ DECLARE_ELEMENT(ElemMediumRange, ElementRange)
     ElemMediumRange();
     TYPE_NAME(qApp->translate("Elements", "Space filled with medium"))
     DEFAULT_LABEL("d")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -28,8 +26,7 @@ DECLARE_ELEMENT(ElemPlate, ElementRange)
     ElemPlate();
     TYPE_NAME(qApp->translate("Elements", "Plate of matter"))
     DEFAULT_LABEL("G")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -38,6 +35,7 @@ DECLARE_ELEMENT(ElemFlatMirror, Element)
     ElemFlatMirror();
     TYPE_NAME(qApp->translate("Elements", "Flat mirror"))
     DEFAULT_LABEL("M")
+    MATRIX_KERNEL
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -46,7 +44,7 @@ DECLARE_ELEMENT(ElemCurveMirror, Element)
     ElemCurveMirror();
     TYPE_NAME(qApp->translate("Elements", "Spherical mirror"))
     DEFAULT_LABEL("M")
-    CALC_MATRIX
+    MATRIX_KERNEL
     //CHECK_PARAM
     double radius() const { return _radius->value().toSi(); }
     double alpha() const { return _alpha->value().toSi(); }
@@ -60,7 +58,7 @@ DECLARE_ELEMENT(ElemThinLens, Element)
     ElemThinLens();
     TYPE_NAME(qApp->translate("Elements", "Thin lens"))
     DEFAULT_LABEL("F")
-    CALC_MATRIX
+    MATRIX_KERNEL
     //CHECK_PARAM
     double focus() const { return _focus->value().toSi(); }
     double alpha() const { return _alpha->value().toSi(); }
@@ -73,7 +71,7 @@ DECLARE_ELEMENT_END
 DECLARE_ELEMENT(ElemCylinderLensT, ElemThinLens)
     TYPE_NAME(qApp->translate("Elements", "Thin cylindrical tangential lens"))
     DEFAULT_LABEL("F")
-    CALC_MATRIX
+    MATRIX_KERNEL
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -81,7 +79,7 @@ DECLARE_ELEMENT_END
 DECLARE_ELEMENT(ElemCylinderLensS, ElemThinLens)
     TYPE_NAME(qApp->translate("Elements", "Thin cylindrical sagittal lens"))
     DEFAULT_LABEL("F")
-    CALC_MATRIX
+    MATRIX_KERNEL
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -90,8 +88,7 @@ DECLARE_ELEMENT(ElemTiltedCrystal, ElementRange)
     ElemTiltedCrystal();
     TYPE_NAME(qApp->translate("Elements", "Tilted plane-parallel crystal"))
     DEFAULT_LABEL("G")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
     double alpha() const { return _alpha->value().toSi(); }
 protected:
     Z::Parameter *_alpha;
@@ -102,8 +99,7 @@ DECLARE_ELEMENT_END
 DECLARE_ELEMENT(ElemTiltedPlate, ElemTiltedCrystal)
     TYPE_NAME(qApp->translate("Elements", "Tilted plane-parallel plate"))
     DEFAULT_LABEL("G")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
     AXIS_LEN
 DECLARE_ELEMENT_END
 
@@ -113,8 +109,7 @@ DECLARE_ELEMENT(ElemBrewsterCrystal, ElementRange)
     ElemBrewsterCrystal();
     TYPE_NAME(qApp->translate("Elements", "Brewster plane-parallel crystal"))
     DEFAULT_LABEL("G")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -123,8 +118,7 @@ DECLARE_ELEMENT(ElemBrewsterPlate, ElementRange)
     ElemBrewsterPlate();
     TYPE_NAME(qApp->translate("Elements", "Brewster plane-parallel plate"))
     DEFAULT_LABEL("G")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
     AXIS_LEN
 DECLARE_ELEMENT_END
 
@@ -134,7 +128,7 @@ DECLARE_ELEMENT(ElemMatrix, Element)
     ElemMatrix();
     TYPE_NAME(qApp->translate("Elements", "Matrix element (T&S)"))
     DEFAULT_LABEL("C")
-    CALC_MATRIX
+    MATRIX_KERNEL
     void setMatrixT(const double& a, const double& b, const double& c, const double& d) { setMatrix(0, a, b, c, d); }
     void setMatrixS(const double& a, const double& b, const double& c, const double& d) { setMatrix(4, a, b, c, d); }
     Z::Parameter* paramAt() const { return _At; }
@@ -156,7 +150,7 @@ DECLARE_ELEMENT(ElemMatrix1, Element)
     ElemMatrix1();
     TYPE_NAME(qApp->translate("Elements", "Matrix element (T=S)"))
     DEFAULT_LABEL("C")
-    CALC_MATRIX
+    MATRIX_KERNEL
     void setMatrix(const double& a, const double& b, const double& c, const double& d);
 DECLARE_ELEMENT_END
 
@@ -166,6 +160,7 @@ DECLARE_ELEMENT(ElemPoint, Element)
     ElemPoint();
     TYPE_NAME(qApp->translate("Elements", "Point"))
     DEFAULT_LABEL("P")
+    MATRIX_KERNEL
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -173,7 +168,7 @@ DECLARE_ELEMENT_END
 DECLARE_ELEMENT(ElemNormalInterface, ElementInterface)
     TYPE_NAME(qApp->translate("Elements", "Normal interface"))
     DEFAULT_LABEL("s")
-    CALC_MATRIX
+    MATRIX_KERNEL
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -181,7 +176,7 @@ DECLARE_ELEMENT_END
 DECLARE_ELEMENT(ElemBrewsterInterface, ElementInterface)
     TYPE_NAME(qApp->translate("Elements", "Brewster interface"))
     DEFAULT_LABEL("s")
-    CALC_MATRIX
+    MATRIX_KERNEL
 DECLARE_ELEMENT_END
 
 //------------------------------------------------------------------------------
@@ -190,7 +185,7 @@ DECLARE_ELEMENT(ElemTiltedInterface, ElementInterface)
     ElemTiltedInterface();
     TYPE_NAME(qApp->translate("Elements", "Tilted interface"))
     DEFAULT_LABEL("s")
-    CALC_MATRIX
+    MATRIX_KERNEL
     double alpha() const { return _alpha->value().toSi(); }
 protected:
     Z::Parameter *_alpha;
@@ -202,7 +197,7 @@ DECLARE_ELEMENT(ElemSphericalInterface, ElementInterface)
     ElemSphericalInterface();
     TYPE_NAME(qApp->translate("Elements", "Spherical interface"))
     DEFAULT_LABEL("s")
-    CALC_MATRIX
+    MATRIX_KERNEL
     double radius() const { return _radius->value().toSi(); }
     QList<QPair<Z::Parameter*, Z::Parameter*>> flip() override;
 private:
@@ -215,8 +210,7 @@ DECLARE_ELEMENT(ElemThickLens, ElementRange)
     ElemThickLens();
     TYPE_NAME(qApp->translate("Elements", "Thick lens"))
     DEFAULT_LABEL("F")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
     double radius1() const { return _radius1->value().toSi(); }
     double radius2() const { return _radius2->value().toSi(); }
     QList<QPair<Z::Parameter*, Z::Parameter*>> flip() override;
@@ -230,8 +224,7 @@ DECLARE_ELEMENT(ElemGrinLens, ElementRange)
     ElemGrinLens();
     TYPE_NAME(qApp->translate("Elements", "GRIN lens"))
     DEFAULT_LABEL("GL")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
     double ior2t() const { return _ior2t->value().value(); }
     double ior2s() const { return _ior2s->value().value(); }
     Z::Parameter* paramIor2t() const { return _ior2t; }
@@ -246,8 +239,7 @@ DECLARE_ELEMENT(ElemGrinMedium, ElemMediumRange)
     ElemGrinMedium();
     TYPE_NAME(qApp->translate("Elements", "GRIN medium"))
     DEFAULT_LABEL("GM")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
     double ior2t() const { return _ior2t->value().value(); }
     double ior2s() const { return _ior2s->value().value(); }
     Z::Parameter* paramIor2t() const { return _ior2t; }
@@ -262,6 +254,7 @@ DECLARE_ELEMENT(ElemThermoLens, ElementRange)
     ElemThermoLens();
     TYPE_NAME(qApp->translate("Elements", "Thermal lens"))
     DEFAULT_LABEL("TL")
+    MATRIX_KERNEL_SUB_RANGE
     CALC_MATRIX
     SUB_RANGE
     double focus() const { return _focus->value().toSi(); }
@@ -276,6 +269,7 @@ DECLARE_ELEMENT(ElemThermoMedium, ElemMediumRange)
     ElemThermoMedium();
     TYPE_NAME(qApp->translate("Elements", "Thermal medium"))
     DEFAULT_LABEL("TM")
+    MATRIX_KERNEL_SUB_RANGE
     CALC_MATRIX
     SUB_RANGE
     double focus() const { return _focus->value().toSi(); }
@@ -317,7 +311,7 @@ DECLARE_ELEMENT(ElemGaussAperture, Element)
     ElemGaussAperture();
     TYPE_NAME(qApp->translate("Elements", "Gaussian aperture"))
     DEFAULT_LABEL("GA")
-    CALC_MATRIX
+    MATRIX_KERNEL
 protected:
     Z::Parameter *_lambda, *_alpha2t, *_alpha2s;
 DECLARE_ELEMENT_END
@@ -328,7 +322,7 @@ DECLARE_ELEMENT(ElemGaussApertureLens, Element)
     ElemGaussApertureLens();
     TYPE_NAME(qApp->translate("Elements", "Gaussian aperture with thin lens"))
     DEFAULT_LABEL("GA")
-    CALC_MATRIX
+    MATRIX_KERNEL
     double focusT() const { return _focusT->value().toSi(); }
 protected:
     Z::Parameter *_lambda, *_focusT, *_focusS, *_alpha2t, *_alpha2s;
@@ -340,8 +334,7 @@ DECLARE_ELEMENT(ElemGaussDuctMedium, ElementRange)
     ElemGaussDuctMedium();
     TYPE_NAME(qApp->translate("Elements", "Gaussian duct (medium)"))
     DEFAULT_LABEL("GD")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
 protected:
     Z::Parameter *_lambda;
     Z::Parameter *_ior2t, *_ior2s;
@@ -354,8 +347,7 @@ DECLARE_ELEMENT(ElemGaussDuctSlab, ElementRange)
     ElemGaussDuctSlab();
     TYPE_NAME(qApp->translate("Elements", "Gaussian duct (slab)"))
     DEFAULT_LABEL("GD")
-    CALC_MATRIX
-    SUB_RANGE
+    MATRIX_KERNEL_SUB_RANGE
 protected:
     Z::Parameter *_lambda;
     Z::Parameter *_ior2t, *_ior2s;
@@ -0,0 +1,328 @@
+#include "Expression.h"
+
+#include <QtMath>
+#include <QVarLengthArray>
+
+#include <cmath>
+#include <limits>
+
+namespace Z {
+
+namespace {
+
+typedef double (*ExprFunc)(double);
+
+// The same functions and implementations as global functions of Z::Lua
+const QMap<QString, ExprFunc>& exprFuncs()
+{
+    static QMap<QString, ExprFunc> funcs {
+        { "sin", [](double x){ return qSin(x); } },
+        { "sinh", [](double x){ return sinh(x); } },
+        { "asin", [](double x){ return qAsin(x); } },
+        { "cos", [](double x){ return qCos(x); } },
+        { "cosh", [](double x){ return cosh(x); } },
+        { "acos", [](double x){ return qAcos(x); } },
+        { "tan", [](double x){ return qTan(x); } },
+        { "tanh", [](double x){ return tanh(x); } },
+        { "atan", [](double x){ return qAtan(x); } },
+        { "cot", [](double x){ return 1.0 / qTan(x); } },
+        { "coth", [](double x){ return 1.0 / tanh(x); } },
+        { "acot", [](double x){ return qAtan(1.0 / x); } },
+        { "sec", [](double x){ return 1.0 / qCos(x); } },
+        { "sech", [](double x){ return 1.0 / cosh(x); } },
+        { "csc", [](double x){ return 1.0 / qSin(x); } },
+        { "csch", [](double x){ return 1.0 / sinh(x); } },
+        { "abs", [](double x){ return qAbs(x); } },
+        { "floor", [](double x){ return double(qFloor(x)); } },
+        { "ceil", [](double x){ return double(qCeil(x)); } },
+        { "exp", [](double x){ return qExp(x); } },
+        { "ln", [](double x){ return qLn(x); } },
+        { "lg", [](double x){ return log10(x); } },
+        { "sqrt", [](double x){ return qSqrt(x); } },
+        { "deg2rad", [](double x){ return qDegreesToRadians(x); } },
+        { "rad2deg", [](double x){ return qRadiansToDegrees(x); } },
+    };
+    return funcs;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+//                              ExpressionCompiler
+//------------------------------------------------------------------------------
+
+/**
+    Recursive descent parser producing the bytecode for a stack machine.
+    Grammar follows the Lua operator precedence:
+
+        expr    := term (('+'|'-') term)*
+        term    := unary (('*'|'/') unary)*
+        unary   := '-' unary | power
+        power   := primary ('^' unary)?
+        primary := number | var | func '(' expr ')' | 'pi' '(' ')' | '(' expr ')'
+
+    So `-a^b` is `-(a^b)`, `a^b^c` is `a^(b^c)`, and `a^-b` is allowed.
+*/
+class ExpressionCompiler
+{
+public:
+    ExpressionCompiler(const QString& code, const QMap<QString, const double*>& vars, Expression& expr):
+        _s(code), _vars(vars), _expr(expr) {}
+
+    bool compile()
+    {
+        // Double minus starts a comment in Lua
+        if (_s.contains(QStringLiteral("--")))
+            return false;
+        if (!parseExpr())
+            return false;
+        skipSpaces();
+        return _pos == _s.size();
+    }
+
+private:
+    const QString& _s;
+    const QMap<QString, const double*>& _vars;
+    Expression& _expr;
+    int _pos = 0;
+    int _depth = 0;
+
+    void emit(Expression::OpCode op, double value = 0, const double *var = nullptr, ExprFunc func = nullptr)
+    {
+        _expr._code.append({ op, value, var, func });
+        switch (op)
+        {
+        case Expression::PUSH_CONST:
+        case Expression::PUSH_VAR:
+            _depth++;
+            _expr._stackSize = qMax(_expr._stackSize, _depth);
+            break;
+        case Expression::ADD:
+        case Expression::SUB:
+        case Expression::MUL:
+        case Expression::DIV:
+        case Expression::POW:
+            _depth--;
+            break;
+        case Expression::NEG:
+        case Expression::CALL:
+            break;
+        }
+    }
+
+    void skipSpaces()
+    {
+        while (_pos < _s.size() && _s.at(_pos).isSpace())
+            _pos++;
+    }
+
+    bool takeChar(QChar c)
+    {
+        skipSpaces();
+        if (_pos < _s.size() && _s.at(_pos) == c)
+        {
+            _pos++;
+            return true;
+        }
+        return false;
+    }
+
+    static bool isIdentChar(QChar c)
+    {
+        return c.isLetterOrNumber() || c == '_';
+    }
+
+    bool parseExpr()
+    {
+        if (!parseTerm()) return false;
+        while (true)
+        {
+            if (takeChar('+'))
+            {
+                if (!parseTerm()) return false;
+                emit(Expression::ADD);
+            }
+            else if (takeChar('-'))
+            {
+                if (!parseTerm()) return false;
+                emit(Expression::SUB);
+            }
+            else return true;
+        }
+    }
+
+    bool parseTerm()
+    {
+        if (!parseUnary()) return false;
+        while (true)
+        {
+            if (takeChar('*'))
+            {
+                if (!parseUnary()) return false;
+                emit(Expression::MUL);
+            }
+            else if (takeChar('/'))
+            {
+                // Integer division is not supported
+                if (_pos < _s.size() && _s.at(_pos) == '/') return false;
+                if (!parseUnary()) return false;
+                emit(Expression::DIV);
+            }
+            else return true;
+        }
+    }
+
+    bool parseUnary()
+    {
+        if (takeChar('-'))
+        {
+            if (!parseUnary()) return false;
+            emit(Expression::NEG);
+            return true;
+        }
+        return parsePower();
+    }
+
+    bool parsePower()
+    {
+        if (!parsePrimary()) return false;
+        if (takeChar('^'))
+        {
+            if (!parseUnary()) return false;
+            emit(Expression::POW);
+        }
+        return true;
+    }
+
+    bool parsePrimary()
+    {
+        skipSpaces();
+        if (_pos >= _s.size())
+            return false;
+
+        if (takeChar('('))
+            return parseExpr() && takeChar(')');
+
+        QChar c = _s.at(_pos);
+        if (c.isDigit() || (c == '.' && _pos+1 < _s.size() && _s.at(_pos+1).isDigit()))
+            return parseNumber();
+
+        if (c.isLetter() || c == '_')
+            return parseName();
+
+        return false;
+    }
+
+    bool parseNumber()
+    {
+        int start = _pos;
+        while (_pos < _s.size() && _s.at(_pos).isDigit()) _pos++;
+        if (_pos < _s.size() && _s.at(_pos) == '.')
+        {
+            _pos++;
+            while (_pos < _s.size() && _s.at(_pos).isDigit()) _pos++;
+        }
+        if (_pos < _s.size() && (_s.at(_pos) == 'e' || _s.at(_pos) == 'E'))
+        {
+            _pos++;
+            if (_pos < _s.size() && (_s.at(_pos) == '+' || _s.at(_pos) == '-')) _pos++;
+            int expStart = _pos;
+            while (_pos < _s.size() && _s.at(_pos).isDigit()) _pos++;
+            if (_pos == expStart) return false;
+        }
+        // Hexadecimal or malformed numbers are left to Lua
+        if (_pos < _s.size() && (isIdentChar(_s.at(_pos)) || _s.at(_pos) == '.'))
+            return false;
+
+        bool ok;
+        double value = _s.mid(start, _pos - start).toDouble(&ok);
+        if (!ok) return false;
+        emit(Expression::PUSH_CONST, value);
+        return true;
+    }
+
+    bool parseName()
+    {
+        int start = _pos;
+        while (_pos < _s.size() && isIdentChar(_s.at(_pos))) _pos++;
+        QString name = _s.mid(start, _pos - start);
+
+        auto var = _vars.constFind(name);
+
+        if (takeChar('('))
+        {
+            // Lua would fail trying to call a variable
+            if (var != _vars.constEnd())
+                return false;
+
+            if (name == QLatin1String("pi"))
+            {
+                if (!takeChar(')')) return false;
+                emit(Expression::PUSH_CONST, M_PI);
+                return true;
+            }
+
+            auto func = exprFuncs().constFind(name);
+            if (func == exprFuncs().constEnd())
+                return false;
+            if (!parseExpr() || !takeChar(')'))
+                return false;
+            emit(Expression::CALL, 0, nullptr, func.value());
+            return true;
+        }
+
+        if (var != _vars.constEnd())
+        {
+            emit(Expression::PUSH_VAR, 0, var.value());
+            return true;
+        }
+
+        if (name == QLatin1String("inf") || name == QLatin1String("Inf") || name == QLatin1String("INF"))
+        {
+            emit(Expression::PUSH_CONST, std::numeric_limits<double>::infinity());
+            return true;
+        }
+
+        return false;
+    }
+};
+
+//------------------------------------------------------------------------------
+//                                 Expression
+//------------------------------------------------------------------------------
+
+bool Expression::compile(const QString& code, const QMap<QString, const double*>& vars)
+{
+    _code.clear();
+    _stackSize = 0;
+    if (!ExpressionCompiler(code, vars, *this).compile())
+    {
+        _code.clear();
+        return false;
+    }
+    return true;
+}
+
+double Expression::eval() const
+{
+    QVarLengthArray<double, 16> stack(_stackSize);
+    int top = -1;
+    for (const auto& instr : _code)
+    {
+        switch (instr.op)
+        {
+        case PUSH_CONST: stack[++top] = instr.value; break;
+        case PUSH_VAR: stack[++top] = *instr.var; break;
+        case NEG: stack[top] = -stack[top]; break;
+        case ADD: top--; stack[top] += stack[top+1]; break;
+        case SUB: top--; stack[top] -= stack[top+1]; break;
+        case MUL: top--; stack[top] *= stack[top+1]; break;
+        case DIV: top--; stack[top] /= stack[top+1]; break;
+        case POW: top--; stack[top] = std::pow(stack[top], stack[top+1]); break;
+        case CALL: stack[top] = instr.func(stack[top]); break;
+        }
+    }
+    return stack[0];
+}
+
+} // namespace Z
@@ -0,0 +1,53 @@
+#ifndef Z_EXPRESSION_H
+#define Z_EXPRESSION_H
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+namespace Z {
+
+/**
+    Simple arithmetic expression compiled into a bytecode for fast evaluation without Lua.
+
+    Only a subset of formula syntax is supported: a single expression of numbers,
+    variables, operators `+ - * / ^`, parentheses, and global functions of formulas
+    (@see Z::Lua::registerGlobalFuncs). Operators have the same precedence and associativity
+    as in Lua, so the compiled expression gives the same result as Lua would.
+    Code not fitting into the subset is not compiled and should be calculated by Lua.
+
+    Variables are bound by pointers to their values,
+    so the expression can be evaluated many times with changed values without recompiling.
+*/
+class Expression
+{
+public:
+    /// Compiles the code if it fits the supported subset.
+    /// Returns false if the code can't be compiled natively.
+    bool compile(const QString& code, const QMap<QString, const double*>& vars);
+
+    bool isValid() const { return !_code.isEmpty(); }
+    void clear() { _code.clear(); }
+
+    double eval() const;
+
+private:
+    enum OpCode { PUSH_CONST, PUSH_VAR, NEG, ADD, SUB, MUL, DIV, POW, CALL };
+
+    struct Instr
+    {
+        OpCode op;
+        double value;
+        const double *var;
+        double (*func)(double);
+    };
+
+    QVector<Instr> _code;
+    int _stackSize = 0;
+
+    friend class ExpressionCompiler;
+};
+
+} // namespace Z
+
+#endif // Z_EXPRESSION_H
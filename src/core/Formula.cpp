@@ -1,10 +1,14 @@
 #include "Formula.h"
+#include "Element.h"
 #include "Protocol.h"
 #include "LuaHelper.h"
 
 #include <QApplication>
 #include <QHash>
 #include <QRegularExpression>
+#include <QSet>
+
+#include <memory>
 
 namespace Z {
 
@@ -26,62 +30,124 @@ bool Formula::prepare(Parameters& availableDeps)
     return false;
 }
 
-void Formula::setError(const QString &error)
+void Formula::setError(const QString &error, bool notify)
 {
     _error = error;
+    if (!notify)
+    {
+        // Sweep mode reports errors itself when the sweep ends
+        _target->setRawError(_error);
+        return;
+    }
     _target->setError(_error);
     Z_ERROR(QString("Bad formula for param '%1': %2").arg(_target->alias(), _error))
 }
 
-void Formula::calculate()
+void Formula::calculate(bool notify)
 {
     if (_code.isEmpty())
     {
-        setError(qApp->translate("Formula", "Formula is empty"));
+        setError(qApp->translate("Formula", "Formula is empty"), notify);
         return;
     }
     
     for (auto dep : std::as_const(_deps))
         if (dep->failed()) {
             setError(qApp->translate("Formula", "Dependency parameter %1 failed: %2")
-                .arg(dep->displayLabel(), dep->error()));
+                .arg(dep->displayLabel(), dep->error()), notify);
             return;
         }
 
-    Z::Lua lua;
-    QString err = lua.open();
-    if (!err.isEmpty())
+    if (!_compiled)
+        compile();
+
+    double valueSi;
+    if (_expr.isValid())
     {
-        setError(err);
-        return;
+        for (int i = 0; i < _deps.size(); i++)
+            _depValues[i] = _deps.at(i)->value().toSi();
+        valueSi = _expr.eval();
     }
+    else
+    {
+        Z::Lua lua;
+        QString err = lua.open();
+        if (!err.isEmpty())
+        {
+            setError(err, notify);
+            return;
+        }
 
-    for (auto dep : std::as_const(_deps))
-        lua.setGlobalVar(dep->alias(), dep->value().toSi());
+        for (auto dep : std::as_const(_deps))
+            lua.setGlobalVar(dep->alias(), dep->value().toSi());
 
-    auto res = lua.calculate(_code);
-    if (!res.ok())
-    {
-        setError(res.error());
-        return;
+        auto res = lua.calculate(_code);
+        if (!res.ok())
+        {
+            setError(res.error(), notify);
+            return;
+        }
+        valueSi = res.value();
     }
 
     auto unit = _target->value().unit();
-    auto value = unit->fromSi(res.value());
-    _target->setValue(Value(value, unit));
+    auto value = unit->fromSi(valueSi);
+    if (notify)
+        _target->setValue(Value(value, unit));
+    else
+    {
+        _target->setRawValue(Value(value, unit));
+        _target->setRawError(QString());
+    }
     _error.clear();
 }
 
+void Formula::compile()
+{
+    _depValues.resize(_deps.size());
+    QMap<QString, const double*> vars;
+    for (int i = 0; i < _deps.size(); i++)
+        vars[_deps.at(i)->alias()] = &_depValues[i];
+    _expr.compile(_code, vars);
+    _compiled = true;
+}
+
+bool Formula::isNative()
+{
+    if (!_compiled)
+        compile();
+    return _expr.isValid();
+}
+
+void Formula::depChanged(ParameterBase* param)
+{
+    if (!_owner)
+    {
+        calculate();
+        return;
+    }
+    for (auto dep : std::as_const(_deps))
+        if (dep == param)
+        {
+            _owner->depChanged(this, dep);
+            return;
+        }
+}
+
 void Formula::addDep(Parameter* param)
 {
     _deps.append(param);
     param->addListener(this);
+    _compiled = false;
+    if (_owner) _owner->invalidateGraph();
 }
 
 void Formula::removeDep(Parameter* param)
 {
     param->removeListener(this);
     _deps.removeAll(param);
+    _compiled = false;
+    if (_owner) _owner->invalidateGraph();
 }
 
 void Formula::assignDeps(const Formula *formula)
@@ -128,6 +194,7 @@ bool Formula::renameDep(Parameter *param, const QString &newName)
         if (prevOffset < _code.length())
             s << _code.mid(prevOffset);
         _code = newCode;
+        _compiled = false;
     }
     return depFound;
 }
@@ -179,6 +246,8 @@ void Formulas::put(Formula* f)
             delete _items[p];
     }
     _items[p] = f;
+    f->_owner = this;
+    invalidateGraph();
 }
 
 Formula* Formulas::get(Parameter* p)
@@ -198,6 +267,7 @@ void Formulas::free(Parameter *p)
         auto f = _items[p];
         _items.remove(p);
         delete f;
+        invalidateGraph();
     }
 }
 
@@ -205,6 +275,7 @@ void Formulas::clear()
 {
     qDeleteAll(_items);
     _items.clear();
+    invalidateGraph();
 }
 
 bool Formulas::dependsOn(Parameter *whichParam, const QString &onParam) const
@@ -256,6 +327,113 @@ bool Formulas::renameDependency(Parameter *param, const QString &newName)
     return depFound;
 }
 
+void Formulas::updateGraph() const
+{
+    if (_graphValid) return;
+
+    _dependents.clear();
+    for (auto it = _items.cbegin(); it != _items.cend(); it++)
+    {
+        auto formula = it.value();
+        for (auto dep : formula->deps())
+            _dependents[dep] << formula;
+    }
+    _graphValid = true;
+}
+
+QVector<Formula*> Formulas::dependentFormulas(Parameter *param) const
+{
+    updateGraph();
+
+    QVector<Formula*> reachable;
+    QSet<Formula*> visited;
+    QVector<Parameter*> stack { param };
+    while (!stack.isEmpty())
+    {
+        auto p = stack.takeLast();
+        for (auto formula : _dependents.value(p))
+            if (!visited.contains(formula))
+            {
+                visited.insert(formula);
+                reachable << formula;
+                stack << formula->target();
+            }
+    }
+
+    // Kahn's algorithm: a formula is ready when all its dependencies
+    // calculated by other reachable formulas are already in the result
+    QHash<Formula*, int> pendingDeps;
+    QVector<Formula*> ready;
+    for (auto formula : std::as_const(reachable))
+    {
+        int count = 0;
+        for (auto dep : formula->deps())
+            if (auto depFormula = _items.value(dep); depFormula && visited.contains(depFormula))
+                count++;
+        if (count == 0)
+            ready << formula;
+        else
+            pendingDeps[formula] = count;
+    }
+
+    QVector<Formula*> result;
+    while (!ready.isEmpty())
+    {
+        auto formula = ready.takeFirst();
+        result << formula;
+        for (auto dependent : _dependents.value(formula->target()))
+        {
+            auto it = pendingDeps.find(dependent);
+            if (it != pendingDeps.end() && --it.value() == 0)
+                ready << dependent;
+        }
+    }
+    if (result.size() < reachable.size())
+        qWarning() << "Formulas::dependentFormulas: circular dependency found for parameter" << param->alias();
+    return result;
+}
+
+void Formulas::calculate(Parameter *param)
+{
+    auto formulas = dependentFormulas(param);
+    if (formulas.isEmpty()) return;
+
+    // Elements are notified each time when any of formula targets changes,
+    // but their matrices are recalculated only once when lockers are released
+    QSet<Element*> elems;
+    std::vector<std::unique_ptr<ElementMatrixLocker>> lockers;
+    for (auto formula : std::as_const(formulas))
+        for (auto elem : Z::Utils::dependentElements(formula->target()))
+            if (!elems.contains(elem))
+            {
+                elems.insert(elem);
+                lockers.emplace_back(new ElementMatrixLocker(elem, "Formulas::calculate"));
+            }
+
+    bool wasCalculating = _calculating;
+    _calculating = true;
+    for (auto formula : std::as_const(formulas))
+        formula->calculate();
+    _calculating = wasCalculating;
+}
+
+void Formulas::depChanged(Formula *formula, Parameter *param)
+{
+    // Formulas depending on targets of other formulas are notified during calculation,
+    // but they already are in the list of formulas being calculated in proper order
+    if (_calculating && _items.contains(param)) return;
+
+    // The parameter notifies its listeners one by one,
+    // only the first formula starts calculation of all the dependent formulas
+    for (auto listener : param->listeners())
+        if (auto f = dynamic_cast<Formula*>(listener); f && f->_owner == this)
+        {
+            if (f == formula)
+                calculate(param);
+            return;
+        }
+}
+
 //------------------------------------------------------------------------------
 
 namespace FormulaUtils {
@@ -1,12 +1,16 @@
 #ifndef FORMULA_H
 #define FORMULA_H
 
+#include "Expression.h"
 #include "Parameters.h"
 
+#include <QHash>
 #include <QMap>
 
 namespace Z {
 
+class Formulas;
+
 /**
     Formula can calculate an expression given as a string and assign the result to the target parameter.
     It can have other parameters as dependencies and use their names in the expression.
@@ -18,17 +22,21 @@ public:
     ~Formula() override;
 
     bool prepare(Parameters &availableDeps);
-    void calculate();
+
+    /// Calculates the expression and assigns the result to the target parameter.
+    /// When @a notify is false, the value is assigned without notification of the target's listeners,
+    /// it's used in sweep mode (@see ParamSweep) where dependent parameters are updated explicitly.
+    void calculate(bool notify = true);
 
     Parameter* target() { return _target; }
     const Z::Parameters& deps() { return _deps; }
 
     const QString& code() const { return _code; }
-    void setCode(const QString& code) { _code = code; }
+    void setCode(const QString& code) { _code = code; _compiled = false; }
 
     bool ok() const { return _error.isEmpty(); }
     const QString& error() const { return _error; }
-    void setError(const QString &error);
+    void setError(const QString &error, bool notify = true);
 
     void addDep(Parameter* param);
     void removeDep(Parameter* param);
@@ -41,23 +49,46 @@ public:
     /// Scan function code for names and update dependencies list
     QString findDeps(const Parameters &globalParams, std::function<bool(Parameter*,const QString&)> isDependOn);
 
-    void parameterChanged(ParameterBase*) override { calculate(); }
-    void parameterFailed(ParameterBase*) override { calculate(); }
+    void parameterChanged(ParameterBase* param) override { depChanged(param); }
+    void parameterFailed(ParameterBase* param) override { depChanged(param); }
     
     
     QString displayStr() const;
 
+    /// Returns true if the formula code is compiled into native expression and it's calculated without Lua.
+    bool isNative();
+
 private:
     Parameter* _target;
     Parameters _deps;
     QString _code;
     QString _error;
+    Formulas* _owner = nullptr;
+
+    // Simple arithmetic code is compiled into native expression once,
+    // it's recompiled when the code or dependencies change
+    Expression _expr;
+    QVector<double> _depValues;
+    bool _compiled = false;
+
+    void compile();
+
+    void depChanged(ParameterBase* param);
+
+    friend class Formulas;
 };
 
 //------------------------------------------------------------------------------
 
 /**
     Contains a set of @a Z::Formula instances and their mappings to target parameters.
+
+    Formulas put into the set don't recalculate themselves when their dependencies change.
+    Instead, the set recalculates all the formulas depending on the changed parameter,
+    directly or through other formulas, in the topological order of the dependency graph.
+    So each formula is calculated only once per change even when there are several paths
+    from the changed parameter to the formula (e.g. in a diamond of dependent parameters),
+    and matrices of elements using formula targets are recalculated only once, after all formulas.
 */
 class Formulas
 {
@@ -83,8 +114,27 @@ public:
     /// Returns true if the parameter is found in the code of a formula.
     bool renameDependency(Parameter *param, const QString &newName);
 
+    /// Returns all formulas depending on the specified parameter directly or through other formulas.
+    /// Formulas are sorted topologically, i.e. each formula goes after formulas calculating its dependencies.
+    QVector<Formula*> dependentFormulas(Parameter *param) const;
+
+    /// Recalculates all formulas depending on the specified parameter, each formula only once.
+    void calculate(Parameter *param);
+
 private:
     QMap<Parameter*, Formula*> _items;
+
+    /// Dependency graph: formulas using a parameter in their code.
+    /// It's rebuilt on demand after formulas or their dependencies changed.
+    mutable QHash<Parameter*, QVector<Formula*>> _dependents;
+    mutable bool _graphValid = false;
+    bool _calculating = false;
+
+    void depChanged(Formula *formula, Parameter *param);
+    void invalidateGraph() { _graphValid = false; }
+    void updateGraph() const;
+
+    friend class Formula;
 };
 
 //------------------------------------------------------------------------------
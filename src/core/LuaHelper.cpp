@@ -13,6 +13,8 @@ extern "C" {
 #include <lauxlib.h>
 }
 
+static_assert(Z::Lua::NO_REF == LUA_NOREF);
+
 #define RESULT_VAR "ans"
 #define FORMULA_ID "formula"
 
@@ -132,6 +134,7 @@ QString Lua::open()
 {
     if (_lua) lua_close(_lua);
 
+    _nameRefs.clear();
     _lua = luaL_newstate();
     if (!_lua)
         return qApp->translate("Formula", "Not enough memory to initialize formula parser");
@@ -287,4 +290,72 @@ void Lua::removeGlobalVar(const QString& name)
     lua_setglobal(_lua, name.toLatin1().data());
 }
 
+Z::Result<int> Lua::compile(const QString& code)
+{
+    QString error = setCode(code);
+    if (!error.isEmpty())
+    {
+        lua_pop(_lua, 1); // remove error message
+        return Z::Result<int>::fail(error);
+    }
+    // Move compiled chunk from the stack into the registry
+    return Z::Result<int>::success(luaL_ref(_lua, LUA_REGISTRYINDEX));
+}
+
+QString Lua::run(int codeRef)
+{
+    Q_ASSERT(_lua);
+
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, codeRef);
+    QString error = execute();
+    if (!error.isEmpty())
+        lua_pop(_lua, 1); // remove error message
+    return error;
+}
+
+void Lua::release(int codeRef)
+{
+    if (!_lua) return;
+
+    luaL_unref(_lua, LUA_REGISTRYINDEX, codeRef);
+}
+
+int Lua::nameRef(const QString& name)
+{
+    Q_ASSERT(_lua);
+
+    auto it = _nameRefs.constFind(name);
+    if (it != _nameRefs.constEnd())
+        return it.value();
+
+    lua_pushstring(_lua, name.toLatin1().data());
+    int ref = luaL_ref(_lua, LUA_REGISTRYINDEX);
+    _nameRefs.insert(name, ref);
+    return ref;
+}
+
+void Lua::setGlobalVar(int nameRef, double value)
+{
+    Q_ASSERT(_lua);
+
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, nameRef);
+    lua_pushnumber(_lua, value);
+    lua_rawset(_lua, -3);
+    lua_pop(_lua, 1); // remove global table
+}
+
+std::optional<double> Lua::getGlobalVar(int nameRef)
+{
+    Q_ASSERT(_lua);
+
+    std::optional<double> res;
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    lua_rawgeti(_lua, LUA_REGISTRYINDEX, nameRef);
+    if (lua_rawget(_lua, -2) == LUA_TNUMBER)
+        res = lua_tonumber(_lua, -1);
+    lua_pop(_lua, 2); // remove value and global table
+    return res;
+}
+
 } // namespace Z
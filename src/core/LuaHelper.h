@@ -3,12 +3,19 @@
 
 #include "CommonTypes.h"
 
+#include <QHash>
+
+#include <optional>
+
 struct lua_State;
 
 namespace Z {
 
 class Lua {
 public:
+    /// Value of invalid reference returned by compile() and nameRef() on failure.
+    enum { NO_REF = -2 };
+
     Lua();
     ~Lua();
 
@@ -23,10 +30,23 @@ public:
     void setGlobalVars(const QMap<QString, double>& vars);
     void removeGlobalVar(const QString& name);
 
+    /// Compiles the code once and keeps it in the Lua state.
+    /// The returned reference can be executed many times by run() without re-parsing the code.
+    Z::Result<int> compile(const QString& code);
+    QString run(int codeRef);
+    void release(int codeRef);
+
+    /// Returns a reference to the variable name interned in the Lua state.
+    /// Access to globals by references doesn't convert and hash the name string every time.
+    int nameRef(const QString& name);
+    void setGlobalVar(int nameRef, double value);
+    std::optional<double> getGlobalVar(int nameRef);
+
     static void registerGlobalFuncs(lua_State* lua);
 
 private:
     lua_State* _lua = nullptr;
+    QHash<QString, int> _nameRefs;
 
     QString getLuaError(int errCode) const;
     QString refineLuaError(const QString& err) const;
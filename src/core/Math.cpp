@@ -59,11 +59,51 @@ Complex Matrix::det() const
     return A * D - B * C;
 }
 
+Matrix Matrix::inverted() const
+{
+    Complex d = det();
+    return Matrix(D / d, -B / d, -C / d, A / d);
+}
+
 bool Matrix::isReal() const
 {
     return A.imag() == 0 && B.imag() == 0 && C.imag() == 0 && D.imag() == 0;
 }
 
+//------------------------------------------------------------------------------
+//                               MatrixReal
+//------------------------------------------------------------------------------
+
+void MatrixReal::operator *= (const MatrixReal &m)
+{
+    double a = A * m.A + B * m.C;
+    double b = A * m.B + B * m.D;
+    double c = C * m.A + D * m.C;
+    double d = C * m.B + D * m.D;
+    A = a; B = b; C = c; D = d;
+}
+
+void MatrixReal::operator *= (const Matrix *m)
+{
+    const double mA = m->A.real();
+    const double mB = m->B.real();
+    const double mC = m->C.real();
+    const double mD = m->D.real();
+    double a = A * mA + B * mC;
+    double b = A * mB + B * mD;
+    double c = C * mA + D * mC;
+    double d = C * mB + D * mD;
+    A = a; B = b; C = c; D = d;
+}
+
+void multMatrixArrayReal(const MatrixArray& matrs, Matrix& result)
+{
+    MatrixReal m;
+    for (const Matrix *matr : matrs)
+        m *= matr;
+    m.assignTo(result);
+}
+
 //------------------------------------------------------------------------------
 //                                RayVector
 //------------------------------------------------------------------------------
@@ -72,6 +72,9 @@ public:
     QString str() const;
 
     Complex det() const;
+
+    /// Inverse matrix, the matrix must not be singular.
+    Matrix inverted() const;
 };
 
 Matrix operator *(const Matrix &m1, const Matrix &m2);
@@ -80,6 +83,40 @@ typedef QVector<const Matrix*> MatrixArray;
 
 //------------------------------------------------------------------------------
 
+/**
+    The ABCD ray matrix having only real elements.
+
+    It is used as an accumulator when multiplying a chain of matrices
+    all of which are known to be real, e.g. round-trips without Gaussian apertures or ducts.
+    Only real parts of the multiplied complex matrices are taken into account
+    so the product is four times cheaper than the complex one.
+*/
+class MatrixReal
+{
+public:
+    double A, B, C, D;
+
+    MatrixReal() : A(1), B(0), C(0), D(1) {}
+    MatrixReal(double a, double b, double c, double d) : A(a), B(b), C(c), D(d) {}
+
+    void unity()
+    {
+        A = 1; B = 0; C = 0; D = 1;
+    }
+
+    void operator *= (const MatrixReal &m);
+    void operator *= (const Matrix *m);
+
+    /// Assigns real elements to the complex matrix
+    void assignTo(Matrix& m) const { m.assign(A, B, C, D); }
+};
+
+/// Multiplies all matrices of the array using real arithmetic only.
+/// Imaginary parts of the matrices are ignored.
+void multMatrixArrayReal(const MatrixArray& matrs, Matrix& result);
+
+//------------------------------------------------------------------------------
+
 class RayVector
 {
 public:
@@ -201,6 +201,9 @@ public:
             notifyListeners_error();
     }
 
+    /// Set error without notification.
+    void setRawError(const QString &error) { _error = error; }
+
     /// Verify parameter value.
     /// Should be called before value assignment.
     QString verify(const TValue& value)
@@ -1,20 +1,39 @@
 #include "Perf.h"
 
-#ifdef Z_PERF_ENABLED
-
+#include <QCoreApplication>
 #include <QDebug>
-#include <QElapsedTimer>
-#include <stack>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace Z::Perf {
 
-std::optional<QElapsedTimer> __timer;
+std::atomic_bool __enabled(false);
+
+// Incremented on each enabling to discard blocks left open in threads
+static std::atomic_int __generation(0);
+
+static std::atomic_int __nextThreadId(1);
+
+static const auto __epoch = std::chrono::steady_clock::now();
+
+static qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - __epoch).count();
+}
 
 struct Block
 {
     int count = 0;
     qint64 duration = 0;
-    qint64 start;
 
     Block() {}
     Block(const Block &other) = delete;
@@ -23,77 +42,201 @@ struct Block
 
 typedef std::pair<const char*, const char*> BlockKey;
 typedef std::map<BlockKey, Block> Blocks;
-Q_GLOBAL_STATIC(Blocks, __blocks);
-
 
 struct StackItem
 {
     const char *id;
     Block *block;
+    qint64 start;
+};
+
+struct TraceEvent
+{
+    const char *id;
+    qint64 start;
+    qint64 duration;
 };
 
-typedef std::stack<StackItem> Stack;
-Q_GLOBAL_STATIC(Stack, __stack);
+/// Trace events recorded in a thread.
+/// Events are only added by the owning thread, the own mutex is locked
+/// by other threads only when saving or clearing the trace, so it's almost never contended.
+/// The buffer outlives its thread, so events of finished threads are saved too,
+/// it's released by clearTrace() when the thread is finished.
+struct TraceThread
+{
+    int threadId;
+    bool isMain;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+};
 
-void reset()
+struct ThreadData
 {
-    __timer.reset();
-    __blocks->clear();
-    while (!__stack->empty())
-        __stack->pop();
+    int threadId = 0;
+    int generation = -1;
+    std::vector<StackItem> stack;
+    Blocks blocks;
+    std::shared_ptr<TraceThread> trace;
+};
+
+static thread_local ThreadData __threadData;
 
+// About 24MB of events, the rest is dropped
+static const int __maxTraceSize = 1000000;
+
+// Guards the list of threads, events are guarded by their thread buffers
+static std::mutex __traceMutex;
+static std::vector<std::shared_ptr<TraceThread>> __traceThreads;
+static std::atomic_int __traceCount(0);
+static std::atomic_int __traceDropped(0);
+
+static ThreadData& threadData()
+{
+    auto &t = __threadData;
+    if (t.threadId == 0)
+    {
+        t.threadId = __nextThreadId++;
+        t.trace = std::make_shared<TraceThread>();
+        t.trace->threadId = t.threadId;
+        t.trace->isMain = qApp && QThread::currentThread() == qApp->thread();
+        std::lock_guard lock(__traceMutex);
+        __traceThreads.push_back(t.trace);
+    }
+    int generation = __generation.load(std::memory_order_relaxed);
+    if (t.generation != generation)
+    {
+        t.generation = generation;
+        t.stack.clear();
+    }
+    return t;
+}
+
+void setEnabled(bool on)
+{
+    if (on) __generation++;
+    __enabled = on;
+}
+
+void reset()
+{
+    auto &t = threadData();
+    t.stack.clear();
+    t.blocks.clear();
 }
 
 void begin(const char *id)
 {
-    if (__stack->empty()) {
-        __timer = QElapsedTimer();
-        __timer->start();
-
-        Block *b = &(*__blocks)[{id, nullptr}];
-        b->count++;
-        b->start = __timer->elapsed();
-        __stack->push({id, b});
-    } else {
-        auto &top = __stack->top();
-        Block *b = &(*__blocks)[{id, top.id}];
-        b->count++;
-        b->start = __timer->elapsed();
-        __stack->push({id, b});
-    }
+    auto &t = threadData();
+    const char *parentId = t.stack.empty() ? nullptr : t.stack.back().id;
+    Block *b = &t.blocks[{id, parentId}];
+    b->count++;
+    t.stack.push_back({id, b, now()});
 }
 
 void end()
 {
-    if (__stack->empty())
+    auto &t = threadData();
+    if (t.stack.empty())
         return;
 
-    Block *b = __stack->top().block;
-    b->duration += __timer->elapsed() - b->start;
+    auto &top = t.stack.back();
+    qint64 duration = now() - top.start;
+    top.block->duration += duration;
 
-    __stack->pop();
-    if (__stack->empty())
-        __timer.reset();
+    if (__traceCount.fetch_add(1, std::memory_order_relaxed) < __maxTraceSize)
+    {
+        std::lock_guard lock(t.trace->mutex);
+        t.trace->events.push_back({top.id, top.start, duration});
+    }
+    else __traceDropped++;
+
+    t.stack.pop_back();
 }
 
-void printBranch(const char *id, int level)
+static void printBranch(const Blocks &blocks, const char *id, int level)
 {
-    for (auto it = __blocks->cbegin(); it != __blocks->cend(); it++)
+    for (auto it = blocks.cbegin(); it != blocks.cend(); it++)
         if (it->first.second == id) {
             qDebug() << QString(level*4, ' ') +
                 QStringLiteral("%1: %2_ms [%3]")
                     .arg(it->first.first)
-                    .arg(it->second.duration)
+                    .arg(it->second.duration / 1e6, 0, 'f', 3)
                     .arg(it->second.count);
-            printBranch(it->first.first, level+1);
+            printBranch(blocks, it->first.first, level+1);
         }
 }
 
 void print()
 {
-    printBranch(nullptr, 0);
+    printBranch(threadData().blocks, nullptr, 0);
 }
 
-} // namespace Z::Perf
+int traceSize()
+{
+    std::lock_guard lock(__traceMutex);
+    size_t size = 0;
+    for (const auto &t : __traceThreads)
+    {
+        std::lock_guard threadLock(t->mutex);
+        size += t->events.size();
+    }
+    return int(size);
+}
 
-#endif
+void clearTrace()
+{
+    std::lock_guard lock(__traceMutex);
+    // The list holds the last reference when the thread's data is destroyed
+    std::erase_if(__traceThreads, [](const auto &t){ return t.use_count() == 1; });
+    for (const auto &t : __traceThreads)
+    {
+        std::lock_guard threadLock(t->mutex);
+        t->events.clear();
+    }
+    __traceCount = 0;
+    __traceDropped = 0;
+}
+
+QString saveTrace(const QString &fileName)
+{
+    QJsonArray events;
+    {
+        std::lock_guard lock(__traceMutex);
+        for (const auto &t : __traceThreads)
+        {
+            events.append(QJsonObject({
+                { "name", "thread_name" },
+                { "ph", "M" },
+                { "pid", 1 },
+                { "tid", t->threadId },
+                { "args", QJsonObject({{ "name", t->isMain ? QStringLiteral("Main") : QStringLiteral("Worker %1").arg(t->threadId) }}) },
+            }));
+            std::lock_guard threadLock(t->mutex);
+            for (const auto &e : t->events)
+                events.append(QJsonObject({
+                    { "name", QString::fromLatin1(e.id) },
+                    { "ph", "X" },
+                    { "pid", 1 },
+                    { "tid", t->threadId },
+                    // Chrome trace timestamps are in microseconds
+                    { "ts", e.start / 1e3 },
+                    { "dur", e.duration / 1e3 },
+                }));
+        }
+        if (__traceDropped > 0)
+            qWarning() << "Perf: trace size limit exceeded," << __traceDropped.load() << "events dropped";
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return qApp->tr("Unable to open file for writing: %1").arg(file.errorString());
+
+    QJsonObject root({
+        { "traceEvents", events },
+        { "displayTimeUnit", "ns" },
+    });
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return QString();
+}
+
+} // namespace Z::Perf
@@ -1,64 +1,80 @@
 #ifndef PERF_H
 #define PERF_H
 
-//#define Z_PERF_ENABLED
+#include <QString>
 
-#ifdef Z_PERF_ENABLED
+#include <atomic>
 
 /**
 
 Simple performance tracker.
 
+The tracker is always compiled but disabled by default, so instrumented blocks
+cost only a check of a flag. It can be enabled at runtime via the Tools menu
+in dev mode (the --dev command line option). Timing is nanosecond precise
+and is accumulated separately for each thread.
+
 Below is an example output for plotting of beam variation with 100 points
 when changing a global parameter. It can bee seen that calculation is slow
-because of lot of calls of parameterChanged handlers and the most of time 
+because of lot of calls of parameterChanged handlers and the most of time
 is spent in SchemaParamsTable::parameterChanged so it needs to be optimized.
 
 In square brackets is the number of calls.
 
-BeamVariationFunction: 824_ms [1]"
-    setValue: 824_ms [100]"
-        ParameterBase::notifyListeners: 824_ms [100]"
-            ParameterBase::notifyListeners: 420_ms [100]"
-                ParameterLink::apply: 0_ms [100]"
-                    ParameterBase::notifyListeners: 0_ms [300]"
-                        Element::parameterChanged_1: 0_ms [300]"
-                            ElemEmptyRange::calcMatrixInternal: 0_ms [100]"
-                        Element::parameterChanged_2: 0_ms [300]"
-                SchemaParamsTable::parameterChanged: 419_ms [200]"
-            ParameterLink::apply: 0_ms [200]"
-                ParameterBase::notifyListeners: 0_ms [300]"
-                    Element::parameterChanged_1: 0_ms [300]"
-                        ElemEmptyRange::calcMatrixInternal: 0_ms [100]"
-                    Element::parameterChanged_2: 0_ms [300]"
-            SchemaParamsTable::parameterChanged: 387_ms [200]"
-    recalcSubrange: 0_ms [100]"
-    multMatrix: 0_ms [100]"
-    addResultPoint: 0_ms [100]"
+BeamVariationFunction: 824.312_ms [1]"
+    setValue: 823.907_ms [100]"
+        ParameterBase::notifyListeners: 823.851_ms [100]"
+            ParameterBase::notifyListeners: 420.107_ms [100]"
+                ParameterLink::apply: 0.212_ms [100]"
+                    ParameterBase::notifyListeners: 0.154_ms [300]"
+                        Element::parameterChanged_1: 0.097_ms [300]"
+                            ElemEmptyRange::calcMatrixInternal: 0.011_ms [100]"
+                        Element::parameterChanged_2: 0.008_ms [300]"
+                SchemaParamsTable::parameterChanged: 419.455_ms [200]"
+            ParameterLink::apply: 0.301_ms [200]"
+                ParameterBase::notifyListeners: 0.201_ms [300]"
+                    Element::parameterChanged_1: 0.122_ms [300]"
+                        ElemEmptyRange::calcMatrixInternal: 0.014_ms [100]"
+                    Element::parameterChanged_2: 0.009_ms [300]"
+            SchemaParamsTable::parameterChanged: 387.216_ms [200]"
+    recalcSubrange: 0.004_ms [100]"
+    multMatrix: 0.095_ms [100]"
+    addResultPoint: 0.027_ms [100]"
+
+Besides the summary, each block is recorded as a trace event while tracking is enabled.
+Recorded events can be saved in the Chrome trace format with saveTrace()
+and then opened in chrome://tracing or https://ui.perfetto.dev
+to see a timeline of calculations in all threads.
 
 */
 
 namespace Z::Perf {
 
+// Don't change directly, use setEnabled()
+extern std::atomic_bool __enabled;
+
+inline bool isEnabled() { return __enabled.load(std::memory_order_relaxed); }
+
+/// Blocks being open in the moment of disabling are discarded when the tracker is enabled again.
+void setEnabled(bool on);
+
 void reset();
 void begin(const char *id);
 void end();
 void print();
 
-} // namespace Z::Perf
-
-#define Z_PERF_RESET Z::Perf::reset();
-#define Z_PERF_BEGIN(id) Z::Perf::begin(id);
-#define Z_PERF_END Z::Perf::end();
-#define Z_PERF_PRINT Z::Perf::print();
+int traceSize();
+void clearTrace();
 
-#else
+/// Saves recorded trace events as Chrome trace JSON.
+/// Returns an error message or an empty string on success.
+QString saveTrace(const QString &fileName);
 
-#define Z_PERF_RESET
-#define Z_PERF_BEGIN(id)
-#define Z_PERF_END
-#define Z_PERF_PRINT
+} // namespace Z::Perf
 
-#endif
+#define Z_PERF_RESET { if (Z::Perf::isEnabled()) Z::Perf::reset(); }
+#define Z_PERF_BEGIN(id) { if (Z::Perf::isEnabled()) Z::Perf::begin(id); }
+#define Z_PERF_END { if (Z::Perf::isEnabled()) Z::Perf::end(); }
+#define Z_PERF_PRINT { if (Z::Perf::isEnabled()) Z::Perf::print(); }
 
 #endif // PERF_H
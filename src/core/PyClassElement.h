@@ -23,8 +23,11 @@ struct Self
 
 void dtor(Self *self)
 {
-    self->backup.reset();
-    self->locker.reset();
+    if (self->backup || self->locker)
+        PyGlobal::changeSchema([self]{
+            self->backup.reset();
+            self->locker.reset();
+        });
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
@@ -79,7 +82,7 @@ int set_offset(Self *self, PyObject *arg)
     else if (PyLong_Check(arg))
         v = PyLong_AsLong(arg);
     else CHECK_I(false, TypeError, "unsupported argument type, number expected")
-    range->setSubRangeSI(v);
+    PyGlobal::changeSchema([range, v]{ range->setSubRangeSI(v); });
     return 0;
 }
 
@@ -142,23 +145,27 @@ PyObject* set_param(Self *self, PyObject *args)
     CHECK_(param, KeyError, "parameter not found")
     CHECK_(!qIsNaN(val), ValueError, "invalid parameter value")
     Z::Value value(val, param->dim()->siUnit());
-    param->setValue(value.toUnit(param->value().unit()));
+    PyGlobal::changeSchema([param, value]{ param->setValue(value.toUnit(param->value().unit())); });
     Py_RETURN_NONE;
 }
 
 PyObject* lock(Self *self, PyObject *Py_UNUSED(args))
 {
     //qDebug() << "Lock" << self->elem->label();
-    self->locker.reset(new ElementEventsLocker(self->elem, "py.element.lock()"));
-    self->backup.reset(new ElementParamsBackup(self->elem, "py.element.lock()"));
+    PyGlobal::changeSchema([self]{
+        self->locker.reset(new ElementEventsLocker(self->elem, "py.element.lock()"));
+        self->backup.reset(new ElementParamsBackup(self->elem, "py.element.lock()"));
+    });
     Py_RETURN_NONE;
 }
 
 PyObject* unlock(Self *self, PyObject *Py_UNUSED(args))
 {
     //qDebug() << "Unlock" << self->elem->label();
-    self->backup.reset();
-    self->locker.reset();
+    PyGlobal::changeSchema([self]{
+        self->backup.reset();
+        self->locker.reset();
+    });
     Py_RETURN_NONE;
 }
 
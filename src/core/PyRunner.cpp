@@ -2,11 +2,23 @@
 
 #include "PyRunner.h"
 
+#include <QCoreApplication>
+
 PyRunner::PyRunner() {}
 PyRunner::~PyRunner() {}
 bool PyRunner::load(const ModuleProps&) { errorLog << "Not emplemented"; return false; }
 PyRunner::FuncResult PyRunner::run(const QString&, const Args&, const ResultSpec&) { return {}; }
 
+bool PyWorker::start(const std::function<void()> &calc, const std::function<void()> &finished)
+{
+    calc();
+    QMetaObject::invokeMethod(qApp, finished, Qt::QueuedConnection);
+    return true;
+}
+void PyWorker::interrupt(Interruption) {}
+bool PyWorker::isRunning() { return false; }
+void PyWorker::whenIdle(const std::function<void()> &f) { QMetaObject::invokeMethod(qApp, f, Qt::QueuedConnection); }
+
 #else
 
 // Includes Python.h, should be first:
@@ -17,9 +29,23 @@ PyRunner::FuncResult PyRunner::run(const QString&, const Args&, const ResultSpec
 #include "Units.h"
 #include "../math/BeamCalculator.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 #include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
+
+#include <atomic>
+
+/// Acquires the GIL for the current thread.
+/// Python code can be called from the main thread and from the PyWorker thread.
+struct GilLock
+{
+    GilLock() : state(PyGILState_Ensure()) {}
+    ~GilLock() { PyGILState_Release(state); }
+    PyGILState_STATE state;
+};
 
 PyRunner::PyRunner()
 {
@@ -97,11 +123,19 @@ PyRunner::PyRunner()
     INIT_MODULE(PyModule::Schema)
 
     PyConfig_Clear(&config);
+
+    // Release the GIL acquired by initialization, each call acquires it, see GilLock
+    PyEval_SaveThread();
+
     inited = true;
 }
 
 PyRunner::~PyRunner()
 {
+    std::optional<GilLock> gil;
+    if (!_refs.isEmpty())
+        gil.emplace();
+
     for (int i = _refs.size()-1; i>= 0; i--)
     {
         const auto &r = _refs.at(i);
@@ -153,17 +187,119 @@ struct TmpRefs
 
 #define TMP_REF(ref) TmpRef{#ref, ref}
 
+/// Makes `array.array` initialized with a copy of raw data
+static PyObject* makeArray(const char *typeCode, const void *data, Py_ssize_t size)
+{
+    auto pArrayModule = PyImport_ImportModule("array");
+    if (!pArrayModule)
+        return nullptr;
+    auto pArray = PyObject_CallMethod(pArrayModule, "array", "sy#", typeCode, (const char*)data, size);
+    Py_DECREF(pArrayModule);
+    return pArray;
+}
+
+template <typename T>
+static void copyNumbers(const void *buf, QVector<double> &numbers)
+{
+    auto items = static_cast<const T*>(buf);
+    for (qsizetype i = 0; i < numbers.size(); i++)
+        numbers[i] = double(items[i]);
+}
+
+/// Copies numbers from an object supporting the buffer protocol.
+/// Arrays of doubles are copied with a single memcpy, other numeric types are converted.
+/// Returns an error message if the buffer can't be interpreted as a flat array of numbers.
+static QString numbersFromBuffer(PyObject *obj, QVector<double> &numbers)
+{
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        PyErr_Clear();
+        return "contiguous array expected";
+    }
+    if (view.ndim != 1) {
+        PyBuffer_Release(&view);
+        return "one-dimensional array expected";
+    }
+
+    // Only native byte order is supported
+    QByteArray format(view.format ? view.format : "B");
+    if (format.startsWith('@') || format.startsWith('=')
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        || format.startsWith('<')
+#endif
+    )
+        format.remove(0, 1);
+
+    QString err;
+    numbers.resize(view.itemsize > 0 ? view.len / view.itemsize : 0);
+    bool isSigned = format.size() == 1 && QByteArray("bhilqn").contains(format.at(0));
+    bool isUnsigned = format.size() == 1 && QByteArray("BHILQN").contains(format.at(0));
+    if (format == "d" && view.itemsize == sizeof(double))
+        memcpy(numbers.data(), view.buf, numbers.size() * sizeof(double));
+    else if (format == "f" && view.itemsize == sizeof(float))
+        copyNumbers<float>(view.buf, numbers);
+    // Integer types are selected by size because it depends on the format prefix
+    else if (isSigned && view.itemsize == 1) copyNumbers<int8_t>(view.buf, numbers);
+    else if (isSigned && view.itemsize == 2) copyNumbers<int16_t>(view.buf, numbers);
+    else if (isSigned && view.itemsize == 4) copyNumbers<int32_t>(view.buf, numbers);
+    else if (isSigned && view.itemsize == 8) copyNumbers<int64_t>(view.buf, numbers);
+    else if (isUnsigned && view.itemsize == 1) copyNumbers<uint8_t>(view.buf, numbers);
+    else if (isUnsigned && view.itemsize == 2) copyNumbers<uint16_t>(view.buf, numbers);
+    else if (isUnsigned && view.itemsize == 4) copyNumbers<uint32_t>(view.buf, numbers);
+    else if (isUnsigned && view.itemsize == 8) copyNumbers<uint64_t>(view.buf, numbers);
+    else {
+        numbers.clear();
+        err = QString("unsupported array item format '%1'").arg(QString::fromLatin1(view.format ? view.format : ""));
+    }
+
+    PyBuffer_Release(&view);
+    return err;
+}
+
+static PyObject* makeElementList(const QVector<void*> &elems)
+{
+    auto pList = PyList_New(elems.size());
+    if (!pList)
+        return nullptr;
+    for (int i = 0; i < elems.size(); i++) {
+        auto pElem = PyClass::Element::make((Element*)elems.at(i));
+        if (!pElem) {
+            Py_DECREF(pList);
+            return nullptr;
+        }
+        // The list steals the reference
+        PyList_SET_ITEM(pList, i, pElem);
+    }
+    return pList;
+}
+
+void PyRunner::setGlobals()
+{
+    // Several runners can be alive at the same time,
+    // so globals are assigned each time the runner calls python code
+    PyGlobal::schema = schema;
+    auto print = printFunc ? printFunc : [](const QString &s){ qDebug() << s; };
+    PyGlobal::printFunc = [print](const QString &s){
+        // Print function usually writes to a window but the code can be run in PyWorker
+        if (QThread::currentThread() == qApp->thread())
+            print(s);
+        else
+            QMetaObject::invokeMethod(qApp, [print, s]{ print(s); }, Qt::QueuedConnection);
+    };
+}
+
 bool PyRunner::load(const ModuleProps &props)
 {
     if (!errorLog.isEmpty()) return false;
+
+    GilLock gil;
     
     if (moduleName.isEmpty()) {
         handleError("Custom module name is not provided");
         return false;
     }
 
-    PyGlobal::schema = schema;
-    PyGlobal::printFunc = printFunc ? printFunc : [](const QString &s){ qDebug() << s; };
+    setGlobals();
     
     auto bCode = code.toUtf8();
     auto bModuleName = moduleName.toUtf8();
@@ -270,6 +406,9 @@ PyRunner::FuncResult PyRunner::run(const QString &funcName, const Args &args, co
         return {};
     }
     auto pFunc = (PyObject*)_funcRefs[funcName];
+
+    GilLock gil;
+    setGlobals();
     
     TmpRefs refs("PyRunner::run");
 
@@ -294,6 +433,19 @@ PyRunner::FuncResult PyRunner::run(const QString &funcName, const Args &args, co
         case atInt:
             pArg = PyLong_FromLong(argValue.toInt());
             break;
+        case atElementArray:
+            pArg = makeElementList(argValue.value<QVector<void*>>());
+            break;
+        case atIntArray: {
+            auto ints = argValue.value<QVector<int>>();
+            pArg = makeArray("i", ints.constData(), ints.size() * sizeof(int));
+            break;
+        }
+        case atNumberArray: {
+            auto numbers = argValue.value<QVector<double>>();
+            pArg = makeArray("d", numbers.constData(), numbers.size() * sizeof(double));
+            break;
+        }
         }
         if (pArg) {
             if (PyTuple_SetItem(pArgs, i, pArg) < 0) {
@@ -387,19 +539,24 @@ PyRunner::FuncResult PyRunner::run(const QString &funcName, const Args &args, co
                 else CHECK_E(false, "number expected");
                 break;
             case ftNumberArray: {
-                CHECK_E(PyList_Check(pField), "list expected");
-                auto listSize = PyList_Size(pField);
                 QVector<double> numbers;
-                numbers.reserve(listSize);
-                for (Py_ssize_t j = 0; j < listSize; j++) {
-                    auto pItem = PyList_GetItem(pField, j);
-                    CHECK_E(pItem, QString("failed to get list item %1").arg(j));
-                    if (PyFloat_Check(pItem))
-                        numbers.append(PyFloat_AsDouble(pItem));
-                    else if (PyLong_Check(pItem))
-                        numbers.append(double(PyLong_AsLong(pItem)));
-                    else CHECK_E(false, QString("list item %1 is not a number").arg(j));
-                }
+                if (PyList_Check(pField)) {
+                    auto listSize = PyList_Size(pField);
+                    numbers.reserve(listSize);
+                    for (Py_ssize_t j = 0; j < listSize; j++) {
+                        auto pItem = PyList_GetItem(pField, j);
+                        CHECK_E(pItem, QString("failed to get list item %1").arg(j));
+                        if (PyFloat_Check(pItem))
+                            numbers.append(PyFloat_AsDouble(pItem));
+                        else if (PyLong_Check(pItem))
+                            numbers.append(double(PyLong_AsLong(pItem)));
+                        else CHECK_E(false, QString("list item %1 is not a number").arg(j));
+                    }
+                } else if (PyObject_CheckBuffer(pField)) {
+                    // array.array, memoryview, numpy.ndarray, etc.
+                    auto err = numbersFromBuffer(pField, numbers);
+                    CHECK_E(err.isEmpty(), err);
+                } else CHECK_E(false, "list or array expected");
                 rec[k] = QVariant::fromValue(numbers);
                 break;
             }
@@ -505,6 +662,96 @@ void PyRunner::handleError(const QString& msg, const QString &funcName)
     }
 }
 
+//------------------------------------------------------------------------------
+//                                  PyWorker
+//------------------------------------------------------------------------------
+
+static std::atomic<bool> __workerRunning = false;
+// Python thread id of the worker, it's only set while python code can be running there
+static std::atomic<unsigned long> __workerThreadId = 0;
+// Called after the worker is finished, only accessed from the main thread
+static QVector<std::function<void()>> __workerIdleCallbacks;
+
+static QThreadPool* workerPool()
+{
+    static QThreadPool *pool = nullptr;
+    if (!pool) {
+        pool = new QThreadPool(qApp);
+        // A single thread, so custom codes never run concurrently.
+        // Its python thread state is created by PyGILState_Ensure() for each calculation.
+        pool->setMaxThreadCount(1);
+        pool->setExpiryTimeout(-1);
+    }
+    return pool;
+}
+
+bool PyWorker::start(const std::function<void()> &calc, const std::function<void()> &finished)
+{
+    if (__workerRunning)
+        return false;
+
+    // Interpreter should be initialized in the main thread
+    // before any python code is called from the worker
+    PyRunner initializer;
+    Q_UNUSED(initializer)
+
+    __workerRunning = true;
+    workerPool()->start([calc, finished]{
+        const bool python = Py_IsInitialized();
+        PyGILState_STATE gil;
+        PyThreadState *state = nullptr;
+        if (python) {
+            gil = PyGILState_Ensure();
+            __workerThreadId = PyThread_get_thread_ident();
+            // Keep the thread state but release the GIL, PyRunner acquires it for each call
+            state = PyEval_SaveThread();
+        }
+
+        calc();
+
+        if (python) {
+            PyEval_RestoreThread(state);
+            // An interruption can come when python code is already finished, drop it
+            PyThreadState_SetAsyncExc(__workerThreadId, nullptr);
+            __workerThreadId = 0;
+            PyGILState_Release(gil);
+        }
+        __workerRunning = false;
+        QMetaObject::invokeMethod(qApp, [finished]{
+            finished();
+            auto callbacks = std::move(__workerIdleCallbacks);
+            __workerIdleCallbacks.clear();
+            // Let the caller of the finished calculation handle its results first
+            for (const auto &callback : std::as_const(callbacks))
+                QMetaObject::invokeMethod(qApp, callback, Qt::QueuedConnection);
+        }, Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void PyWorker::interrupt(Interruption reason)
+{
+    if (!Py_IsInitialized())
+        return;
+    // The worker resets thread id under the GIL, so the exception can't be set after it's finished
+    GilLock gil;
+    if (auto id = __workerThreadId.load(); id)
+        PyThreadState_SetAsyncExc(id, reason == Timeout ? PyExc_TimeoutError : PyExc_KeyboardInterrupt);
+}
+
+bool PyWorker::isRunning()
+{
+    return __workerRunning;
+}
+
+void PyWorker::whenIdle(const std::function<void()> &f)
+{
+    if (__workerRunning)
+        __workerIdleCallbacks << f;
+    else
+        QMetaObject::invokeMethod(qApp, f, Qt::QueuedConnection);
+}
+
 #endif // USE_PYTHON
 
 QString PyRunner::errorText() const
@@ -47,7 +47,9 @@ public:
     using ResultSpec = QHash<QString, FieldType>;
 
     /// Types of arguments that are passed to the py funcs
-    enum ArgType { atElement, atRoundTrip, atInt };
+    /// Number arrays are passed as `array.array` objects to be suitable for the buffer protocol,
+    /// element arrays are passed as lists
+    enum ArgType { atElement, atRoundTrip, atInt, atElementArray, atIntArray, atNumberArray };
     using Args = QVector<QPair<ArgType, QVariant>>;
 
     struct ModuleProps
@@ -66,6 +68,10 @@ public:
     FuncResult run(const QString &funcName, const Args &args, const ResultSpec &resultSpec);
 
     QString errorText() const;
+
+    /// Clears errors of the previous function call.
+    /// Should be called before reusing a loaded runner for a new calculation.
+    void resetErrors() { errorLog.clear(); errorLine = 0; }
     
     struct TmpRef
     {
@@ -77,9 +83,38 @@ public:
 
 private:
     void handleError(const QString& msg, const QString &funcName = QString());
+    void setGlobals();
     
     QVector<TmpRef> _refs;
     QHash<QString, void*> _funcRefs;
 };
 
+/**
+    Dedicated worker thread for calculations calling custom python code.
+
+    Python interpreter releases the GIL after initialization and PyRunner acquires it for each call,
+    so the code can be called from the worker while the main thread keeps processing events.
+    Python code running in the worker can be interrupted, it gets an exception
+    (`KeyboardInterrupt` when cancelled, `TimeoutError` when timed out)
+    as soon as the interpreter gets control next time.
+*/
+class PyWorker
+{
+public:
+    enum Interruption { Cancel, Timeout };
+
+    /// Starts @a calc in the worker thread, @a finished is called in the main thread when it's done.
+    /// Returns false if the worker is still busy with another calculation.
+    static bool start(const std::function<void()> &calc, const std::function<void()> &finished);
+
+    /// Interrupts python code running in the worker thread.
+    static void interrupt(Interruption reason);
+
+    static bool isRunning();
+
+    /// Calls @a f in the main thread when the worker is finished, or soon if it's not running.
+    /// Should be called from the main thread.
+    static void whenIdle(const std::function<void()> &f);
+};
+
 #endif // CUSTOM_CODE_RUNNER_H
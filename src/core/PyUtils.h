@@ -3,8 +3,10 @@
 
 #include "Python.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QString>
+#include <QThread>
 
 #include <functional>
 
@@ -16,7 +18,8 @@ namespace PyGlobal {
 
 /// Current schema.
 /// Currently, one app instance can operate on a single schema.
-::Schema *schema = nullptr;
+/// It's per thread because the code can be run in PyWorker while the main thread runs another one.
+thread_local ::Schema *schema = nullptr;
 
 /// Exception class used for rezonator specific errors.
 PyObject *SchemaError = nullptr;
@@ -24,7 +27,22 @@ PyObject *SchemaError = nullptr;
 /// A function used by Z.print()
 /// It does qDebug() for scripts that do not show a code window
 /// Where there is a code window, the output target is its log panel
-std::function<void(const QString&)> printFunc;
+thread_local std::function<void(const QString&)> printFunc;
+
+/// Runs a function changing the schema in the main thread and waits until it's done.
+/// Code can be run in PyWorker but parameters and elements have listeners that are widgets,
+/// so they must be changed in the main thread only. The GIL is released while waiting,
+/// so the main thread doesn't deadlock if it needs to call python code meanwhile.
+void changeSchema(const std::function<void()> &change)
+{
+    if (QThread::currentThread() == qApp->thread()) {
+        change();
+        return;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    QMetaObject::invokeMethod(qApp, change, Qt::BlockingQueuedConnection);
+    Py_END_ALLOW_THREADS
+}
 
 } // namespace PyGlobal
 
@@ -4,6 +4,8 @@
 #include "Schema.h"
 #include "Utils.h"
 
+#include <QTimer>
+
 //------------------------------------------------------------------------------
 //                               SchemaListener
 //------------------------------------------------------------------------------
@@ -37,18 +39,36 @@ void SchemaState::set(State state)
 //                                SchemaEvents
 //------------------------------------------------------------------------------
 
-#define INIT_EVENT(event, raise_changed, next_state)\
-    {event, EventProps{QString(# event), raise_changed, next_state}}
+#define INIT_EVENT(event, raise_changed, next_state, batchable)\
+    {event, EventProps{QString(# event), raise_changed, next_state, batchable}}
 
-void SchemaEvents::raise(Event event, void *param, const char* reason) const
+QString SchemaEvents::aliasPrefix() const
 {
-    if (!_enabled) return;
-
     QString alias = _schema->alias();
     if (!alias.isEmpty())
         alias = QStringLiteral("[%1]: ").arg(alias);
+    return alias;
+}
+
+void SchemaEvents::raise(Event event, void *param, const char* reason) const
+{
+    if (!_enabled) return;
 
     const EventProps& eventProps = propsOf(event);
+
+    if (isBatching())
+    {
+        if (eventProps.batchable)
+        {
+            enqueue(event, param, reason);
+            return;
+        }
+        // Listeners must see collected changes before something is created or deleted
+        flush();
+    }
+
+    QString alias = aliasPrefix();
+
     Z_REPORT(QStringLiteral("%1SchemaEvent: %2, reason=[%3]").arg(alias, eventProps.name, reason))
 
     if (eventProps.nextState)
@@ -71,54 +91,141 @@ void SchemaEvents::raise(Event event, void *param, const char* reason) const
     }
 }
 
+void SchemaEvents::enqueue(Event event, void* param, const char* reason) const
+{
+    const EventProps& eventProps = propsOf(event);
+
+    // Schema state is changed immediately, only notifications are postponed
+    if (eventProps.nextState)
+        _schema->state().set(*eventProps.nextState);
+
+    if (event == Changed || eventProps.shouldRaiseChanged)
+    {
+        if (!_batch.changed)
+            _batch.changedReason = reason;
+        _batch.changed = true;
+        if (event == Changed)
+            return;
+    }
+
+    for (const PendingEvent& pending : std::as_const(_batch.events))
+        if (pending.event == event && pending.param == param)
+            return;
+
+    _batch.events.append(PendingEvent{event, param, reason});
+}
+
+void SchemaEvents::flush() const
+{
+    if (_batch.isEmpty()) return;
+
+    // Listeners can raise new events while handling these ones
+    Batch batch = std::move(_batch);
+    _batch = Batch();
+
+    QString alias = aliasPrefix();
+    auto listeners = _schema->listeners();
+
+    auto deliver = [&](Event event, void* param, const QByteArray& reason)
+    {
+        Z_REPORT(QStringLiteral("%1SchemaEvent: %2, reason=[%3], batched")
+            .arg(alias, propsOf(event).name, QString::fromUtf8(reason)))
+        for (SchemaListener* listener : listeners)
+            notify(listener, event, param);
+    };
+
+    for (const PendingEvent& pending : std::as_const(batch.events))
+        if (pending.event != RecalRequred)
+            deliver(pending.event, pending.param, pending.reason);
+
+    if (batch.changed)
+        deliver(Changed, nullptr, batch.changedReason);
+
+    for (const PendingEvent& pending : std::as_const(batch.events))
+        if (pending.event == RecalRequred)
+            deliver(pending.event, pending.param, pending.reason);
+}
+
+void SchemaEvents::beginBatch()
+{
+    _batchDepth++;
+}
+
+void SchemaEvents::endBatch(Arg::DeferEvents defer)
+{
+    if (_batchDepth == 0)
+    {
+        qWarning() << "SchemaEvents::endBatch() without beginBatch()";
+        return;
+    }
+    if (--_batchDepth > 0) return;
+
+    if (defer.value && qApp)
+    {
+        if (_flushScheduled) return;
+        _flushScheduled = true;
+        std::weak_ptr<bool> alive = _alive;
+        QTimer::singleShot(0, qApp, [this, alive]{
+            if (alive.expired()) return;
+            _flushScheduled = false;
+            if (_batchDepth == 0)
+                flush();
+        });
+        return;
+    }
+
+    _flushScheduled = false;
+    flush();
+}
+
 const SchemaEvents::EventProps& SchemaEvents::propsOf(Event event)
 {
     static QMap<Event, EventProps> _props(
     {
-        //                           | Should also | New state which
-        //                           | raise event | schema obtains
-        //                           | 'Changed'   | with this event
-        INIT_EVENT(Changed,            false,        SchemaState::Modified ),
-
-        INIT_EVENT(Created,            false,        SchemaState::New      ),
-        INIT_EVENT(Deleted,            false,        SchemaState::Current  ),
-        INIT_EVENT(Saved,              true,         SchemaState::None     ),
-        INIT_EVENT(Loading,            false,        SchemaState::Loading  ),
-        INIT_EVENT(Loaded,             true,         SchemaState::None     ),
-        INIT_EVENT(Rebuilt,            true,         SchemaState::Modified ),
-
-        INIT_EVENT(ElemCreated,        true,         SchemaState::Modified ),
-        INIT_EVENT(ElemChanged,        true,         SchemaState::Modified ),
-        INIT_EVENT(ElemDeleting,       false,        SchemaState::Current  ),
-        INIT_EVENT(ElemDeleted,        true,         SchemaState::Modified ),
-
-        INIT_EVENT(ElemsDeleting,      false,        SchemaState::Current  ),
-        INIT_EVENT(ElemsDeleted,       false,        SchemaState::Current  ),
-
-        INIT_EVENT(ParamsChanged,      true,         SchemaState::Modified ),
-        INIT_EVENT(LambdaChanged,      true,         SchemaState::Modified ),
-
-        INIT_EVENT(GlobalParamCreated, true,         SchemaState::Modified ),
-        INIT_EVENT(GlobalParamEdited,  true,         SchemaState::Modified ),
-        INIT_EVENT(GlobalParamChanged, true,         SchemaState::Modified ),
-        INIT_EVENT(GlobalParamDeleted, true,         SchemaState::Modified ),
-        INIT_EVENT(GlobalParamDeleting,false,        SchemaState::Current  ),
+        //                           | Should also | New state which         | Can be
+        //                           | raise event | schema obtains          | batched
+        //                           | 'Changed'   | with this event         |
+        INIT_EVENT(Changed,            false,        SchemaState::Modified,  true  ),
+
+        INIT_EVENT(Created,            false,        SchemaState::New,       false ),
+        INIT_EVENT(Deleted,            false,        SchemaState::Current,   false ),
+        INIT_EVENT(Saved,              true,         SchemaState::None,      false ),
+        INIT_EVENT(Loading,            false,        SchemaState::Loading,   false ),
+        INIT_EVENT(Loaded,             true,         SchemaState::None,      false ),
+        INIT_EVENT(Rebuilt,            true,         SchemaState::Modified,  false ),
+
+        INIT_EVENT(ElemCreated,        true,         SchemaState::Modified,  false ),
+        INIT_EVENT(ElemChanged,        true,         SchemaState::Modified,  true  ),
+        INIT_EVENT(ElemDeleting,       false,        SchemaState::Current,   false ),
+        INIT_EVENT(ElemDeleted,        true,         SchemaState::Modified,  false ),
+
+        INIT_EVENT(ElemsDeleting,      false,        SchemaState::Current,   false ),
+        INIT_EVENT(ElemsDeleted,       false,        SchemaState::Current,   false ),
+
+        INIT_EVENT(ParamsChanged,      true,         SchemaState::Modified,  true  ),
+        INIT_EVENT(LambdaChanged,      true,         SchemaState::Modified,  true  ),
+
+        INIT_EVENT(GlobalParamCreated, true,         SchemaState::Modified,  false ),
+        INIT_EVENT(GlobalParamEdited,  true,         SchemaState::Modified,  true  ),
+        INIT_EVENT(GlobalParamChanged, true,         SchemaState::Modified,  true  ),
+        INIT_EVENT(GlobalParamDeleted, true,         SchemaState::Modified,  false ),
+        INIT_EVENT(GlobalParamDeleting,false,        SchemaState::Current,   false ),
 
         // no need to modify schema after operations with custom params
         // because they all happen in the element props dialog 
         // and there will be ElemChanged after the dialog accepted
-        INIT_EVENT(CustomParamCreated, false,        SchemaState::Current ),
-        INIT_EVENT(CustomParamEdited,  false,        SchemaState::Current ),
-        INIT_EVENT(CustomParamDeleted, false,        SchemaState::Current ),
-        INIT_EVENT(CustomParamDeleting,false,        SchemaState::Current  ),
-
-        INIT_EVENT(PumpCreated,        true,         SchemaState::Modified ),
-        INIT_EVENT(PumpChanged,        true,         SchemaState::Modified ),
-        INIT_EVENT(PumpCustomized,     true,         SchemaState::Modified ),
-        INIT_EVENT(PumpDeleted,        true,         SchemaState::Modified ),
-        INIT_EVENT(PumpDeleting,       false,        SchemaState::Current  ),
-
-        INIT_EVENT(RecalRequred,       false,        SchemaState::Current  ),
+        INIT_EVENT(CustomParamCreated, false,        SchemaState::Current,   false ),
+        INIT_EVENT(CustomParamEdited,  false,        SchemaState::Current,   true  ),
+        INIT_EVENT(CustomParamDeleted, false,        SchemaState::Current,   false ),
+        INIT_EVENT(CustomParamDeleting,false,        SchemaState::Current,   false ),
+
+        INIT_EVENT(PumpCreated,        true,         SchemaState::Modified,  false ),
+        INIT_EVENT(PumpChanged,        true,         SchemaState::Modified,  true  ),
+        INIT_EVENT(PumpCustomized,     true,         SchemaState::Modified,  true  ),
+        INIT_EVENT(PumpDeleted,        true,         SchemaState::Modified,  false ),
+        INIT_EVENT(PumpDeleting,       false,        SchemaState::Current,   false ),
+
+        INIT_EVENT(RecalRequred,       false,        SchemaState::Current,   true  ),
     });
     return _props[event];
 }
@@ -168,6 +275,20 @@ void SchemaEvents::notify(SchemaListener* listener, SchemaEvents::Event event, v
     }
 }
 
+//------------------------------------------------------------------------------
+//                              SchemaEventsBatch
+//------------------------------------------------------------------------------
+
+SchemaEventsBatch::SchemaEventsBatch(Schema* schema, Arg::DeferEvents defer) : _schema(schema), _defer(defer)
+{
+    _schema->events().beginBatch();
+}
+
+SchemaEventsBatch::~SchemaEventsBatch()
+{
+    _schema->events().endBatch(_defer);
+}
+
 //------------------------------------------------------------------------------
 //                                 ElementSelector
 //------------------------------------------------------------------------------
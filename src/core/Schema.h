@@ -16,6 +16,8 @@
 #include <QMap>
 #include <QPointer>
 
+#include <memory>
+
 class Schema;
 
 //------------------------------------------------------------------------------
@@ -24,6 +26,7 @@ namespace Arg {
 
 using RaiseEvents = Ori::Argument<bool, struct RaiseEventsTag>;
 using FreeElem = Ori::Argument<bool, struct FreeElemTag>;
+using DeferEvents = Ori::Argument<bool, struct DeferEventsTag>;
 
 } // namespace Arg
 
@@ -114,6 +117,14 @@ private:
     2. Add new notification method to @a SchemaListener interface.
     3. Add calling of that method to @a SchemaEvents::notify() method.
     4. Define props of new event in @a SchemaEvents::propsOf() method.
+
+    Events can be collected into a batch (see @a SchemaEventsBatch).
+    While a batch is open, events marked as batchable in @a SchemaEvents::propsOf()
+    are not sent to listeners immediately. They are deduplicated per event type and parameter
+    (e.g. element) and sent at once when the outermost batch closes, followed by
+    a single 'Changed' event and a single 'RecalRequred' event if any of them was raised.
+    Other events (creation, deletion, loading, etc.) deliver the collected events first
+    to preserve the order in which listeners see changes.
 */
 class SchemaEvents
 {
@@ -175,6 +186,16 @@ public:
     void enable() { _enabled = true; }
     void disable() { _enabled = false; }
 
+    /// Opens a batch. Batches can be nested, events are delivered when the outermost one closes.
+    void beginBatch();
+    /// Closes a batch. When @a defer is set, delivery is postponed until the application event loop
+    /// gets control, so that all batches closed during the same event loop turn produce a single change set.
+    void endBatch(Arg::DeferEvents defer = Arg::DeferEvents(false));
+    bool isBatching() const { return _batchDepth > 0 || _flushScheduled; }
+
+    /// Delivers all collected events immediately.
+    void flush() const;
+
     static QString str(Event event) { return propsOf(event).name; }
 
 private:
@@ -183,6 +204,28 @@ private:
     Schema *_schema;
     friend class Schema;
 
+    struct PendingEvent
+    {
+        Event event;
+        void* param;
+        QByteArray reason;
+    };
+
+    struct Batch
+    {
+        QVector<PendingEvent> events;
+        bool changed = false;
+        QByteArray changedReason;
+        bool isEmpty() const { return events.isEmpty() && !changed; }
+    };
+
+    int _batchDepth = 0;
+    bool _flushScheduled = false;
+    mutable Batch _batch;
+
+    /// Used for detecting if the schema is still alive when deferred delivery happens.
+    std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
+
     struct EventProps
     {
         QString name;
@@ -193,10 +236,35 @@ private:
         /// New state which schema obtains with this event.
         /// If not set, then state is not changed
         std::optional<SchemaState::State> nextState;
+
+        /// Event can be postponed and deduplicated while events are batched
+        bool batchable;
     };
     static const EventProps& propsOf(Event event);
 
     void notify(SchemaListener* listener, SchemaEvents::Event event, void* param) const;
+    void enqueue(Event event, void* param, const char* reason) const;
+    QString aliasPrefix() const;
+};
+
+//------------------------------------------------------------------------------
+/**
+    Collects schema events raised during its lifetime and delivers them at once
+    as a deduplicated change set, see @a SchemaEvents::beginBatch().
+
+    It should wrap operations changing many parameters at once, e.g. applying of
+    a global parameter driving formulas and links to several elements,
+    so that listeners don't recalculate for each of the intermediate changes.
+*/
+class SchemaEventsBatch
+{
+public:
+    SchemaEventsBatch(Schema* schema, Arg::DeferEvents defer = Arg::DeferEvents(false));
+    ~SchemaEventsBatch();
+
+private:
+    Schema* _schema;
+    Arg::DeferEvents _defer;
 };
 
 //------------------------------------------------------------------------------
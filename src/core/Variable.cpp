@@ -7,8 +7,8 @@ namespace Z {
 
 QString PlottingRange::str() const
 {
-    return QString("start=%1%6, stop=%2%6, range=%3%6, step=%4%6, points=%5")
-            .arg(_start).arg(_stop).arg(_range).arg(_step).arg(_points).arg(_unit->alias());
+    return QString("start=%1%6, stop=%2%6, range=%3%6, step=%4%6, points=%5, tolerance=%7")
+            .arg(_start).arg(_stop).arg(_range).arg(_step).arg(_points).arg(_unit->alias()).arg(_tolerance);
 }
 
 //------------------------------------------------------------------------------
@@ -24,6 +24,7 @@ PlottingRange VariableRange::plottingRange() const
     res._stop = stop.toSi();
     res._range = res.stop() - res.start();
     res._unit = start.unit()->siUnit();
+    res._tolerance = qMax(tolerance, 0.0);
     Q_ASSERT(res.range() > 0);
     if (useStep)
     {
@@ -60,12 +61,13 @@ void VariableRange::assignPoints(const VariableRange& other)
     step = other.step;
     points = other.points;
     useStep = other.useStep;
+    tolerance = other.tolerance;
 }
 
 QString VariableRange::str() const
 {
-    return QString("start: %1; stop: %2; step: %3; points: %4; useStep: %5")
-        .arg(start.str()).arg(stop.str()).arg(step.str()).arg(points).arg(Z::str(useStep));
+    return QString("start: %1; stop: %2; step: %3; points: %4; useStep: %5; tolerance: %6")
+        .arg(start.str()).arg(stop.str()).arg(step.str()).arg(points).arg(Z::str(useStep)).arg(tolerance);
 }
 
 VariableRange VariableRange::withPoints(const Value& start, const Value& stop, int points)
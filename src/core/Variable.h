@@ -22,6 +22,7 @@ private:
     ValueSi _step;
     ValueSi _range;
     int _points;
+    double _tolerance = 0;
     Unit _unit;
     QVector<double> _values;
 public:
@@ -30,6 +31,7 @@ public:
     ValueSi step() const { return _step; }   ///< Parameter variation step.
     ValueSi range() const { return _range; } ///< Whole plotting range.
     int points() const { return _points; }  ///< Amount of points.
+    double tolerance() const { return _tolerance; } ///< Relative tolerance of adaptive refinement.
     Unit unit() const { return _unit; }     ///< SI-unit of measurements for all values.
     const QVector<ValueSi>& values() const { return _values; } ///< Values of points.
     QString str() const;
@@ -47,6 +49,12 @@ struct VariableRange
     int points = 100;       ///< Amount of points.
     bool useStep = false;   ///< Use step value instead of points number.
 
+    /// Relative tolerance for adaptive refinement of the plot.
+    /// When it is set, the points are only an initial grid that is refined where the plot
+    /// deviates from linear interpolation more than this fraction of the value span.
+    /// Zero means the uniform grid and the refinement is not done.
+    double tolerance = 0;
+
     /// Assigns only points number related values, but does not change start and stop.
     void assignPoints(const VariableRange& other);
 
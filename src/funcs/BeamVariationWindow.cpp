@@ -29,7 +29,7 @@ BeamVariationParamsDlg::BeamVariationParamsDlg(Schema *schema, Z::Variable *var,
 
     _placeSelector = new ElemOffsetSelectorWidget(schema, ElementFilters::enabledElements());
 
-    _rangeEditor = new GeneralRangeEditor;
+    _rangeEditor = new GeneralRangeEditor(true);
 
     mainLayout()->addLayout(_elemSelector);
     mainLayout()->addSpacing(8);
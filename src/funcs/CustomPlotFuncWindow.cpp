@@ -1,6 +1,7 @@
 #include "CustomPlotFuncWindow.h"
 
 #include "CustomPlotCodeWindow.h"
+#include "FuncWindowHelpers.h"
 #include "../app/MessageBus.h"
 
 #include "helpers/OriDialogs.h"
@@ -73,6 +74,15 @@ QString CustomPlotFuncWindow::writeFunction(QJsonObject& root)
     return {};
 }
 
+bool CustomPlotFuncWindow::calculateFunction()
+{
+    // Python code can take long, so the previous result is kept
+    // visible until the new one is calculated in the worker thread.
+    // If another code is running, the window is updated when it's finished
+    return FuncWindowHelpers::runCustomCode(this, schema(),
+        [this]{ function()->calculate(); }, [this]{ update(); });
+}
+
 void CustomPlotFuncWindow::beforeUpdate()
 {
     if (_codeWindow) {
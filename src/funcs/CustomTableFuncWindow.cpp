@@ -1,6 +1,7 @@
 #include "CustomTableFuncWindow.h"
 
 #include "CustomTableCodeWindow.h"
+#include "FuncWindowHelpers.h"
 #include "../app/MessageBus.h"
 
 #include "helpers/OriDialogs.h"
@@ -63,6 +64,15 @@ bool CustomTableFuncWindow::storableWrite(QJsonObject &root, Z::Report *report)
     return TableFuncWindow::storableWrite(root, report);
 }
 
+bool CustomTableFuncWindow::calculateFunction()
+{
+    // Python code can take long, so the previous result is kept
+    // visible until the new one is calculated in the worker thread.
+    // If another code is running, the window is updated when it's finished
+    return FuncWindowHelpers::runCustomCode(this, schema(),
+        [this]{ function()->calculate(); }, [this]{ update(); });
+}
+
 void CustomTableFuncWindow::beforeUpdate()
 {
     if (_codeWindow) {
@@ -25,6 +25,7 @@ public:
 protected:
     void closeEvent(QCloseEvent* ce) override;
 
+    bool calculateFunction() override;
     void beforeUpdate() override;
     void beforeUpdateTable() override;
     void afterUpdate() override;
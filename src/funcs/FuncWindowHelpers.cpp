@@ -1,7 +1,17 @@
 #include "FuncWindowHelpers.h"
 
+#include "../app/AppSettings.h"
+#include "../core/PyRunner.h"
+#include "../core/Schema.h"
 #include "../math/FunctionBase.h"
 
+#include <QApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QPointer>
+#include <QProgressDialog>
+#include <QTimer>
+
 namespace FuncWindowHelpers {
 
 QString makeWindowTitle(FunctionBase* func)
@@ -21,4 +31,77 @@ QString makeWindowTitle(const QString &funcAlias, const QString &funcName)
     return funcName;
 }
 
+bool runCustomCode(QWidget *parent, Schema *schema, const std::function<void()> &calc,
+                   const std::function<void()> &retry)
+{
+    if (PyWorker::isRunning())
+    {
+        if (!retry)
+        {
+            qWarning() << "FuncWindowHelpers::runCustomCode: another custom code is still running";
+            return false;
+        }
+        static const char *retryProp = "customCodeRetryPending";
+        if (parent && parent->property(retryProp).toBool())
+            return false;
+        if (parent)
+            parent->setProperty(retryProp, true);
+        QPointer<QWidget> guard(parent);
+        PyWorker::whenIdle([guard, hasParent = bool(parent), retry]{
+            if (!hasParent)
+                retry();
+            else if (guard)
+            {
+                guard->setProperty(retryProp, false);
+                retry();
+            }
+        });
+        return false;
+    }
+
+    // The code can change element parameters,
+    // listeners should not get events from the worker thread
+    SchemaEventsBatch batch(schema);
+
+    QEventLoop loop;
+    bool finished = false;
+    PyWorker::start(calc, [&loop, &finished]{
+        finished = true;
+        loop.quit();
+    });
+
+    QTimer timeout;
+    int timeoutSec = AppSettings::instance().pythonTimeoutSec;
+    if (timeoutSec > 0)
+    {
+        timeout.setSingleShot(true);
+        QObject::connect(&timeout, &QTimer::timeout, []{ PyWorker::interrupt(PyWorker::Timeout); });
+        timeout.start(timeoutSec * 1000);
+    }
+
+    // Don't show the dialog for fast calculations,
+    // but don't let user change something while the code is running
+    QTimer::singleShot(500, &loop, &QEventLoop::quit);
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+
+    if (!finished)
+    {
+        QProgressDialog dlg(qApp->translate("FuncWindowHelpers", "Custom code is running..."),
+                            qApp->translate("FuncWindowHelpers", "Cancel"), 0, 0, parent);
+        dlg.setWindowModality(Qt::ApplicationModal);
+        dlg.setAutoClose(false);
+        dlg.setAutoReset(false);
+        dlg.setMinimumDuration(0);
+        // The dialog should stay visible until the code is actually interrupted
+        QObject::disconnect(&dlg, &QProgressDialog::canceled, &dlg, &QProgressDialog::cancel);
+        QObject::connect(&dlg, &QProgressDialog::canceled, &dlg, [&dlg]{
+            dlg.setLabelText(qApp->translate("FuncWindowHelpers", "Cancelling..."));
+            PyWorker::interrupt(PyWorker::Cancel);
+        });
+        dlg.show();
+        loop.exec();
+    }
+    return true;
+}
+
 } // namespace FuncWindowHelpers
@@ -3,13 +3,31 @@
 
 #include <QString>
 
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QWidget;
+QT_END_NAMESPACE
+
 class FunctionBase;
+class Schema;
 
 namespace FuncWindowHelpers {
 
 QString makeWindowTitle(FunctionBase* func);
 QString makeWindowTitle(const QString &funcAlias, const QString &funcName);
 
+/// Runs a calculation calling custom python code in the PyWorker thread.
+/// The application stays responsive while the code is running, and if it takes long,
+/// a modal dialog is shown allowing to cancel the calculation.
+/// The code is also interrupted when it runs longer than AppSettings::pythonTimeoutSec.
+/// Schema events raised by the code are delivered after the calculation is finished.
+/// Returns false if the calculation was not started because another one is still running.
+/// Then @a retry is called when the running one is finished, so the caller can calculate
+/// with the newest state of the schema. Several retries requested for the same parent are merged.
+bool runCustomCode(QWidget *parent, Schema *schema, const std::function<void()> &calc,
+                   const std::function<void()> &retry = {});
+
 } // namespace FuncWindowHelpers
 
 #endif // FUNC_WINDOW_HELPERS_H
@@ -36,8 +36,9 @@ Z::WorkPlane MultibeamCausticWindow::workPlane() const
     return actnShowT->isChecked() ? Z::T : Z::S;
 }
 
-void MultibeamCausticWindow::pumpChanged(Schema*, PumpParams* p)
+void MultibeamCausticWindow::pumpChanged(Schema* s, PumpParams* p)
 {
+    MulticausticWindow::pumpChanged(s, p);
     // If pump is active, there will be recalcRequired, so skip double calculation.
     if (!p->isActive()) update();
 }
@@ -66,8 +67,9 @@ void MultibeamCausticWindow::pumpDeleting(Schema*, PumpParams* p)
         _lastSelectedPump = nullptr;
 }
 
-void MultibeamCausticWindow::pumpDeleted(Schema*, PumpParams*)
+void MultibeamCausticWindow::pumpDeleted(Schema* s, PumpParams* p)
 {
+    MulticausticWindow::pumpDeleted(s, p);
     if (!_lastSelectedPump)
         _lastSelectedPump = schema()->activePump();
     update();
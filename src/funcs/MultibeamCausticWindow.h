@@ -13,7 +13,7 @@ public:
 
     MultibeamCausticFunction* function() const { return dynamic_cast<MultibeamCausticFunction*>(_function); }
 
-    void pumpCreated(Schema*, PumpParams*) override { update(); }
+    void pumpCreated(Schema* s, PumpParams* p) override { MulticausticWindow::pumpCreated(s, p); update(); }
     void pumpChanged(Schema*, PumpParams* p) override;
     void pumpCustomized(Schema*, PumpParams* p) override;
     void pumpDeleting(Schema*, PumpParams*) override;
@@ -220,6 +220,8 @@ void MulticausticWindow::updateGraphs()
 
 void MulticausticWindow::schemaRebuilt(Schema* schema)
 {
+    PlotFuncWindowStorable::schemaRebuilt(schema);
+
     // We only have to ensure all arguments are in the same order as schema elements.
     // Don't recalculate here, recalculation will be done later on the intended event.
     QHash<Element*, Z::Variable> oldArgs;
@@ -232,8 +234,10 @@ void MulticausticWindow::schemaRebuilt(Schema* schema)
     function()->setArgs(newArgs);
 }
 
-void MulticausticWindow::elementChanged(Schema*, Element* elem)
+void MulticausticWindow::elementChanged(Schema* schema, Element* elem)
 {
+    PlotFuncWindowStorable::elementChanged(schema, elem);
+
     // Only modify the set of arguments, don't recalculate here,
     // recalculation will be done later on the intended event.
     auto args = function()->args();
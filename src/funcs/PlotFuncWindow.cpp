@@ -28,6 +28,8 @@
 #include "qcpl_io_json.h"
 #include "qcpl_plot.h"
 
+#include <QThreadPool>
+
 using namespace Ori::Gui::V0;
 
 enum PlotWindowStatusPanels
@@ -52,10 +54,19 @@ PlotFuncWindow::PlotFuncWindow(PlotFunction *func) : SchemaMdiChild(func->schema
     createStatusBar();
 
     updatePlotItemToggleActions();
+
+    // Jobs are queued in the own pool in order not to wait for jobs of other windows in destructor.
+    // One thread is enough, superseded job gets cancelled before the next one starts
+    // and a job itself can spread its calculation over several threads.
+    _jobPool = new QThreadPool(this);
+    _jobPool->setMaxThreadCount(1);
 }
 
 PlotFuncWindow::~PlotFuncWindow()
 {
+    cancelJob();
+    _jobPool->waitForDone();
+
     delete _function;
     delete _graphs;
 }
@@ -546,7 +557,58 @@ void PlotFuncWindow::update()
         return;
     }
 
+    // The previous result is still displayed until the new one is ready
+    if (calculateInBackground())
+        return;
+
     calculate();
+    showResults();
+}
+
+bool PlotFuncWindow::calculateInBackground()
+{
+    cancelJob();
+
+    auto job = _function->prepareJob();
+    if (!job)
+        return false;
+
+    _job = job;
+    _jobPool->start([this, job]{
+        job->run();
+        // The window waits for the pool in destructor, so it's still alive here,
+        // and queued call is dropped by Qt if the window gets deleted before delivery
+        QMetaObject::invokeMethod(this, [this, job]{ jobFinished(job); }, Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void PlotFuncWindow::cancelJob()
+{
+    if (!_job) return;
+    _job->cancel();
+    _job.reset();
+    // Drop jobs that are not started yet
+    _jobPool->clear();
+}
+
+void PlotFuncWindow::jobFinished(PlotFuncJobPtr job)
+{
+    // Results of superseded calculation are thrown away
+    if (job != _job || job->isCancelled())
+        return;
+    _job.reset();
+
+    _function->applyJob(job.get());
+    showFunctionResult();
+    showResults();
+}
+
+void PlotFuncWindow::showResults()
+{
+    // Dependencies of a failed calculation are unknown, then any change should make it recalculate,
+    // e.g. a change of an element that was not in the cone of the last successful result can fix the error
+    _cone = _function->ok() ? _function->dependencyCone() : std::nullopt;
 
     if (_autolimitsRequest)
     {
@@ -574,6 +636,11 @@ void PlotFuncWindow::update()
 void PlotFuncWindow::calculate()
 {
     _function->calculate();
+    showFunctionResult();
+}
+
+void PlotFuncWindow::showFunctionResult()
+{
     if (!_function->ok())
     {
         showStatusError(_function->errorText());
@@ -621,6 +688,39 @@ void PlotFuncWindow::showRoundTrip()
     InfoFuncWindow::open(new PlotFuncRoundTripFunction(windowTitle(), _function), this);
 }
 
+void PlotFuncWindow::markChanged(bool inCone)
+{
+    if (inCone)
+        _changedInCone = true;
+    else
+        _changedOutOfCone = true;
+}
+
+void PlotFuncWindow::elementChanged(Schema*, Element* elem)
+{
+    markChanged(!_cone || _cone->check(elem));
+}
+
+void PlotFuncWindow::globalParamChanged(Schema*, Z::Parameter* param)
+{
+    markChanged(!_cone || _cone->check(param));
+}
+
+void PlotFuncWindow::recalcRequired(Schema*)
+{
+    // Recalculation is skipped only when it's known what is changed
+    // and all the changes are outside of the dependency cone of the function
+    bool skip = _changedOutOfCone && !_changedInCone;
+    _changedInCone = false;
+    _changedOutOfCone = false;
+    if (skip)
+    {
+        Z_REPORT("Recalculation skipped, no changes in dependencies:" << _function->name())
+        return;
+    }
+    update();
+}
+
 void PlotFuncWindow::freeze(bool frozen)
 {
     _frozen = frozen;
@@ -15,6 +15,7 @@ QT_BEGIN_NAMESPACE
 class QAction;
 class QLabel;
 class QSplitter;
+class QThreadPool;
 QT_END_NAMESPACE
 
 class QCPAxis;
@@ -108,7 +109,19 @@ public:
     QString helpTopic() const override { return _function->helpTopic(); }
 
     // Implementation of SchemaListener
-    void recalcRequired(Schema*) override { update(); }
+    void recalcRequired(Schema*) override;
+    void elementChanged(Schema*, Element*) override;
+    void globalParamChanged(Schema*, Z::Parameter*) override;
+    // These changes can affect the function result regardless of its dependency cone
+    void elementCreated(Schema*, Element*) override { markChanged(true); }
+    void elementDeleted(Schema*, Element*) override { markChanged(true); }
+    void schemaRebuilt(Schema*) override { markChanged(true); }
+    void schemaLoaded(Schema*) override { markChanged(true); }
+    void schemaParamsChanged(Schema*) override { markChanged(true); }
+    void schemaLambdaChanged(Schema*) override { markChanged(true); }
+    void pumpCreated(Schema*, PumpParams*) override { markChanged(true); }
+    void pumpChanged(Schema*, PumpParams*) override { markChanged(true); }
+    void pumpDeleted(Schema*, PumpParams*) override { markChanged(true); }
     void elementDeleting(Schema*, Element*) override;
     void globalParamDeleting(Schema*, Z::Parameter*) override;
     void customParamDeleting(Z::Parameter*) override;
@@ -168,6 +181,11 @@ protected:
         *actnFormatCursor, *actnFormatGraphT, *actnFormatGraphS, *actnFormatGraph;
     SelectGraphOptions _selectGraphOptions;
     std::optional<QPen> _cursorPen, _graphPenT, _graphPenS;
+    PlotFuncJobPtr _job; ///< Calculation running in background, see @a PlotFunction::prepareJob().
+    QThreadPool* _jobPool;
+    std::optional<PlotFuncDeps> _cone; ///< Dependency cone of the last calculated result.
+    bool _changedInCone = false;
+    bool _changedOutOfCone = false;
 
     // Stores differences of plot view when function is switched betweeen modes
     // e.g. when the Caustic function switches between W and R.
@@ -256,6 +274,12 @@ private:
     void graphSelected(QCPGraph *);
     void graphsMenuAboutToShow();
     void updateCursorInfo();
+    void showResults();
+    void showFunctionResult();
+    void markChanged(bool inCone);
+    bool calculateInBackground();
+    void cancelJob();
+    void jobFinished(PlotFuncJobPtr job);
 
     friend class BeamShapeExtension;
 };
@@ -161,9 +161,11 @@ void PlotFuncWindowV2::update()
         return;
     }
 
+    if (!calculateFunction())
+        return;
+
     clearGraphs();
 
-    _function->calculate();
     if (!_function->ok())
     {
         showStatusError(_function->errorText());
@@ -217,6 +219,12 @@ void PlotFuncWindowV2::updateStatusUnits()
         unitY == Z::Units::none() ? QStringLiteral("n/a") : unitY->name()));
 }
 
+bool PlotFuncWindowV2::calculateFunction()
+{
+    _function->calculate();
+    return true;
+}
+
 void PlotFuncWindowV2::clearGraphs()
 {
     for (auto g : std::as_const(_graphs))
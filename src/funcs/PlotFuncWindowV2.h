@@ -74,6 +74,8 @@ protected:
     void graphFormatted(QCPGraph*) override;
 
     virtual bool configureInternal() { return true; }
+    /// Returns false if the function was not calculated and the previous result should be kept.
+    virtual bool calculateFunction();
     virtual void beforeUpdate() {}
     virtual void afterUpdate() {}
     virtual Z::Unit getDefaultUnitX() const { return Z::Units::none(); }
@@ -52,7 +52,7 @@ void StabilityMap2DParamsDlg::makeControls(const QString &title, Schema* schema,
     });
     connect(editor->elemSelector, &ElemAndParamSelector::selectionChanged, this, [this, editor]{ this->guessRange(editor); });
 
-    editor->rangeEditor = new GeneralRangeEditor;
+    editor->rangeEditor = new GeneralRangeEditor(true);
 
     editor->groupBox = new QGroupBox(title);
 
@@ -376,7 +376,9 @@ void TableFuncWindow::update()
         return;
     }
 
-    _function->calculate();
+    if (!calculateFunction())
+        return;
+
     if (!_function->ok())
     {
         _errorView->setHtml(QString("<p style='color:red;font-size:13pt;margin:1em;'><br>%1</p>").arg(_function->errorText()));
@@ -395,6 +397,12 @@ void TableFuncWindow::update()
     afterUpdate();
 }
 
+bool TableFuncWindow::calculateFunction()
+{
+    _function->calculate();
+    return true;
+}
+
 void TableFuncWindow::activateModeT()
 {
     if (!_actnShowT->isChecked() && !_actnShowS->isChecked())
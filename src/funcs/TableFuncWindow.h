@@ -114,6 +114,8 @@ protected:
     QMenu *_menuTable;
     
     virtual bool configureInternal(const TableFunction::Params&);
+    /// Returns false if the function was not calculated and the previous result should be kept.
+    virtual bool calculateFunction();
     virtual void beforeUpdate() {}
     virtual void afterUpdate() {}
     virtual void beforeUpdateTable() {}
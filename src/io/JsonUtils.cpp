@@ -148,6 +148,7 @@ QJsonObject writeVariableRange(const VariableRange& range)
         { "step", writeValue(range.step) },
         { "points", range.points },
         { "use_step", range.useStep },
+        { "tolerance", range.tolerance },
     });
 }
 
@@ -164,6 +165,7 @@ QString readVariableRange(const QJsonObject& json, VariableRange& range, Dim dim
     range.step = resStep.value();
     range.points = json["points"].toInt(100);
     range.useStep = json["use_step"].toBool();
+    range.tolerance = json["tolerance"].toDouble(0);
     return QString();
 }
 
@@ -1,4 +1,5 @@
 #include "app/Appearance.h"
+#include "app/BatchRunner.h"
 #include "core/Format.h"
 #include "core/Protocol.h"
 #include "tests/TestSuite.h"
@@ -29,6 +30,11 @@
 
 int main(int argc, char* argv[])
 {
+    // Batch mode doesn't need GUI, so it must be detected before QApplication is created
+    for (int i = 1; i < argc; i++)
+        if (qstrcmp(argv[i], "--batch") == 0 || qstrcmp(argv[i], "-batch") == 0)
+            return BatchRunner::main(argc, argv);
+
 #if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling, true);
     QCoreApplication::setAttribute(Qt::AA_UseHighDpiPixmaps, true);
@@ -49,10 +55,11 @@ int main(int argc, char* argv[])
     parser.setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
     QCommandLineOption optionTest("test", "Run unit-test session.");
     QCommandLineOption optionTool("tool", "Run a tool: gauss, calc, elems, funcs, grin, lens", "name");
+    QCommandLineOption optionBatch("batch", "Calculate functions of project files without GUI, see --batch --help");
     QCommandLineOption optionDevMode("dev"); optionDevMode.setFlags(QCommandLineOption::HiddenFromHelp);
     QCommandLineOption optionConsole("console"); optionConsole.setFlags(QCommandLineOption::HiddenFromHelp);
     QCommandLineOption optionExample("example"); optionExample.setFlags(QCommandLineOption::HiddenFromHelp);
-    parser.addOptions({optionTest, optionTool, optionDevMode, optionConsole, optionExample});
+    parser.addOptions({optionTest, optionTool, optionBatch, optionDevMode, optionConsole, optionExample});
 
     if (!parser.parse(QApplication::arguments()))
     {
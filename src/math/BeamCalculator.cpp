@@ -47,8 +47,24 @@ BeamCalculator::~BeamCalculator()
 
 void BeamCalculator::calcRoundTrip(Element *ref, bool splitRange, const char *reason)
 {
-    if (_rt) delete _rt;
     _ref = ref;
+    if (_referenceSweep)
+    {
+        if (!_rt)
+        {
+            // Round-trip at the last element contains all elements for any trip type
+            auto elems = _schema->activeElements();
+            _rt = new RoundTripCalculator(_schema, elems.isEmpty() ? nullptr : elems.last());
+            _rt->calcRoundTrip();
+            _rt->beginReferenceSweep();
+        }
+        if (_rt->multMatrixAtReference(ref, splitRange))
+            return;
+        // The reference is out of the round-trip, e.g. it is disabled,
+        // calculate round-trips in the usual way to get a consistent result
+        _referenceSweep = false;
+    }
+    if (_rt) delete _rt;
     _rt = new RoundTripCalculator(_schema, ref);
     _rt->calcRoundTrip(splitRange);
     _rt->multMatrix(reason);
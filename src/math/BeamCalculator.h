@@ -17,6 +17,12 @@ public:
     ~BeamCalculator();
     
     void calcRoundTrip(Element *ref, bool splitRange, const char *reason);
+
+    /// Enables calculation of round-trips at successive references in a single pass through the schema,
+    /// see RoundTripCalculator::beginReferenceSweep(). Then only round-trip matrices are valid
+    /// after calcRoundTrip(), but not the matrices it consists of (see matrix(int), elem(int), matrixCount()).
+    /// Element matrices must not change between calcRoundTrip() calls, except of sub-ranges of references.
+    void setReferenceSweep(bool on) { _referenceSweep = on; }
     
     Z::WorkPlane plane() const { return _ts; }
     void setPlane(Z::WorkPlane ts) { _ts = ts; }
@@ -50,6 +56,7 @@ private:
     AbcdCalculator *_abcd = nullptr;
     RoundTripCalculator *_rt = nullptr;
     double _ior = 1;
+    bool _referenceSweep = false;
 };
 
 #endif // BEAM_CALCULATOR_H
@@ -54,15 +54,15 @@ void BeamVariationFunction::calculate(CalculationMode calcMode)
     auto unitX = range.unit();
 
     ElementEventsLocker elemLock(param, "BeamVariationFunction::calculate");
-    Z::ParamValueBackup paramLock(param, "BeamVariationFunction::calculate");
+    ParamSweep sweep(param, "BeamVariationFunction::calculate");
+
+    _calc->setVariedElements(sweep.elems());
 
-    Z_PERF_RESET
     Z_PERF_BEGIN("BeamVariationFunction")
 
-    for (auto x : range.values())
-    {
+    auto points = FunctionUtils::sample(range, [&](double x){
         Z_PERF_BEGIN("setValue")
-        param->setValue({x, unitX});
+        sweep.setValue({x, unitX});
         Z_PERF_END
 
         Z_PERF_BEGIN("recalcSubrange")
@@ -81,13 +81,15 @@ void BeamVariationFunction::calculate(CalculationMode calcMode)
         _calc->multMatrix("BeamVariationFunction::calculate");
         Z_PERF_END
 
-        Z_PERF_BEGIN("addResultPoint")
-        addResultPoint(x, isResonator ? calculateResonator() : calculateSinglePass());
-        Z_PERF_END
-    }
+        return isResonator ? calculateResonator() : calculateSinglePass();
+    });
+
+    Z_PERF_BEGIN("addResultPoint")
+    for (const auto& p : points)
+        addResultPoint(p.x, p.y);
+    Z_PERF_END
 
     Z_PERF_END
-    Z_PERF_PRINT
 
     finishResults();
 }
@@ -96,7 +98,7 @@ Z::PointTS BeamVariationFunction::calculateAt(const Z::Value& v)
 {
     auto param = arg()->parameter;
     ElementEventsLocker elemLock(param, "BeamVariationFunction::calculateAt");
-    Z::ParamValueBackup paramLock(param, "BeamVariationFunction::calculateAt");
+    ParamSweep sweep(param, "BeamVariationFunction::calculateAt");
     auto rangeElem = Z::Utils::asRange(_pos.element);
     if (rangeElem) {
         auto offset = _pos.offset.toSi();
@@ -106,7 +108,7 @@ Z::PointTS BeamVariationFunction::calculateAt(const Z::Value& v)
             offset += rangeElem->axisLengthSI();
         rangeElem->setSubRangeSI(offset);
     }
-    param->setValue(v);
+    sweep.setValue(v);
     bool isResonator = _schema->isResonator();
     if (!isResonator)
     {
@@ -8,10 +8,56 @@
 #include "../math/GaussCalculator.h"
 #include "../math/PumpCalculator.h"
 #include "../math/RoundTripCalculator.h"
+#include "../math/SchemaSnapshot.h"
 
 #include <QApplication>
 #include <QDebug>
 
+namespace {
+
+template <typename BeamCalc>
+Z::PointTS beamParams(const BeamCalc& beamCalc, CausticFunction::Mode mode, const Z::Matrix& mt, const Z::Matrix& ms, double ior)
+{
+    switch (mode)
+    {
+    case CausticFunction::BeamRadius: return beamCalc.beamRadius(mt, ms, ior);
+    case CausticFunction::FrontRadius: return beamCalc.frontRadius(mt, ms, ior);
+    case CausticFunction::HalfAngle: return beamCalc.halfAngle(mt, ms, ior);
+    }
+    qCritical() << "Unsupported caustic result mode";
+    return { Double::nan(), Double::nan() };
+}
+
+class CausticJob : public PlotFuncJob
+{
+public:
+    Z::PlottingRange range;
+    CausticFunction::Mode mode;
+    double ior = 0;
+    int elem = -1;
+    std::unique_ptr<SnapshotCalculator> calc;
+    // Only one of calculators is set depending on the schema kind
+    std::shared_ptr<PumpCalculator> pumpCalc;
+    std::shared_ptr<AbcdCalculator> beamCalc;
+    QVector<FunctionUtils::SamplePoint> points;
+
+    void run() override
+    {
+        points = FunctionUtils::sample(range, [this](double x){
+            // Sampling can't be stopped, but remaining points are skipped quickly
+            if (isCancelled())
+                return Z::PointTS(Double::nan(), Double::nan());
+            calc->setSubRange(elem, x);
+            calc->multMatrix();
+            return beamCalc
+                ? beamParams(*beamCalc, mode, calc->Mt(), calc->Ms(), ior)
+                : beamParams(*pumpCalc, mode, calc->Mt(), calc->Ms(), ior);
+        });
+    }
+};
+
+} // namespace
+
 Z::VariableRange CausticFunction::givenRange()
 {
     auto range = arg()->range;
@@ -35,7 +81,17 @@ void CausticFunction::calculate(CalculationMode calcMode)
 
     auto range = givenRange().plottingRange();
     if (!prepareResults(range)) return;
-    if (!prepareCalculator(elem, true)) return;
+
+    // When the round-trip at the range start is given by the reference sweep,
+    // the own round-trip is not built until it's needed, see prepareRoundTrip()
+    bool isSweep = false;
+    if (_referenceSweep && calcMode == CALC_PLOT)
+    {
+        if (_calc) delete _calc;
+        _calc = new RoundTripCalculator(_schema, elem);
+        isSweep = _calc->beginSubrangeSweep(_referenceSweep);
+    }
+    if (!isSweep && !prepareCalculator(elem, true)) return;
 
     bool isResonator = _schema->isResonator();
     bool isPrepared = isResonator
@@ -49,50 +105,78 @@ void CausticFunction::calculate(CalculationMode calcMode)
             ? &CausticFunction::calculateResonator
             : &CausticFunction::calculateSinglePass;
 
+    // Round-trip is only multiplied once when the beam can be propagated from the range start,
+    // see RoundTripCalculator::beginSubrangeSweep()
+    if (!isSweep)
+        isSweep = _calc->beginSubrangeSweep();
+
     // Calculate round-trip matrix and check if the caustic can be calculated
-    elem->setSubRangeSI(range.values().first());
-    _calc->multMatrix("CausticFunction::calculate");
-    if (isResonator) // Can't be calculated for unstable resonator
+    if (!isSweep)
+    {
+        elem->setSubRangeSI(range.values().first());
+        _calc->multMatrix("CausticFunction::calculate");
+    }
+    if (!checkBeamCanBeCalculated()) return;
+
+    auto points = FunctionUtils::sample(range, [&](double x){
+        if (isSweep)
+            _calc->multMatrixAtSubrange(x);
+        else
+        {
+            elem->setSubRangeSI(x);
+            _calc->multMatrix("CausticFunction::calculate");
+        }
+
+        if (_writeProtocol)
+        {
+            Z_INFO("Offset" << x)
+            Z_INFO("Mt =" << _calc->Mt().str() << "| Ms =" << _calc->Ms().str())
+        }
+
+        return (this->*calcBeamParams)();
+    });
+
+    addResults(points);
+}
+
+bool CausticFunction::checkBeamCanBeCalculated()
+{
+    if (_schema->isResonator()) // Can't be calculated for unstable resonator
     {
         auto stab = _calc->isStable();
         if (!stab.T && !stab.S)
         {
             setError(qApp->translate("Calc error", "System is unstable, can't calculate caustic"));
-            return;
+            return false;
         }
     }
     // Caustic can't be calculated for SP-system with geometric pump and complex matrices
     else if (Pumps::isGeometric(_pump) && (!_calc->Mt().isReal() || !_calc->Ms().isReal()))
     {
         setError(qApp->translate("Calc error", "Geometric pump can't be used with complex matrices"));
-        return;
+        return false;
     }
+    return true;
+}
 
+void CausticFunction::addResults(const QVector<FunctionUtils::SamplePoint>& points)
+{
     Z::PointTS prevRes(Double::nan(), Double::nan());
-    for (auto x : range.values())
+    for (const auto& p : points)
     {
-        elem->setSubRangeSI(x);
-        _calc->multMatrix("CausticFunction::calculate");
-
-        if (_writeProtocol)
-        {
-            Z_INFO("Offset" << x)
-            Z_INFO("Mt =" << _calc->Mt().str() << "| Ms =" << _calc->Ms().str())
-        }
-
-        Z::PointTS res = (this->*calcBeamParams)();
+        const Z::PointTS& res = p.y;
 
         if (_mode == FrontRadius)
         {
             // If wavefront radius changes its sign, then we have a pole at waist
             if (!std::isnan(prevRes.T) && (prevRes.T * res.T) < 0)
-                _results.T.addPoint(x, Double::nan()); // finish previous segment
+                _results.T.addPoint(p.x, Double::nan()); // finish previous segment
             if (!std::isnan(prevRes.S) && (prevRes.S * res.S) < 0)
-                _results.S.addPoint(x, Double::nan()); // finish previous segment
+                _results.S.addPoint(p.x, Double::nan()); // finish previous segment
             prevRes = res;
         }
 
-        addResultPoint(x, res);
+        addResultPoint(p.x, res);
     }
 
     finishResults();
@@ -121,30 +205,94 @@ bool CausticFunction::prepareResonator()
 
 Z::PointTS CausticFunction::calculateSinglePass() const
 {
-    switch (_mode)
+    return beamParams(*_pumpCalc, _mode, _calc->Mt(), _calc->Ms(), _ior);
+}
+
+Z::PointTS CausticFunction::calculateResonator() const
+{
+    return beamParams(*_beamCalc, _mode, _calc->Mt(), _calc->Ms(), _ior);
+}
+
+PlotFuncJobPtr CausticFunction::prepareJob()
+{
+    if (!checkArgElem()) return {};
+
+    auto elem = Z::Utils::asRange(arg()->element);
+    if (!elem) return {};
+
+    // The point is moved along the range by the element kernel outside of the schema
+    if (!elem->matrixKernel().calcSubmatrices) return {};
+
+    auto range = givenRange().plottingRange();
+    if (range.points() < 2) return {};
+
+    if (!prepareCalculator(elem, true)) return {};
+
+    _ior = elem->ior();
+
+    // Dynamic elements are prepared in the live schema and their matrices are taken into the snapshot
+    bool isResonator = _schema->isResonator();
+    bool isPrepared = isResonator
+            ? prepareResonator()
+            : prepareSinglePass(elem);
+    if (!isPrepared) return {};
+
+    elem->setSubRangeSI(range.values().first());
+    _calc->multMatrix("CausticFunction::prepareJob");
+    if (!checkBeamCanBeCalculated()) return {};
+
+    auto snapshot = std::make_shared<const SchemaSnapshot>(_schema);
+    auto roundTrip = snapshot->roundTrip(*_calc);
+    if (roundTrip.isEmpty()) return {};
+
+    auto job = std::make_shared<CausticJob>();
+    job->range = range;
+    job->mode = _mode;
+    job->ior = _ior;
+    job->elem = snapshot->indexOf(elem);
+    job->calc = std::make_unique<SnapshotCalculator>(snapshot);
+    job->calc->setRoundTrip(roundTrip, {job->elem});
+    if (isResonator)
+        job->beamCalc = _beamCalc;
+    else
+        job->pumpCalc = _pumpCalc;
+    return job;
+}
+
+void CausticFunction::applyJob(PlotFuncJob* job)
+{
+    auto causticJob = dynamic_cast<CausticJob*>(job);
+    if (!causticJob) return;
+    if (!prepareResults(causticJob->range)) return;
+    addResults(causticJob->points);
+}
+
+void CausticFunction::prepareRoundTrip()
+{
+    if (_calc && _calc->isEmpty())
     {
-    case BeamRadius: return _pumpCalc->beamRadius(_calc->Mt(), _calc->Ms(), _ior);
-    case FrontRadius: return _pumpCalc->frontRadius(_calc->Mt(), _calc->Ms(), _ior);
-    case HalfAngle: return _pumpCalc->halfAngle(_calc->Mt(), _calc->Ms(), _ior);
+        // Matrices are multiplied at the current offset, where the last point was calculated
+        _calc->calcRoundTrip(true);
+        _calc->multMatrix("CausticFunction::prepareRoundTrip");
     }
-    qCritical() << "Unsupported caustic result mode";
-    return { Double::nan(), Double::nan() };
 }
 
-Z::PointTS CausticFunction::calculateResonator() const
+std::optional<PlotFuncDeps> CausticFunction::dependencyCone() const
 {
-    switch (_mode)
+    // The round-trip is not built when calculated with the reference sweep,
+    // but in resonators it consists of all active elements anyway
+    if (_calc && _calc->isEmpty() && _schema->isResonator())
     {
-    case BeamRadius: return _beamCalc->beamRadius(_calc->Mt(), _calc->Ms(), _ior);
-    case FrontRadius: return _beamCalc->frontRadius(_calc->Mt(), _calc->Ms(), _ior);
-    case HalfAngle: return _beamCalc->halfAngle(_calc->Mt(), _calc->Ms(), _ior);
+        auto cone = PlotFuncDeps::cone(_schema, _schema->activeElements());
+        cone.merge(dependsOn());
+        return cone;
     }
-    qCritical() << "Unsupported caustic result mode";
-    return Z::PointTS();
+    return PlotFunction::dependencyCone();
 }
 
 Z::PointTS CausticFunction::calculateAt(const Z::Value &arg)
 {
+    prepareRoundTrip();
     double argSI = arg.toSi();
     auto elem = Z::Utils::asRange(this->arg()->element);
     double x = qMin(qMax(argSI, 0.0), elem->axisLengthSI());
@@ -205,6 +353,7 @@ QString CausticFunction::beamsizeSymbol() const
 QString CausticFunction::calculateSpecPoints(const SpecPointParams &params)
 {
     if (!ok()) return QString();
+    prepareRoundTrip();
 
     bool isResonator = _schema->isResonator();
     bool isGauss = isResonator || _pumpCalc->isGauss();
@@ -1,6 +1,7 @@
 #ifndef CAUSTIC_FUNCTION_H
 #define CAUSTIC_FUNCTION_H
 
+#include "../math/FunctionUtils.h"
 #include "../math/PlotFunction.h"
 
 #include <memory>
@@ -35,6 +36,10 @@ public:
     bool hasOptions() const override { return true; }
     bool hasSpecPoints() const override { return true; }
     QString calculateSpecPoints(const SpecPointParams& params) override;
+    std::optional<PlotFuncDeps> dependencyCone() const override;
+    void prepareRoundTrip() override;
+    PlotFuncJobPtr prepareJob() override;
+    void applyJob(PlotFuncJob* job) override;
 
     QString valueSymbol() const;
     QString beamsizeSymbol() const;
@@ -42,6 +47,11 @@ public:
     Mode mode() const { return _mode; }
     void setMode(Mode mode) { _mode = mode; }
 
+    /// Calculator prepared with RoundTripCalculator::beginReferenceSweep() giving the round-trip
+    /// at the start of the range, so the function neither builds nor multiplies its own round-trip.
+    /// Only used by calculate(), the calculator is not owned by the function.
+    void setReferenceSweep(RoundTripCalculator* calc) { _referenceSweep = calc; }
+
     static QString modeAlias(Mode mode);
     static QString modeDisplayName(Mode mode);
 private:
@@ -55,12 +65,15 @@ private:
     std::shared_ptr<PumpCalculator> _pumpCalc;
     std::shared_ptr<AbcdCalculator> _beamCalc;
     bool _writeProtocol = false;
+    RoundTripCalculator* _referenceSweep = nullptr;
 
     bool prepareSinglePass(Element *ref);
     bool prepareResonator();
     inline Z::PointTS calculateSinglePass() const;
     inline Z::PointTS calculateResonator() const;
     Z::VariableRange givenRange();
+    bool checkBeamCanBeCalculated();
+    void addResults(const QVector<FunctionUtils::SamplePoint>& points);
 };
 
 #endif // CAUSTIC_FUNCTION_H
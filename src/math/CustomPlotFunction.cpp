@@ -46,18 +46,31 @@ bool CustomPlotFunction::prepare()
     _errorLog.clear();
     _errorLine = 0;
     
-    std::shared_ptr<PyRunner> py(new PyRunner);
-    py->schema = schema();
-    py->code = _code;
-    py->moduleName = _moduleName;
-    py->funcNames = { FUNC_FIGURE, FUNC_CALC };
-    py->funcNamesOptional = { CustomFuncUtils::funcNameMeta() };
-    py->printFunc = _printFunc;
-    
-    if (!py->load()) {
-        showError(py.get());
-        return false;
+    // The module is loaded once and then kept between recalculations,
+    // it only gets reloaded when the code or the module it's loaded as changes
+    if (!_runner || _runner->code != _code || _runner->moduleName != _moduleName)
+    {
+        _runner.reset();
+        std::shared_ptr<PyRunner> py(new PyRunner);
+        py->schema = schema();
+        py->code = _code;
+        py->moduleName = _moduleName;
+        py->funcNames = { FUNC_FIGURE, FUNC_CALC };
+        py->funcNamesOptional = { CustomFuncUtils::funcNameMeta() };
+        py->printFunc = _printFunc;
+
+        if (!py->load()) {
+            showError(py.get());
+            return false;
+        }
+        _runner = py;
     }
+    else
+    {
+        _runner->printFunc = _printFunc;
+        _runner->resetErrors();
+    }
+    auto py = _runner;
     
     _customTitle = py->codeTitle;
     
@@ -83,14 +96,8 @@ bool CustomPlotFunction::prepare()
     
     if (!_helpTopic)
         _helpTopic = CustomFuncUtils::helpTopic(py.get(), HELP_TOPIC);
-        
-    _runner = py;
-    return true;
-}
 
-void CustomPlotFunction::unprepare()
-{
-    _runner.reset();
+    return true;
 }
 
 void CustomPlotFunction::calculateInternal()
@@ -116,10 +123,7 @@ void CustomPlotFunction::calculateInternal()
             showError("Lengths of X and Y arrays do not match");
             return;
         }
-        int cnt = x.size();
-        for (int i = 0; i < cnt; i++)
-            addPoint(id, x.at(i), y.at(i));
-        endLine(id);
+        addLine(id, std::move(x), std::move(y));
     }
 }
 
@@ -44,7 +44,6 @@ private:
 
     // Inherited from PlotFunctionV2
     bool prepare() override;
-    void unprepare() override;
     void calculateInternal() override;
     
     void showError(PyRunner *py);
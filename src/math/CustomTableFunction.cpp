@@ -4,11 +4,13 @@
 #include "CustomFuncUtils.h"
 #include "RoundTripCalculator.h"
 #include "../core/PyRunner.h"
+#include "../core/Schema.h"
 
 #include <QApplication>
 
 #define FUNC_COLUMNS QStringLiteral("columns")
 #define FUNC_CALC QStringLiteral("calculate")
+#define FUNC_CALC_BATCH QStringLiteral("calculate_batch")
 #define COL_LABEL QStringLiteral("label")
 #define COL_TITLE QStringLiteral("title")
 #define COL_DIM QStringLiteral("dim")
@@ -23,6 +25,25 @@ CustomTableFunction::CustomTableFunction(Schema *schema) : TableFunction(schema)
 
 QVector<Z::PointTS> CustomTableFunction::calculateInternal(const ResultElem &resultElem)
 {
+    if (_useBatch) {
+        if (_columns.isEmpty())
+            return {};
+        // Values are calculated later for all positions at once, see calculateResults()
+        _beamCalc->setPlane(Z::T);
+        auto mt = _beamCalc->matrix();
+        _beamCalc->setPlane(Z::S);
+        auto ms = _beamCalc->matrix();
+        _batch << BatchItem {
+            .elem = resultElem.elem,
+            .pos = resultElem.pos,
+            .absPos = (int)resultPositionInfo(resultElem.pos).absPos,
+            .ior = _beamCalc->ior(),
+            .mt = mt,
+            .ms = ms,
+        };
+        return QVector<Z::PointTS>(_columns.size(), Z::PointTS(qQNaN(), qQNaN()));
+    }
+
     PyRunner::ResultSpec resultSpec;
     for (const auto &col : std::as_const(_columns))
         resultSpec.insert(col.label, PyRunner::ftNumber);
@@ -63,6 +84,118 @@ QVector<Z::PointTS> CustomTableFunction::calculateInternal(const ResultElem &res
     return res;
 }
 
+void CustomTableFunction::calculateResults(QVector<Result> &results)
+{
+    if (!_useBatch || _batch.isEmpty())
+        return;
+
+    QVector<QVector<double>> valuesT, valuesS;
+    if (!calculateBatch(valuesT, valuesS)) {
+        _batch.clear();
+        return;
+    }
+
+    // Results contain all the batch positions in the same order,
+    // and maybe some rows not calculated by the function (e.g. pump params)
+    QVector<Result> newResults;
+    newResults.reserve(results.size());
+    int index = 0;
+    for (const auto &r : std::as_const(results)) {
+        if (index >= _batch.size() || r.element != _batch.at(index).elem || r.position != _batch.at(index).pos) {
+            newResults << r;
+            continue;
+        }
+        // The function is not applicable for a position if all its values are NaN
+        bool hasValues = false;
+        QVector<Z::PointTS> values;
+        values.reserve(_columns.size());
+        for (int col = 0; col < _columns.size(); col++) {
+            double t = valuesT.at(col).at(index);
+            double s = valuesS.at(col).at(index);
+            if (!qIsNaN(t) || !qIsNaN(s))
+                hasValues = true;
+            values << Z::PointTS(t, s);
+        }
+        if (hasValues) {
+            newResults << r;
+            newResults.last().values = values;
+        }
+        index++;
+    }
+    results = newResults;
+    _batch.clear();
+}
+
+bool CustomTableFunction::calculateBatch(QVector<QVector<double>> &valuesT, QVector<QVector<double>> &valuesS)
+{
+    const int count = _batch.size();
+    QVector<void*> elems(count);
+    QVector<int> positions(count);
+    QVector<double> iors(count);
+    // Round-trip matrices of all positions in contiguous arrays [A0, B0, C0, D0, A1, B1, ...]
+    QVector<double> matricesT(count * 4);
+    QVector<double> matricesS(count * 4);
+    auto putMatrix = [](QVector<double> &matrices, int i, const Z::Matrix &m) {
+        matrices[i*4 + 0] = m.A.real();
+        matrices[i*4 + 1] = m.B.real();
+        matrices[i*4 + 2] = m.C.real();
+        matrices[i*4 + 3] = m.D.real();
+    };
+    for (int i = 0; i < count; i++) {
+        const auto &item = _batch.at(i);
+        elems[i] = item.elem;
+        positions[i] = item.absPos;
+        iors[i] = item.ior;
+        putMatrix(matricesT, i, item.mt);
+        putMatrix(matricesS, i, item.ms);
+    }
+
+    // Both planes are passed in a single call, so the code converts
+    // elements and positions only once and can calculate planes together
+    PyRunner::Args args {
+        { PyRunner::atElementArray, QVariant::fromValue(elems) },
+        { PyRunner::atIntArray, QVariant::fromValue(positions) },
+        { PyRunner::atNumberArray, QVariant::fromValue(iors) },
+        { PyRunner::atNumberArray, QVariant::fromValue(matricesT) },
+        { PyRunner::atNumberArray, QVariant::fromValue(matricesS) },
+    };
+
+    PyRunner::ResultSpec resultSpec;
+    for (const auto &col : std::as_const(_columns))
+        resultSpec.insert(col.label, PyRunner::ftNumberArray);
+
+    auto res = _runner->run(FUNC_CALC_BATCH, args, resultSpec);
+    if (!res) {
+        showError(_runner.get());
+        return false;
+    }
+
+    valuesT.clear();
+    valuesS.clear();
+    if (res->isEmpty()) {
+        // The function is not applicable for any position
+        valuesT.fill(QVector<double>(count, qQNaN()), _columns.size());
+        valuesS = valuesT;
+        return true;
+    }
+    if (res->size() != 2) {
+        showError(FUNC_CALC_BATCH + ": bad result, list of two dicts for T and S planes expected");
+        return false;
+    }
+    for (const auto &col : std::as_const(_columns)) {
+        for (int ts = 0; ts < 2; ts++) {
+            auto v = res->at(ts).value(col.label).value<QVector<double>>();
+            if (v.size() != count) {
+                showError(QString("%1: length of column '%2' doesn't match the number of positions")
+                    .arg(FUNC_CALC_BATCH, col.label));
+                return false;
+            }
+            (ts == 0 ? valuesT : valuesS) << v;
+        }
+    }
+    return true;
+}
+
 void CustomTableFunction::showError(PyRunner *py)
 {
     setError(py->errorText());
@@ -81,28 +214,61 @@ bool CustomTableFunction::prepare()
     _errorLog.clear();
     _errorLine = 0;
     
-    std::shared_ptr<PyRunner> py(new PyRunner);
-    py->schema = schema();
-    py->code = _code;
-    py->moduleName = _moduleName;
-    py->funcNames = { FUNC_COLUMNS, FUNC_CALC };
-    py->funcNamesOptional = { CustomFuncUtils::funcNameMeta() };
-    py->printFunc = _printFunc;
-
-    static PyRunner::ModuleProps props {
-        .consts = {
-            { "POS_LEFT", (int)ResultPositionAbs::LEFT },
-            { "POS_BEG", (int)ResultPositionAbs::BEG },
-            { "POS_MID", (int)ResultPositionAbs::MID },
-            { "POS_END", (int)ResultPositionAbs::END },
-            { "POS_RIGHT", (int)ResultPositionAbs::RIGHT },
+    // The module is loaded once and then kept between recalculations,
+    // it only gets reloaded when the code or the module it's loaded as changes
+    if (!_runner || _runner->code != _code || _runner->moduleName != _moduleName)
+    {
+        _runner.reset();
+        std::shared_ptr<PyRunner> py(new PyRunner);
+        py->schema = schema();
+        py->code = _code;
+        py->moduleName = _moduleName;
+        py->funcNames = { FUNC_COLUMNS };
+        py->funcNamesOptional = { FUNC_CALC, FUNC_CALC_BATCH, CustomFuncUtils::funcNameMeta() };
+        py->printFunc = _printFunc;
+
+        static PyRunner::ModuleProps props {
+            .consts = {
+                { "POS_LEFT", (int)ResultPositionAbs::LEFT },
+                { "POS_BEG", (int)ResultPositionAbs::BEG },
+                { "POS_MID", (int)ResultPositionAbs::MID },
+                { "POS_END", (int)ResultPositionAbs::END },
+                { "POS_RIGHT", (int)ResultPositionAbs::RIGHT },
+            }
+        };
+
+        if (!py->load(props)) {
+            showError(py.get());
+            return false;
         }
-    };
+        if (!py->hasFunction(FUNC_CALC) && !py->hasFunction(FUNC_CALC_BATCH)) {
+            showError(QString("Function %1 or %2 not found").arg(FUNC_CALC, FUNC_CALC_BATCH));
+            return false;
+        }
+        _runner = py;
+    }
+    else
+    {
+        _runner->printFunc = _printFunc;
+        _runner->resetErrors();
+    }
+    auto py = _runner;
 
-    if (!py->load(props)) {
-        showError(py.get());
+    // The batch function is preferred if both are provided,
+    // but it only gets real parts of matrices, so it can't be used for complex ones
+    bool hasComplexElems = false;
+    for (auto elem : schema()->activeElements())
+        if (elem->hasOption(Element_Complex)) {
+            hasComplexElems = true;
+            break;
+        }
+    _useBatch = py->hasFunction(FUNC_CALC_BATCH) && !hasComplexElems;
+    if (!_useBatch && !py->hasFunction(FUNC_CALC)) {
+        showError(QString("Function %1 can't be used for a schema having elements with complex matrices, "
+                          "function %2 should be provided").arg(FUNC_CALC_BATCH, FUNC_CALC));
         return false;
     }
+    _batch.clear();
     
     _customTitle = py->codeTitle;
     
@@ -135,15 +301,9 @@ bool CustomTableFunction::prepare()
     if (!_helpTopic)
         _helpTopic = CustomFuncUtils::helpTopic(py.get(), HELP_TOPIC);
 
-    _runner = py;
     return true;
 }
 
-void CustomTableFunction::unprepare()
-{
-    _runner.reset();
-}
-
 QString CustomTableFunction::helpTopic() const
 {
     if (_helpTopic)
@@ -19,7 +19,6 @@ public:
     void setCode(const QString &code) { _code = code; }
     
     bool prepare() override;
-    void unprepare() override;
     
     QString customTitle() const { return _customTitle; }
     QString moduleName() const { return _moduleName; }
@@ -30,8 +29,22 @@ public:
 
 protected:
     QVector<Z::PointTS> calculateInternal(const ResultElem &resultElem) override;
+    // Round-trip is passed to the `calculate()` function which can access its matrices
+    bool needsRoundTripMatrices() const override { return !_useBatch; }
+    void calculateResults(QVector<Result>& results) override;
     
 private:
+    /// Round-trip data collected for a position when values
+    /// are calculated for all positions at once by `calculate_batch()`
+    struct BatchItem
+    {
+        Element *elem;
+        ResultPosition pos;
+        int absPos;
+        double ior;
+        Z::Matrix mt, ms;
+    };
+
     QString _code;
     QString _customTitle;
     QString _moduleName;
@@ -40,7 +53,11 @@ private:
     int _errorLine;
     std::function<void(const QString&)> _printFunc;
     std::shared_ptr<PyRunner> _runner;
+    bool _useBatch = false;
+    QVector<BatchItem> _batch;
     
+    bool calculateBatch(QVector<QVector<double>> &valuesT, QVector<QVector<double>> &valuesS);
+
     void showError(PyRunner *py);
     void showError(const QString &err);
 };
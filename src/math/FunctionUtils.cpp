@@ -2,6 +2,10 @@
 #include "RoundTripCalculator.h"
 #include "../core/Schema.h"
 #include "../core/Elements.h"
+#include "../core/Variable.h"
+
+#include <cfloat>
+#include <cmath>
 
 namespace FunctionUtils {
 
@@ -117,4 +121,161 @@ double ior(Schema *schema, Element *elem, bool splitRange)
     return 1;
 }
 
+namespace {
+
+struct Sampler
+{
+    const std::function<Z::PointTS(double)>& func;
+    int maxDepth;
+    double tolerance;
+    Z::PointTS span;
+    QVector<SamplePoint> points;
+
+    bool needsRefinement(double y1, double y0, double y2, double spanY) const
+    {
+        bool valid1 = std::isfinite(y1), valid2 = std::isfinite(y2);
+        if (valid1 != valid2)
+            return true;
+        if (!valid1)
+            return false;
+        if (y1 * y2 < 0)
+            return true;
+        if (!std::isfinite(y0))
+            return true;
+        return spanY > 0 && qAbs(y0 - (y1 + y2) / 2.0) > tolerance * spanY;
+    }
+
+    void refine(const SamplePoint& p1, const SamplePoint& p2, int depth)
+    {
+        SamplePoint p0 { (p1.x + p2.x) / 2.0, {} };
+        p0.y = func(p0.x);
+        bool split = depth < maxDepth && (
+            needsRefinement(p1.y.T, p0.y.T, p2.y.T, span.T) ||
+            needsRefinement(p1.y.S, p0.y.S, p2.y.S, span.S));
+        if (split)
+            refine(p1, p0, depth+1);
+        points << p0;
+        if (split)
+            refine(p0, p2, depth+1);
+    }
+};
+
+double valueSpan(const QVector<SamplePoint>& points, Z::WorkPlane ts)
+{
+    double minY = 0, maxY = 0;
+    bool found = false;
+    for (const auto& p : points)
+    {
+        double y = p.y[ts];
+        if (!std::isfinite(y)) continue;
+        minY = found ? qMin(minY, y) : y;
+        maxY = found ? qMax(maxY, y) : y;
+        found = true;
+    }
+    if (maxY > minY)
+        return maxY - minY;
+    // Constant plot, deviations are compared with the value itself
+    return qAbs(maxY);
+}
+
+} // namespace
+
+QVector<SamplePoint> sample(const Z::PlottingRange& range, const std::function<Z::PointTS(double)>& func, int maxDepth)
+{
+    QVector<SamplePoint> grid;
+    grid.reserve(range.values().size());
+    for (auto x : range.values())
+        grid << SamplePoint { x, func(x) };
+
+    if (range.tolerance() <= 0 || grid.size() < 2)
+        return grid;
+
+    Sampler sampler {
+        .func = func,
+        .maxDepth = maxDepth,
+        .tolerance = range.tolerance(),
+        .span = { valueSpan(grid, Z::T), valueSpan(grid, Z::S) },
+        .points = {},
+    };
+    sampler.points.reserve(grid.size() * 2);
+    sampler.points << grid.first();
+    for (int i = 1; i < grid.size(); i++)
+    {
+        sampler.refine(grid.at(i-1), grid.at(i), 1);
+        sampler.points << grid.at(i);
+    }
+    return sampler.points;
+}
+
+std::optional<double> findRoot(const std::function<double(double)>& func, double x1, double x2, double tolerance, int maxIters)
+{
+    // Notation follows the original algorithm: b is the current best estimate,
+    // a is the previous one, and the root is always bracketed between b and c
+    double a = x1, b = x2;
+    double fa = func(a), fb = func(b);
+    if (fa == 0) return a;
+    if (fb == 0) return b;
+    if (fa * fb > 0) return {};
+
+    double c = a, fc = fa;
+    double d = b - a, e = d;
+    for (int iter = 0; iter < maxIters; iter++)
+    {
+        if (fb * fc > 0)
+        {
+            c = a, fc = fa;
+            d = b - a, e = d;
+        }
+        if (qAbs(fc) < qAbs(fb))
+        {
+            a = b, b = c, c = a;
+            fa = fb, fb = fc, fc = fa;
+        }
+        double tol = 2 * DBL_EPSILON * qAbs(b) + 0.5 * tolerance;
+        double m = 0.5 * (c - b);
+        if (qAbs(m) <= tol || fb == 0)
+            return b;
+
+        if (qAbs(e) >= tol && qAbs(fa) > qAbs(fb))
+        {
+            double p, q, s = fb / fa;
+            if (a == c)
+            {
+                // Secant step
+                p = 2 * m * s;
+                q = 1 - s;
+            }
+            else
+            {
+                // Inverse quadratic interpolation
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+                q = (q - 1) * (r - 1) * (s - 1);
+            }
+            if (p > 0) q = -q;
+            else p = -p;
+            if (2 * p < qMin(3 * m * q - qAbs(tol * q), qAbs(e * q)))
+            {
+                e = d;
+                d = p / q;
+            }
+            else
+            {
+                d = m;
+                e = m;
+            }
+        }
+        else
+        {
+            d = m;
+            e = m;
+        }
+        a = b, fa = fb;
+        b += qAbs(d) > tol ? d : (m > 0 ? tol : -tol);
+        fb = func(b);
+    }
+    return {};
+}
+
 } // namespace FunctionUtils
@@ -1,6 +1,17 @@
 #ifndef FUNCTION_UTILS_H
 #define FUNCTION_UTILS_H
 
+#include "../core/Values.h"
+
+#include <QVector>
+
+#include <functional>
+#include <optional>
+
+namespace Z {
+class PlottingRange;
+}
+
 class Element;
 class PumpCalculator;
 class Schema;
@@ -26,6 +37,29 @@ Element* nextElem(Schema *schema, Element *elem);
 /// the IOR should be that of the next neighbour medium.
 double ior(Schema *schema, Element *elem, bool splitRange);
 
+struct SamplePoint
+{
+    double x;
+    Z::PointTS y;
+};
+
+/// Calculates function values at points of the plotting range.
+/// When the range has a tolerance, the points are only an initial grid, and intervals are bisected
+/// where the midpoint deviates from linear interpolation more than the tolerance of the value span,
+/// where a value changes its sign (e.g. a pole of wavefront curvature radius at the waist),
+/// or where valid values border invalid ones (e.g. a stability boundary).
+/// Each interval of the initial grid is split no more than @a maxDepth times.
+/// Points are returned in ascending order of x.
+QVector<SamplePoint> sample(const Z::PlottingRange& range, const std::function<Z::PointTS(double)>& func, int maxDepth = 6);
+
+/// Finds a root of the function in the interval [x1, x2] where the function changes its sign.
+/// Brent's method is used: it combines inverse quadratic interpolation and secant steps
+/// converging superlinearly for smooth functions, with bisection keeping the root bracketed.
+/// The root is refined up to the machine precision, or to @a tolerance if it is larger.
+/// Returns nothing if function values at the ends of the interval have the same sign
+/// or the root is not found in @a maxIters iterations.
+std::optional<double> findRoot(const std::function<double(double)>& func, double x1, double x2, double tolerance = 0, int maxIters = 100);
+
 } // namespace FunctionUtils
 
 #endif // FUNCTION_UTILS_H
@@ -16,6 +16,9 @@ public:
     bool hasOptions() const override { return false; }
     QString calculateSpecPoints(const SpecPointParams& params) override;
 
+    /// Graphs of all pumps are calculated one by one by MultibeamCausticWindow::calculate().
+    PlotFuncJobPtr prepareJob() override { return {}; }
+
     CausticFunction::Mode mode() const = delete;
     void setMode(CausticFunction::Mode mode) = delete;
 };
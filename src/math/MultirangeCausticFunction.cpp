@@ -1,5 +1,28 @@
 #include "MultirangeCausticFunction.h"
 
+#include "../core/Schema.h"
+#include "../math/RoundTripCalculator.h"
+
+namespace {
+
+class MultirangeCausticJob : public PlotFuncJob
+{
+public:
+    QVector<std::pair<CausticFunction*, PlotFuncJobPtr>> jobs;
+
+    void run() override
+    {
+        // Ranges are not interrupted, the job is only cancelled between them
+        for (const auto& it : std::as_const(jobs))
+        {
+            if (isCancelled()) return;
+            it.second->run();
+        }
+    }
+};
+
+} // namespace
+
 MultirangeCausticFunction::~MultirangeCausticFunction()
 {
     qDeleteAll(_funcs);
@@ -59,6 +82,20 @@ void MultirangeCausticFunction::setArgs(const QVector<Z::Variable>& args)
 void MultirangeCausticFunction::calculate(CalculationMode calcMode)
 {
     setError(QString());
+
+    // The beam in a resonator is the same for all ranges, so the round-trip is multiplied only once
+    // and round-trips at starts of ranges are derived from it, see RoundTripCalculator::beginReferenceSweep().
+    // Single-pass systems are calculated per range because each range prepares its own dynamic elements.
+    std::unique_ptr<RoundTripCalculator> referenceSweep;
+    auto elems = schema()->activeElements();
+    if (calcMode == CALC_PLOT && schema()->isResonator() && !elems.isEmpty())
+    {
+        referenceSweep.reset(new RoundTripCalculator(schema(), elems.last()));
+        referenceSweep->calcRoundTrip();
+        if (!referenceSweep->beginReferenceSweep())
+            referenceSweep.reset();
+    }
+
     int disabledCount = 0;
     foreach (CausticFunction *func, _funcs)
     {
@@ -67,7 +104,9 @@ void MultirangeCausticFunction::calculate(CalculationMode calcMode)
             disabledCount++;
             continue;
         }
+        func->setReferenceSweep(referenceSweep.get());
         func->calculate(calcMode);
+        func->setReferenceSweep(nullptr);
         if (!func->ok())
         {
             setError(func->errorText());
@@ -80,6 +119,45 @@ void MultirangeCausticFunction::calculate(CalculationMode calcMode)
         setError("All elements are disabled");
 }
 
+PlotFuncJobPtr MultirangeCausticFunction::prepareJob()
+{
+    // Each range builds its own round-trip instead of the reference sweep used by calculate(),
+    // it's done in the main thread but only once per calculation, points are calculated in the job
+    auto job = std::make_shared<MultirangeCausticJob>();
+    for (CausticFunction *func : std::as_const(_funcs))
+    {
+        if (func->arg()->element->disabled())
+            continue;
+        auto funcJob = func->prepareJob();
+        if (!funcJob)
+            return {};
+        job->jobs.append({func, funcJob});
+    }
+    if (job->jobs.isEmpty())
+        return {};
+    return job;
+}
+
+void MultirangeCausticFunction::applyJob(PlotFuncJob* job)
+{
+    auto multiJob = dynamic_cast<MultirangeCausticJob*>(job);
+    if (!multiJob) return;
+
+    setError(QString());
+    for (const auto& it : std::as_const(multiJob->jobs))
+    {
+        auto func = it.first;
+        func->applyJob(it.second.get());
+        if (!func->ok())
+        {
+            setError(func->errorText());
+            foreach (auto f, _funcs)
+                f->clearResults();
+            break;
+        }
+    }
+}
+
 int MultirangeCausticFunction::resultCount(Z::WorkPlane plane) const
 {
     int count = 0;
@@ -108,6 +186,30 @@ const PlotFuncResult& MultirangeCausticFunction::result(Z::WorkPlane plane, int
     throw std::runtime_error(errorMsg.toStdString()); // let it crash
 }
 
+std::optional<PlotFuncDeps> MultirangeCausticFunction::dependencyCone() const
+{
+    // Round-trips of all ranges of a resonator consist of the same elements
+    if (schema()->isResonator())
+    {
+        for (CausticFunction *func : _funcs)
+            if (!func->roundTripCalculator())
+                return {};
+        auto cone = PlotFuncDeps::cone(schema(), schema()->activeElements());
+        for (CausticFunction *func : _funcs)
+            cone.merge(func->dependsOn());
+        return cone;
+    }
+
+    PlotFuncDeps cone;
+    for (CausticFunction *func : _funcs)
+    {
+        auto funcCone = func->dependencyCone();
+        if (!funcCone) return {};
+        cone.merge(*funcCone);
+    }
+    return cone;
+}
+
 void MultirangeCausticFunction::setPump(PumpParams* pump)
 {
     foreach (CausticFunction *func, _funcs)
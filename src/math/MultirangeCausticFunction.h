@@ -39,6 +39,9 @@ public:
     QString valueSymbol() const;
 
     Z::PointTS calculateAt(const Z::Value&arg) override;
+    std::optional<PlotFuncDeps> dependencyCone() const override;
+    PlotFuncJobPtr prepareJob() override;
+    void applyJob(PlotFuncJob* job) override;
 
 private:
     QList<CausticFunction*> _funcs;
@@ -41,6 +41,7 @@ void PlotFuncRoundTripFunction::functionDeleted(FunctionBase*)
 
 QString PlotFuncRoundTripFunction::calculateInternal()
 {
+    _function->prepareRoundTrip();
     auto c = _function->roundTripCalculator();
     if (!c)
         return "There is no round-trip calculated for the function.";
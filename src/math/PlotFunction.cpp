@@ -70,17 +70,53 @@ bool PlotFuncDeps::check(Z::Parameter *param) const
 
 bool PlotFuncDeps::check(Element *elem) const
 {
-    return elems.contains(elem);
+    if (elems.contains(elem))
+        return true;
+    return disabled && elem->disabled() != disabled->contains(elem);
 }
 
 bool PlotFuncDeps::check(const Elements &elems) const
 {
     for (auto elem : elems)
-        if (this->elems.contains(elem))
+        if (check(elem))
             return true;
     return false;
 }
 
+void PlotFuncDeps::merge(const PlotFuncDeps& other)
+{
+    for (auto elem : other.elems)
+        if (elem && !elems.contains(elem))
+            elems << elem;
+    for (auto param : other.params)
+        if (param && !params.contains(param))
+            params << param;
+    if (other.disabled)
+    {
+        if (!disabled)
+            disabled = Elements();
+        for (auto elem : *other.disabled)
+            if (!disabled->contains(elem))
+                *disabled << elem;
+    }
+}
+
+PlotFuncDeps PlotFuncDeps::cone(Schema* schema, const Elements& elems)
+{
+    PlotFuncDeps deps { .elems = elems, .disabled = Elements() };
+    for (auto elem : schema->elements())
+        if (elem->disabled())
+            *deps.disabled << elem;
+    for (auto param : *schema->globalParams())
+        for (auto elem : Z::Utils::dependentElements(param))
+            if (elems.contains(elem))
+            {
+                deps.params << param;
+                break;
+            }
+    return deps;
+}
+
 //------------------------------------------------------------------------------
 //                                 PlotFunction
 //------------------------------------------------------------------------------
@@ -194,3 +230,12 @@ PlotFuncDeps PlotFunction::dependsOn() const
         .params = { _arg.parameter },
     };
 }
+
+std::optional<PlotFuncDeps> PlotFunction::dependencyCone() const
+{
+    if (!_calc) return {};
+
+    auto cone = PlotFuncDeps::cone(_schema, _calc->roundTrip());
+    cone.merge(dependsOn());
+    return cone;
+}
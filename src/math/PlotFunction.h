@@ -6,6 +6,10 @@
 #include "../core/Variable.h"
 #include "../core/CommonTypes.h"
 
+#include <atomic>
+#include <memory>
+#include <optional>
+
 class RoundTripCalculator;
 class Schema;
 
@@ -51,6 +55,32 @@ private:
 };
 using SpecPointParams = QMap<int, SpecPointParam>;
 
+/**
+    Calculation of a plot function that can be done outside of the main thread.
+
+    A job is prepared by the function in the main thread (see @a PlotFunction::prepareJob())
+    and it must capture all the data it needs, e.g. via @a SchemaSnapshot,
+    because the live schema can be changed while the job is running.
+    When the job is done, its results are taken back by the function in the main thread.
+*/
+class PlotFuncJob
+{
+public:
+    virtual ~PlotFuncJob() {}
+
+    /// Does calculation, it's called in a worker thread.
+    /// Implementations should check @a isCancelled() regularly and return as soon as it is set.
+    virtual void run() = 0;
+
+    void cancel() { _cancelled = true; }
+    bool isCancelled() const { return _cancelled; }
+
+private:
+    std::atomic<bool> _cancelled = false;
+};
+
+typedef std::shared_ptr<PlotFuncJob> PlotFuncJobPtr;
+
 /**
     Base class for all plotting functions.
     Plotting function is a function presenting its calculation results in graphical form.
@@ -113,8 +143,26 @@ public:
     
     virtual PlotFuncDeps dependsOn() const;
 
+    /// Returns elements and global parameters whose changes can affect the function result.
+    /// It's made of the round-trip prepared at the last calculation, so it follows the schema topology,
+    /// e.g. in SP schemas elements behind the reference element are not included.
+    /// Returns nothing when the function is not calculated yet and dependencies are unknown.
+    virtual std::optional<PlotFuncDeps> dependencyCone() const;
+
+    /// Prepares calculation of the plot in a worker thread.
+    /// Returns null when the function can't be calculated in background with the current arguments,
+    /// then the regular @a calculate() should be used.
+    virtual PlotFuncJobPtr prepareJob() { return {}; }
+
+    /// Takes results of the finished job prepared by @a prepareJob().
+    virtual void applyJob(PlotFuncJob* job) { Q_UNUSED(job) }
+
     RoundTripCalculator* roundTripCalculator() const { return _calc; }
 
+    /// Builds the round-trip of roundTripCalculator() if the function skipped it while calculating,
+    /// must be called before the round-trip is shown to the user.
+    virtual void prepareRoundTrip() {}
+
 protected:
     Z::Variable _arg;
     RoundTripCalculator* _calc = nullptr;
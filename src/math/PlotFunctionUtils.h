@@ -6,14 +6,29 @@
 #include "../core/Element.h"
 #include "../core/Parameters.h"
 
+#include <optional>
+
+class Schema;
+
 struct PlotFuncDeps
 {
     Elements elems;
     Z::Parameters params;
+
+    /// Elements that were disabled when the cone was made, see cone().
+    /// They are not in the round-trip but enabling of any of them changes it,
+    /// so an element whose disabled state differs from the stored one is treated as a dependency.
+    std::optional<Elements> disabled;
     
     bool check(Z::Parameter*) const;
     bool check(Element*) const;
     bool check(const Elements&) const;
+
+    void merge(const PlotFuncDeps&);
+
+    /// Makes dependencies of a result defined by the given elements.
+    /// Global parameters of the schema driving these elements via links and formulas are included too.
+    static PlotFuncDeps cone(Schema* schema, const Elements& elems);
 };
 
 #endif // PLOT_FUNCTION_UTILS_H
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "../core/Protocol.h"
 
+#include <algorithm>
+
 PlotFunctionV2::PlotFunctionV2(Schema *schema) : FunctionBase(schema)
 {
 }
@@ -63,4 +65,23 @@ void PlotFunctionV2::addPoint(const QString &id, double x, double y)
 void PlotFunctionV2::endLine(const QString &id)
 {
     _lineIndex.remove(id);
-}
\ No newline at end of file
+}
+
+void PlotFunctionV2::addLine(const QString &id, QVector<double> &&x, QVector<double> &&y)
+{
+    auto isFinite = [](double v){ return std::isfinite(v); };
+    if (!x.isEmpty() && x.size() == y.size() && !_lineIndex.contains(id) &&
+        std::all_of(x.cbegin(), x.cend(), isFinite) && std::all_of(y.cbegin(), y.cend(), isFinite))
+    {
+        Line line(id);
+        line._x = std::move(x);
+        line._y = std::move(y);
+        Z_INFO(id << "new line segment started at" << line._x.first())
+        _lines.append(std::move(line));
+        return;
+    }
+    int count = qMin(x.size(), y.size());
+    for (int i = 0; i < count; i++)
+        addPoint(id, x.at(i), y.at(i));
+    endLine(id);
+}
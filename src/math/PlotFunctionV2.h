@@ -60,6 +60,11 @@ protected:
 
     void addPoint(const QString &id, double x, double y);
     void endLine(const QString &id);
+
+    /// Adds the whole line at once and ends it.
+    /// Arrays are adopted without copying when all the points are valid,
+    /// otherwise the line is split into segments like @sa addPoint() does.
+    void addLine(const QString &id, QVector<double> &&x, QVector<double> &&y);
     
 private:
     QVector<Line> _lines;
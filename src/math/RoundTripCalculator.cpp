@@ -47,6 +47,10 @@ void RoundTripCalculator::reset()
     _roundTrip.clear();
     _matrsT.clear();
     _matrsS.clear();
+    _isReal = false;
+    _cache.valid = false;
+    _sweep.range = nullptr;
+    _refSweep.active = false;
     _mt.unity();
     _ms.unity();
 }
@@ -153,6 +157,7 @@ void RoundTripCalculator::collectMatrices()
         _matrsT << range->pMt2();
         _matrsS << range->pMs2();
     }
+    checkRealMatrices();
 }
 
 void RoundTripCalculator::collectMatricesSP()
@@ -189,19 +194,285 @@ void RoundTripCalculator::collectMatricesSP()
         }
         i++;
     }
+    checkRealMatrices();
+}
+
+void RoundTripCalculator::checkRealMatrices()
+{
+    _isReal = true;
+    for (const auto& info : _matrixInfo)
+        if (info.owner->hasOption(Element_Complex))
+        {
+            _isReal = false;
+            break;
+        }
 }
 
 void RoundTripCalculator::multMatrix(const char *reason)
 {
     Q_UNUSED(reason) // debug parameter
 
+    const Z::MatrixArray *matrsT = &_matrsT;
+    const Z::MatrixArray *matrsS = &_matrsS;
+
+    // Matrices could be added by a derived class bypassing collectMatrices()
+    if (!_variedElems.isEmpty() && _matrixInfo.size() == _matrsT.size())
+    {
+        if (!isProductCacheValid())
+            buildProductCache();
+        matrsT = &_cache.matrsT;
+        matrsS = &_cache.matrsS;
+    }
+
+    if (_isReal)
+    {
+        Z::multMatrixArrayReal(*matrsT, _mt);
+        Z::multMatrixArrayReal(*matrsS, _ms);
+        return;
+    }
+
     _mt.unity();
     _ms.unity();
-    for (int i = 0; i < _matrsT.size(); i++)
+    for (int i = 0; i < matrsT->size(); i++)
     {
-        _mt *= _matrsT[i];
-        _ms *= _matrsS[i];
+        _mt *= matrsT->at(i);
+        _ms *= matrsS->at(i);
+    }
+}
+
+void RoundTripCalculator::setVariedElements(const QList<Element*>& elems)
+{
+    _variedElems = elems;
+    _cache.valid = false;
+}
+
+bool RoundTripCalculator::beginSubrangeSweep()
+{
+    _sweep.range = nullptr;
+
+    if (!_splitRange || _matrixInfo.isEmpty() || _matrixInfo.first().kind != MatrixInfo::LEFT_HALF)
+        return false;
+
+    auto range = Z::Utils::asRange(_matrixInfo.first().owner);
+    if (!range)
+        return false;
+
+    range->setSubRangeSI(0);
+    if (std::abs(range->Mt1().det()) == 0 || std::abs(range->Ms1().det()) == 0)
+        return false;
+
+    multMatrix("RoundTripCalculator::beginSubrangeSweep");
+
+    startSubrangeSweep(range, _matrixInfo.last().kind == MatrixInfo::RIGHT_HALF);
+    return true;
+}
+
+bool RoundTripCalculator::beginSubrangeSweep(RoundTripCalculator* referenceSweep)
+{
+    _sweep.range = nullptr;
+
+    auto range = Z::Utils::asRange(_reference);
+    if (!range || !referenceSweep)
+        return false;
+
+    range->setSubRangeSI(0);
+    if (std::abs(range->Mt1().det()) == 0 || std::abs(range->Ms1().det()) == 0)
+        return false;
+
+    if (!referenceSweep->multMatrixAtReference(range, true))
+        return false;
+    _mt = referenceSweep->Mt();
+    _ms = referenceSweep->Ms();
+
+    startSubrangeSweep(range, referenceSweep->_refSweep.isResonator);
+    return true;
+}
+
+void RoundTripCalculator::startSubrangeSweep(ElementRange* range, bool isResonator)
+{
+    _sweep.range = range;
+    _sweep.isResonator = isResonator;
+    _sweep.mt0 = _mt;
+    _sweep.ms0 = _ms;
+    _sweep.mt1Inv = range->Mt1().inverted();
+    _sweep.ms1Inv = range->Ms1().inverted();
+}
+
+void RoundTripCalculator::multMatrixAtSubrange(double subrangeSi)
+{
+    Q_ASSERT(_sweep.range);
+
+    _sweep.range->setSubRangeSI(subrangeSi);
+
+    Z::Matrix pt = _sweep.range->Mt1() * _sweep.mt1Inv;
+    Z::Matrix ps = _sweep.range->Ms1() * _sweep.ms1Inv;
+    if (_sweep.isResonator)
+    {
+        _mt = pt * _sweep.mt0 * pt.inverted();
+        _ms = ps * _sweep.ms0 * ps.inverted();
+    }
+    else
+    {
+        _mt = pt * _sweep.mt0;
+        _ms = ps * _sweep.ms0;
+    }
+}
+
+bool RoundTripCalculator::beginReferenceSweep()
+{
+    _refSweep.active = false;
+
+    const int count = _matrsT.size();
+    if (_splitRange || count == 0 || count != _roundTrip.size())
+        return false;
+
+    auto& s = _refSweep;
+    s.isResonator = !_schema->isSP();
+    s.indices.clear();
+    for (int i = 0; i < count; i++)
+    {
+        const auto& item = _roundTrip.at(i);
+        // In SW schemas the second pass goes through elements in backward direction,
+        // the reference always starts its round-trip with the forward pass
+        if (!item.secondPass)
+            s.indices[item.element] = i;
+    }
+
+    s.suffixT.resize(count + 1);
+    s.suffixS.resize(count + 1);
+    s.suffixT[count].unity();
+    s.suffixS[count].unity();
+    for (int i = count-1; i >= 0; i--)
+    {
+        s.suffixT[i] = *_matrsT.at(i) * s.suffixT.at(i+1);
+        s.suffixS[i] = *_matrsS.at(i) * s.suffixS.at(i+1);
+    }
+
+    // Single-pass round-trip ends at the first element, so leading parts are not needed
+    if (s.isResonator)
+    {
+        s.prefixT.resize(count + 1);
+        s.prefixS.resize(count + 1);
+        s.prefixT[0].unity();
+        s.prefixS[0].unity();
+        for (int i = 0; i < count; i++)
+        {
+            s.prefixT[i+1] = s.prefixT.at(i) * *_matrsT.at(i);
+            s.prefixS[i+1] = s.prefixS.at(i) * *_matrsS.at(i);
+        }
+    }
+
+    s.active = true;
+    return true;
+}
+
+bool RoundTripCalculator::multMatrixAtReference(Element* ref, bool splitRange)
+{
+    const auto& s = _refSweep;
+    if (!s.active)
+        return false;
+
+    auto it = s.indices.constFind(ref);
+    if (it == s.indices.constEnd())
+        return false;
+    const int index = it.value();
+
+    // The round-trip at the reference contains all elements following it in the current round-trip,
+    // and then, for resonators, all elements preceding it, which closes the cycle
+    _mt = s.suffixT.at(index+1);
+    _ms = s.suffixS.at(index+1);
+    if (s.isResonator)
+    {
+        _mt *= s.prefixT.at(index);
+        _ms *= s.prefixS.at(index);
+    }
+
+    auto range = splitRange ? Z::Utils::asRange(ref) : nullptr;
+    if (range)
+    {
+        // The same parts of the reference range as collectMatrices() takes
+        _mt = range->Mt1() * _mt;
+        _ms = range->Ms1() * _ms;
+        if (s.isResonator)
+        {
+            _mt *= range->Mt2();
+            _ms *= range->Ms2();
+        }
+    }
+    else
+    {
+        _mt = *_matrsT.at(index) * _mt;
+        _ms = *_matrsS.at(index) * _ms;
+    }
+    return true;
+}
+
+bool RoundTripCalculator::isVariedMatrix(int index) const
+{
+    auto owner = _matrixInfo.at(index).owner;
+    // Dynamic matrices are recalculated by functions directly
+    // and their changes can't be tracked via matrix revision
+    return _variedElems.contains(owner) || dynamic_cast<ElementDynamic*>(owner);
+}
+
+bool RoundTripCalculator::isProductCacheValid() const
+{
+    if (!_cache.valid)
+        return false;
+    for (const auto& rev : _cache.revisions)
+        if (rev.first->matrixRevision() != rev.second)
+            return false;
+    return true;
+}
+
+void RoundTripCalculator::buildProductCache()
+{
+    _cache.productsT.clear();
+    _cache.productsS.clear();
+    _cache.matrsT.clear();
+    _cache.matrsS.clear();
+    _cache.revisions.clear();
+
+    // Products are referenced by pointers, so their storage must not be reallocated
+    const int count = _matrsT.size();
+    _cache.productsT.reserve(count);
+    _cache.productsS.reserve(count);
+
+    int i = 0;
+    while (i < count)
+    {
+        if (isVariedMatrix(i))
+        {
+            _cache.matrsT << _matrsT.at(i);
+            _cache.matrsS << _matrsS.at(i);
+            i++;
+            continue;
+        }
+        const int start = i;
+        while (i < count && !isVariedMatrix(i))
+        {
+            auto owner = _matrixInfo.at(i).owner;
+            _cache.revisions.append({owner, owner->matrixRevision()});
+            i++;
+        }
+        if (i - start == 1)
+        {
+            _cache.matrsT << _matrsT.at(start);
+            _cache.matrsS << _matrsS.at(start);
+            continue;
+        }
+        Z::Matrix mt, ms;
+        for (int j = start; j < i; j++)
+        {
+            mt *= _matrsT.at(j);
+            ms *= _matrsS.at(j);
+        }
+        _cache.productsT << mt;
+        _cache.productsS << ms;
+        _cache.matrsT << &_cache.productsT.constLast();
+        _cache.matrsS << &_cache.productsS.constLast();
     }
+    _cache.valid = true;
 }
 
 Z::PointTS RoundTripCalculator::stability() const
@@ -258,12 +529,12 @@ bool RoundTripCalculator::isStable(const Z::Matrix& m) const
     return (half_of_A_plus_D > -1) && (half_of_A_plus_D < 1);
 }
 
-double RoundTripCalculator::calcStability(const Z::Matrix& m, Z::Enums::StabilityCalcMode mode) const
+double RoundTripCalculator::calcStability(const Z::Matrix& m, Z::Enums::StabilityCalcMode mode)
 {
     return calcStabilityCplx(m, mode).real();
 }
 
-Z::Complex RoundTripCalculator::calcStabilityCplx(const Z::Matrix &m, Z::Enums::StabilityCalcMode mode) const
+Z::Complex RoundTripCalculator::calcStabilityCplx(const Z::Matrix &m, Z::Enums::StabilityCalcMode mode)
 {
     auto half_of_A_plus_D = (m.A + m.D) * 0.5;
     switch (mode)
@@ -5,10 +5,12 @@
 #include "../core/Math.h"
 #include "../core/Values.h"
 
+#include <QHash>
 #include <QString>
 
 class Schema;
 class Element;
+class ElementRange;
 
 class RoundTripCalculator
 {
@@ -70,8 +72,58 @@ public:
 
     bool splitRange() const { return _splitRange; }
 
+    /// Returns true when there are no elements having complex matrices in the round-trip.
+    /// Such round-trips are multiplied using real arithmetic only.
+    /// Valid only after calcRoundTrip() call.
+    bool isReal() const { return _isReal; }
+
+    /// Sets elements whose matrices are going to change between multMatrix() calls, e.g. during parameter sweeps.
+    /// Products of matrices of all other elements are cached and reused by multMatrix(),
+    /// so it takes only a few multiplications instead of multiplying the whole round-trip.
+    /// The cache is rebuilt automatically when matrices of any non-varied element change.
+    /// Pass an empty list to disable caching.
+    void setVariedElements(const QList<Element*>& elems);
+
+    /// Prepares fast calculation of round-trips at different offsets inside the reference range.
+    /// The round-trip is multiplied only once at the range start. For any offset x it is then given
+    /// by the propagation matrix from the range start P = M1(x)·M1(0)⁻¹, where M1 is the left sub-range matrix:
+    /// M(x) = P·M(0)·P⁻¹ for resonators and M(x) = P·M(0) for single-pass systems.
+    /// Returns false if the round-trip is not split at the reference range or its sub-range matrix is singular,
+    /// then the offset should be set to the range and multMatrix() should be called for each point.
+    bool beginSubrangeSweep();
+
+    /// Prepares the same sweep taking the round-trip at the range start from a calculator
+    /// prepared with beginReferenceSweep(). The own round-trip is not used and calcRoundTrip() is not needed,
+    /// so the preparation takes a few matrix products regardless of the number of elements.
+    /// Returns false if the reference is not a range or its sub-range matrix is singular.
+    bool beginSubrangeSweep(RoundTripCalculator* referenceSweep);
+
+    /// Sets offset inside the reference range and calculates round-trip matrices for it.
+    /// Valid only after successful beginSubrangeSweep() and while other elements are not changed.
+    void multMatrixAtSubrange(double subrangeSi);
+
+    /// Prepares calculation of round-trips at all reference elements in a single pass through the schema.
+    /// Round-trips at neighbor references are related as M(k+1) = E(k+1)·M(k)·E(k+1)⁻¹, i.e. they are
+    /// cyclic permutations of the same product of element matrices. So products of all the leading
+    /// and trailing parts of the current round-trip are calculated once and then a round-trip
+    /// at any reference takes only a few multiplications and no matrix inversions.
+    /// The current round-trip must be calculated without splitting. In single-pass systems
+    /// the reference must be the last element, then its round-trip contains all the others.
+    /// Returns false if the round-trip is empty.
+    bool beginReferenceSweep();
+
+    /// Calculates round-trip matrices for another reference element, optionally split at its current sub-range.
+    /// Valid only after successful beginReferenceSweep() and while matrices of other elements are not changed.
+    /// Returns false if the element is not in the round-trip.
+    bool multMatrixAtReference(Element* ref, bool splitRange);
+
     bool debugFlag = false;
 
+    /// Stability parameter of an arbitrary round-trip matrix.
+    /// Can be used by functions calculating round-trips on their own, e.g. in worker threads.
+    static double calcStability(const Z::Matrix &m, Z::Enums::StabilityCalcMode mode);
+    static Z::Complex calcStabilityCplx(const Z::Matrix &m, Z::Enums::StabilityCalcMode mode);
+
 protected:
     /// Array of T-matrices for production (round-trip).
     /// Valid only after calcRoundTrip() call.
@@ -103,14 +155,54 @@ private:
     QVector<RoundTripElemInfo> _roundTrip;
 
     bool _splitRange = false;
+    bool _isReal = false;
+
+    /// Products of matrices of the round-trip parts not containing varied elements.
+    struct ProductCache
+    {
+        bool valid = false;
+        QVector<Z::Matrix> productsT, productsS;
+        /// Matrices to be multiplied instead of _matrsT/_matrsS:
+        /// cached products of fixed parts interleaved with matrices of varied elements.
+        Z::MatrixArray matrsT, matrsS;
+        /// Matrix revisions of fixed elements at the moment when the products were calculated.
+        QVector<QPair<const Element*, int>> revisions;
+    };
+    QList<Element*> _variedElems;
+    ProductCache _cache;
+
+    /// Round-trip at the start of the reference range, see beginSubrangeSweep().
+    struct SubrangeSweep
+    {
+        ElementRange* range = nullptr;
+        bool isResonator = false;
+        Z::Matrix mt0, ms0;
+        Z::Matrix mt1Inv, ms1Inv;
+    };
+    SubrangeSweep _sweep;
+    void startSubrangeSweep(ElementRange* range, bool isResonator);
+
+    /// Products of parts of the round-trip, see beginReferenceSweep().
+    struct ReferenceSweep
+    {
+        bool active = false;
+        bool isResonator = false;
+        /// Position of each element in the round-trip where its forward matrix is multiplied.
+        QHash<const Element*, int> indices;
+        /// Products of the first i matrices (prefix) and of matrices starting from i-th one (suffix).
+        QVector<Z::Matrix> prefixT, prefixS, suffixT, suffixS;
+    };
+    ReferenceSweep _refSweep;
     void calcRoundTripSW(const QList<Element*>& elems);
     void calcRoundTripRR(const QList<Element*>& elems);
     void calcRoundTripSP(const QList<Element*>& elems);
     void collectMatrices();
     void collectMatricesSP();
+    void checkRealMatrices();
+    bool isVariedMatrix(int index) const;
+    bool isProductCacheValid() const;
+    void buildProductCache();
 
-    double calcStability(const Z::Matrix &m, Z::Enums::StabilityCalcMode mode) const;
-    Z::Complex calcStabilityCplx(const Z::Matrix &m, Z::Enums::StabilityCalcMode mode) const;
     bool isStable(const Z::Matrix &m) const;
 };
 
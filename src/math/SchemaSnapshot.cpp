@@ -0,0 +1,242 @@
+#include "SchemaSnapshot.h"
+
+#include "RoundTripCalculator.h"
+#include "../core/Schema.h"
+
+#include <QDebug>
+
+namespace {
+
+const Z::Matrix* elemMatrix(const Element* elem, SchemaSnapshot::MatrixKind kind)
+{
+    auto range = dynamic_cast<const ElementRange*>(elem);
+    auto dynamic = dynamic_cast<const ElementDynamic*>(elem);
+    switch (kind)
+    {
+    case SchemaSnapshot::MT: return elem->pMt();
+    case SchemaSnapshot::MS: return elem->pMs();
+    case SchemaSnapshot::MT_INV: return elem->pMt_inv();
+    case SchemaSnapshot::MS_INV: return elem->pMs_inv();
+    case SchemaSnapshot::MT1: return range ? range->pMt1() : nullptr;
+    case SchemaSnapshot::MS1: return range ? range->pMs1() : nullptr;
+    case SchemaSnapshot::MT2: return range ? range->pMt2() : nullptr;
+    case SchemaSnapshot::MS2: return range ? range->pMs2() : nullptr;
+    case SchemaSnapshot::MT_DYN: return dynamic ? dynamic->pMt_dyn() : nullptr;
+    case SchemaSnapshot::MS_DYN: return dynamic ? dynamic->pMs_dyn() : nullptr;
+    case SchemaSnapshot::MATRIX_KIND_COUNT: break;
+    }
+    return nullptr;
+}
+
+void copyElemMatrices(const Element* elem, SchemaSnapshot::ElemMatrices& matrs)
+{
+    for (int kind = 0; kind < SchemaSnapshot::MATRIX_KIND_COUNT; kind++)
+        if (auto m = elemMatrix(elem, SchemaSnapshot::MatrixKind(kind)); m)
+            matrs[kind] = *m;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+//                              SchemaSnapshot
+//------------------------------------------------------------------------------
+
+SchemaSnapshot::SchemaSnapshot(Schema* schema)
+{
+    _tripType = schema->tripType();
+    _wavelenSi = schema->wavelenSi();
+
+    for (auto elem : schema->activeElements())
+    {
+        auto range = Z::Utils::asRange(elem);
+        Elem e;
+        e.source = elem;
+        e.type = elem->type();
+        e.label = elem->displayLabel();
+        e.isComplex = elem->hasOption(Element_Complex);
+        e.isRange = range;
+        e.subRangeSi = range ? range->subRangeSI() : 0;
+        e.paramsOffset = _params.size();
+        e.paramsCount = elem->params().size();
+        for (auto param : elem->params())
+            _params << param->value().toSi();
+        copyElemMatrices(elem, e.matrs);
+        e.kernel = elem->matrixKernel();
+        _elems << e;
+    }
+}
+
+int SchemaSnapshot::indexOf(const Element* elem) const
+{
+    for (int i = 0; i < _elems.size(); i++)
+        if (_elems.at(i).source == elem)
+            return i;
+    return -1;
+}
+
+int SchemaSnapshot::paramIndex(const Element* elem, const Z::Parameter* param) const
+{
+    if (indexOf(elem) < 0)
+        return -1;
+    return elem->params().indexOf(const_cast<Z::Parameter*>(param));
+}
+
+SchemaSnapshot::RoundTrip SchemaSnapshot::roundTrip(const RoundTripCalculator& calc) const
+{
+    const auto& info = calc.matrixInfo();
+    const auto& matrsT = calc.matrsT();
+    const auto& matrsS = calc.matrsS();
+    if (info.size() != matrsT.size())
+        return {};
+
+    RoundTrip roundTrip;
+    for (int i = 0; i < matrsT.size(); i++)
+    {
+        auto owner = info.at(i).owner;
+        int elem = indexOf(owner);
+        if (elem < 0)
+            return {};
+        int kindT = -1, kindS = -1;
+        for (int kind = 0; kind < MATRIX_KIND_COUNT; kind++)
+        {
+            auto m = elemMatrix(owner, MatrixKind(kind));
+            if (m == matrsT.at(i)) kindT = kind;
+            if (m == matrsS.at(i)) kindS = kind;
+        }
+        if (kindT < 0 || kindS < 0)
+            return {};
+        roundTrip.items << RoundTripItem { elem, MatrixKind(kindT), MatrixKind(kindS) };
+    }
+    roundTrip.isReal = calc.isReal();
+    return roundTrip;
+}
+
+//------------------------------------------------------------------------------
+//                            SnapshotCalculator
+//------------------------------------------------------------------------------
+
+SnapshotCalculator::SnapshotCalculator(SchemaSnapshotPtr snapshot) : _snapshot(snapshot)
+{
+    const auto& params = _snapshot->params();
+    _params.assign(params.cbegin(), params.cend());
+    for (const auto& e : _snapshot->elems())
+    {
+        _matrs.push_back(e.matrs);
+        _subRanges.push_back(e.subRangeSi);
+    }
+    _derived.resize(_matrs.size());
+}
+
+bool SnapshotCalculator::canChangeParams(int elem) const
+{
+    return _snapshot->elems().at(elem).kernel.isValid();
+}
+
+void SnapshotCalculator::setParam(int elem, int param, double valueSi)
+{
+    const auto& e = _snapshot->elems().at(elem);
+    if (!e.kernel.isValid())
+    {
+        qWarning() << "SnapshotCalculator::setParam: element is fixed" << e.label;
+        return;
+    }
+    _params[e.paramsOffset + param] = valueSi;
+    calcMatrices(elem);
+}
+
+void SnapshotCalculator::setSubRange(int elem, double subRangeSi)
+{
+    const auto& e = _snapshot->elems().at(elem);
+    if (!e.kernel.calcSubmatrices)
+    {
+        qWarning() << "SnapshotCalculator::setSubRange: element is not a range or it is fixed" << e.label;
+        return;
+    }
+    _subRanges[elem] = subRangeSi;
+    Z::KernelMatrices m;
+    m.derived = _derived.at(elem);
+    e.kernel.calcSubmatrices(_params.data() + e.paramsOffset, subRangeSi, m);
+    _derived[elem] = m.derived;
+    auto& matrs = _matrs.at(elem);
+    matrs[SchemaSnapshot::MT1] = m.mt1;
+    matrs[SchemaSnapshot::MS1] = m.ms1;
+    matrs[SchemaSnapshot::MT2] = m.mt2;
+    matrs[SchemaSnapshot::MS2] = m.ms2;
+}
+
+void SnapshotCalculator::calcMatrices(int elem)
+{
+    const auto& e = _snapshot->elems().at(elem);
+    const double* params = _params.data() + e.paramsOffset;
+    Z::KernelMatrices m;
+    e.kernel.calcMatrices(params, m);
+    if (e.kernel.calcSubmatrices)
+        e.kernel.calcSubmatrices(params, _subRanges.at(elem), m);
+    _derived[elem] = m.derived;
+    auto& matrs = _matrs.at(elem);
+    matrs[SchemaSnapshot::MT] = m.mt;
+    matrs[SchemaSnapshot::MS] = m.ms;
+    matrs[SchemaSnapshot::MT_INV] = m.mt_inv;
+    matrs[SchemaSnapshot::MS_INV] = m.ms_inv;
+    if (e.kernel.calcSubmatrices)
+    {
+        matrs[SchemaSnapshot::MT1] = m.mt1;
+        matrs[SchemaSnapshot::MS1] = m.ms1;
+        matrs[SchemaSnapshot::MT2] = m.mt2;
+        matrs[SchemaSnapshot::MS2] = m.ms2;
+    }
+}
+
+void SnapshotCalculator::setRoundTrip(const SchemaSnapshot::RoundTrip& roundTrip, const QVector<int>& variedElems)
+{
+    _isReal = roundTrip.isReal;
+    _matrsT.clear();
+    _matrsS.clear();
+    _productsT.clear();
+    _productsS.clear();
+
+    // Products are referenced by pointers, so their storage must not be reallocated
+    const int count = roundTrip.items.size();
+    _productsT.reserve(count);
+    _productsS.reserve(count);
+
+    bool lastIsProduct = false;
+    for (const auto& item : roundTrip.items)
+    {
+        const auto& matrs = _matrs.at(item.elem);
+        if (variedElems.contains(item.elem))
+        {
+            _matrsT << &matrs.at(item.kindT);
+            _matrsS << &matrs.at(item.kindS);
+            lastIsProduct = false;
+            continue;
+        }
+        if (!lastIsProduct)
+        {
+            _productsT.emplace_back();
+            _productsS.emplace_back();
+            _matrsT << &_productsT.back();
+            _matrsS << &_productsS.back();
+            lastIsProduct = true;
+        }
+        _productsT.back() *= matrs.at(item.kindT);
+        _productsS.back() *= matrs.at(item.kindS);
+    }
+}
+
+void SnapshotCalculator::multMatrix()
+{
+    if (_isReal)
+    {
+        Z::multMatrixArrayReal(_matrsT, _mt);
+        Z::multMatrixArrayReal(_matrsS, _ms);
+        return;
+    }
+    _mt.unity();
+    _ms.unity();
+    for (int i = 0; i < _matrsT.size(); i++)
+    {
+        _mt *= _matrsT.at(i);
+        _ms *= _matrsS.at(i);
+    }
+}
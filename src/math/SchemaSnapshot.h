@@ -0,0 +1,144 @@
+#ifndef SCHEMA_SNAPSHOT_H
+#define SCHEMA_SNAPSHOT_H
+
+#include "../core/CommonTypes.h"
+#include "../core/Element.h"
+#include "../core/Math.h"
+#include "../core/Parameters.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+class RoundTripCalculator;
+class Schema;
+
+/**
+    Immutable copy of schema data required for round-trip calculations.
+
+    The snapshot is made in the main thread and then it can be used from several threads
+    simultaneously because it has no parameters, listeners, or links to the live schema.
+    Parameter values are stored as they are at the moment of snapshot,
+    i.e. with all formulas and links already resolved.
+
+    Each thread should use its own SnapshotCalculator for changing element parameters
+    and multiplying round-trip matrices.
+*/
+class SchemaSnapshot
+{
+public:
+    enum MatrixKind { MT, MS, MT_INV, MS_INV, MT1, MS1, MT2, MS2, MT_DYN, MS_DYN, MATRIX_KIND_COUNT };
+
+    typedef std::array<Z::Matrix, MATRIX_KIND_COUNT> ElemMatrices;
+
+    struct Elem
+    {
+        /// Source element in the schema. It's only used for identification
+        /// and must not be dereferenced outside of the main thread.
+        const Element* source;
+        QString type;
+        QString label;
+        bool isComplex;
+        bool isRange;
+        /// Index of the first element parameter in the params() array.
+        int paramsOffset;
+        int paramsCount;
+        double subRangeSi;
+        ElemMatrices matrs;
+        /// Kernel for recalculating matrices from parameter values.
+        /// It's invalid for elements whose matrices can't be recalculated outside of the schema.
+        Z::MatrixKernel kernel;
+    };
+
+    /// A matrix of element participating in the round-trip.
+    struct RoundTripItem
+    {
+        int elem;
+        MatrixKind kindT;
+        MatrixKind kindS;
+    };
+
+    struct RoundTrip
+    {
+        QVector<RoundTripItem> items;
+        bool isReal = false;
+        bool isEmpty() const { return items.isEmpty(); }
+    };
+
+    explicit SchemaSnapshot(Schema* schema);
+
+    TripType tripType() const { return _tripType; }
+    double wavelenSi() const { return _wavelenSi; }
+    const QVector<Elem>& elems() const { return _elems; }
+
+    /// SI values of parameters of all elements, see Elem::paramsOffset.
+    const QVector<double>& params() const { return _params; }
+
+    int indexOf(const Element* elem) const;
+
+    /// Returns index of parameter in the list of element parameters or -1 if element is not in the snapshot.
+    int paramIndex(const Element* elem, const Z::Parameter* param) const;
+
+    /// Converts a round-trip prepared by the calculator into the array of snapshot matrices.
+    /// Returns an empty round-trip if it contains elements not presented in the snapshot.
+    RoundTrip roundTrip(const RoundTripCalculator& calc) const;
+
+private:
+    TripType _tripType;
+    double _wavelenSi;
+    QVector<Elem> _elems;
+    QVector<double> _params;
+};
+
+typedef std::shared_ptr<const SchemaSnapshot> SchemaSnapshotPtr;
+
+//------------------------------------------------------------------------------
+/**
+    Calculates round-trip matrices using data of a schema snapshot.
+
+    It keeps its own copy of element parameters and matrices and recalculates matrices
+    with element kernels when parameters change, so the snapshot itself stays untouched.
+    The calculator can be used from a single worker thread.
+*/
+class SnapshotCalculator
+{
+public:
+    explicit SnapshotCalculator(SchemaSnapshotPtr snapshot);
+
+    const SchemaSnapshot* snapshot() const { return _snapshot.get(); }
+
+    /// Returns true if parameters of the element can be changed.
+    /// Elements whose matrices can't be recalculated outside of the schema are fixed.
+    bool canChangeParams(int elem) const;
+
+    void setParam(int elem, int param, double valueSi);
+    void setSubRange(int elem, double subRangeSi);
+
+    const Z::Matrix& matrix(int elem, SchemaSnapshot::MatrixKind kind) const { return _matrs.at(elem).at(kind); }
+
+    /// Prepares arrays of matrices for multiplication.
+    /// Products of consecutive matrices of elements not listed in @a variedElems
+    /// are calculated only once here, so they should not be changed until the next call.
+    void setRoundTrip(const SchemaSnapshot::RoundTrip& roundTrip, const QVector<int>& variedElems = {});
+
+    void multMatrix();
+
+    const Z::Matrix& Mt() const { return _mt; }
+    const Z::Matrix& Ms() const { return _ms; }
+
+private:
+    SchemaSnapshotPtr _snapshot;
+    std::vector<SchemaSnapshot::ElemMatrices> _matrs;
+    std::vector<double> _params;
+    std::vector<double> _subRanges;
+    /// Values derived by kernels from current parameters, see Z::KernelMatrices::derived.
+    std::vector<std::optional<double>> _derived;
+    std::vector<Z::Matrix> _productsT, _productsS;
+    Z::MatrixArray _matrsT, _matrsS;
+    Z::Matrix _mt, _ms;
+    bool _isReal = false;
+
+    void calcMatrices(int elem);
+};
+
+#endif // SCHEMA_SNAPSHOT_H
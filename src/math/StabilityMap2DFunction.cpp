@@ -1,38 +1,344 @@
 #include "StabilityMap2DFunction.h"
 
 #include "../app/PersistentState.h"
+#include "../core/Protocol.h"
 #include "../core/Schema.h"
 #include "../math/RoundTripCalculator.h"
+#include "../math/SchemaSnapshot.h"
 
-void StabilityMap2DFunction::calculate(CalculationMode calcMode)
+#include <QThread>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// Minimal number of cells of the initial grid along each axis for the adaptive mode
+const int MIN_COARSE_CELLS = 16;
+
+/**
+    Fills a raster of stability values calculating them only at nodes of a coarse grid
+    and recursively subdividing cells where the map has some structure.
+
+    A cell is subdivided if its corners disagree on stability or if their values,
+    clamped to the stable range, differ more than the tolerance of this range.
+    Clamping is used because the color scale of the map saturates outside of the stable range
+    so there is no reason to resolve steep but unstable regions. Other points of a uniform cell
+    are bilinearly interpolated from its corners. Note that features smaller than a coarse cell
+    and not touching its corners can be missed, this is why the coarse grid is not too sparse.
+*/
+class StabilityMapRefiner
 {
-    if (!checkArg(&_paramX)) return;
-    if (!checkArg(&_paramY)) return;
+public:
+    using CalcPoint = std::function<Z::PointTS(int ix, int iy)>;
 
-    ElementEventsLocker elemLockX(_paramX.parameter, "StabilityMap2DFunction::calculate");
-    ElementEventsLocker elemLockY(_paramY.parameter, "StabilityMap2DFunction::calculate");
-    Z::ParamValueBackup paramLockX(_paramX.parameter, "StabilityMap2DFunction::calculate");
-    Z::ParamValueBackup paramLockY(_paramY.parameter, "StabilityMap2DFunction::calculate");
+    StabilityMapRefiner(int nx, int ny, double tolerance, Z::Enums::StabilityCalcMode mode, double* resT, double* resS)
+        : _nx(nx), _ny(ny), _resT(resT), _resS(resS)
+    {
+        switch (mode)
+        {
+        case Z::Enums::StabilityCalcMode::Normal: _stableMin = -1, _stableMax = 1; break;
+        case Z::Enums::StabilityCalcMode::Squared: _stableMin = 0, _stableMax = 1; break;
+        }
+        _threshold = tolerance * (_stableMax - _stableMin);
+
+        int step = 1;
+        while ((qMax(nx, ny) - 1) / (step * 2) >= MIN_COARSE_CELLS)
+            step *= 2;
+        _nodesX = makeNodes(nx, step);
+        _nodesY = makeNodes(ny, step);
+
+        _states.resize(nx * ny, NONE);
+    }
+
+    const QVector<int>& nodesX() const { return _nodesX; }
+    const QVector<int>& nodesY() const { return _nodesY; }
+
+    int cellsX() const { return _nodesX.size() - 1; }
+    int cellsY() const { return _nodesY.size() - 1; }
+
+    /// Coarse cells are split into four groups by parity of their indices.
+    /// Cells of the same group have no common points and can be refined in parallel.
+    static bool inGroup(int cx, int cy, int group) { return (cx % 2) + 2 * (cy % 2) == group; }
+
+    void calcPoint(int ix, int iy, const CalcPoint& calc)
+    {
+        int index = ix * _ny + iy;
+        if (_states[index] == CALCULATED) return;
+        auto res = calc(ix, iy);
+        _resT[index] = res.T;
+        _resS[index] = res.S;
+        _states[index] = CALCULATED;
+    }
+
+    /// Corners of the cell, i.e. the coarse nodes, must be calculated before.
+    void refineCell(int cx, int cy, const CalcPoint& calc)
+    {
+        refine(_nodesX.at(cx), _nodesY.at(cy), _nodesX.at(cx+1), _nodesY.at(cy+1), calc);
+    }
+
+    int calculatedCount() const
+    {
+        return int(std::count(_states.cbegin(), _states.cend(), CALCULATED));
+    }
+
+private:
+    enum State : char { NONE, INTERPOLATED, CALCULATED };
+
+    int _nx, _ny;
+    double *_resT, *_resS;
+    double _stableMin = -1, _stableMax = 1, _threshold;
+    QVector<int> _nodesX, _nodesY;
+    std::vector<State> _states;
+
+    static QVector<int> makeNodes(int n, int step)
+    {
+        QVector<int> nodes;
+        for (int i = 0; i < n-1; i += step)
+            nodes << i;
+        nodes << n-1;
+        return nodes;
+    }
+
+    void refine(int x0, int y0, int x1, int y1, const CalcPoint& calc)
+    {
+        if (x1 - x0 < 2 && y1 - y0 < 2)
+            return;
+
+        if (isUniform(_resT, x0, y0, x1, y1) && isUniform(_resS, x0, y0, x1, y1))
+        {
+            interpolate(x0, y0, x1, y1);
+            return;
+        }
+
+        int xm = (x0 + x1) / 2;
+        int ym = (y0 + y1) / 2;
+        bool splitX = x1 - x0 > 1;
+        bool splitY = y1 - y0 > 1;
+        if (splitX)
+        {
+            calcPoint(xm, y0, calc);
+            calcPoint(xm, y1, calc);
+        }
+        if (splitY)
+        {
+            calcPoint(x0, ym, calc);
+            calcPoint(x1, ym, calc);
+        }
+        if (splitX && splitY)
+        {
+            calcPoint(xm, ym, calc);
+            refine(x0, y0, xm, ym, calc);
+            refine(xm, y0, x1, ym, calc);
+            refine(x0, ym, xm, y1, calc);
+            refine(xm, ym, x1, y1, calc);
+        }
+        else if (splitX)
+        {
+            refine(x0, y0, xm, y1, calc);
+            refine(xm, y0, x1, y1, calc);
+        }
+        else
+        {
+            refine(x0, y0, x1, ym, calc);
+            refine(x0, ym, x1, y1, calc);
+        }
+    }
+
+    bool isUniform(const double* res, int x0, int y0, int x1, int y1) const
+    {
+        const double v[4] = { res[x0*_ny + y0], res[x0*_ny + y1], res[x1*_ny + y0], res[x1*_ny + y1] };
+        double minV = 0, maxV = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            if (std::isnan(v[i])) return false;
+            bool stable = v[i] >= _stableMin && v[i] <= _stableMax;
+            if (i > 0 && stable != (v[0] >= _stableMin && v[0] <= _stableMax))
+                return false;
+            double clamped = qBound(_stableMin, v[i], _stableMax);
+            minV = i > 0 ? qMin(minV, clamped) : clamped;
+            maxV = i > 0 ? qMax(maxV, clamped) : clamped;
+        }
+        return maxV - minV <= _threshold;
+    }
+
+    void interpolate(int x0, int y0, int x1, int y1)
+    {
+        const double w = x1 - x0;
+        const double h = y1 - y0;
+        for (int ix = x0; ix <= x1; ix++)
+            for (int iy = y0; iy <= y1; iy++)
+            {
+                int index = ix * _ny + iy;
+                if (_states[index] != NONE) continue;
+                double fx = (ix - x0) / w;
+                double fy = (iy - y0) / h;
+                for (auto res : {_resT, _resS})
+                    res[index] = (1-fx)*(1-fy)*res[x0*_ny + y0] + (1-fx)*fy*res[x0*_ny + y1]
+                               + fx*(1-fy)*res[x1*_ny + y0] + fx*fy*res[x1*_ny + y1];
+                _states[index] = INTERPOLATED;
+            }
+    }
+};
+
+class StabilityMap2DJob : public PlotFuncJob
+{
+public:
+    Z::PlottingRange rangeX, rangeY;
+    QVector<double> resultsT, resultsS;
+    QVector<double> valuesX, valuesY; // SI values
+    int elemX, elemY, paramX, paramY;
+    Z::Enums::StabilityCalcMode mode;
+    double tolerance = 0;
+    int calculatedCount = 0;
+    // One calculator per thread
+    std::vector<std::unique_ptr<SnapshotCalculator>> calcs;
+
+    void run() override
+    {
+        if (tolerance > 0)
+            runAdaptive();
+        else
+            runDense();
+    }
+
+private:
+    template <typename Func>
+    void runThreads(Func calcThread)
+    {
+        const int threadCount = int(calcs.size());
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; i++)
+            threads.emplace_back(calcThread, i);
+        calcThread(0);
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    void runDense()
+    {
+        calculatedCount = int(resultsT.size());
+        const int nx = valuesX.size();
+        const int ny = valuesY.size();
+        const int threadCount = int(calcs.size());
+        double *resT = resultsT.data();
+        double *resS = resultsS.data();
+
+        // Rows are interleaved between threads for better balancing,
+        // as unstable regions can be calculated faster
+        runThreads([&](int threadIndex) {
+            auto calc = calcs.at(threadIndex).get();
+            for (int ix = threadIndex; ix < nx; ix += threadCount)
+            {
+                if (isCancelled()) return;
+                calc->setParam(elemX, paramX, valuesX.at(ix));
+                for (int iy = 0; iy < ny; iy++)
+                {
+                    calc->setParam(elemY, paramY, valuesY.at(iy));
+                    calc->multMatrix();
+                    int index = ix * ny + iy;
+                    resT[index] = RoundTripCalculator::calcStability(calc->Mt(), mode);
+                    resS[index] = RoundTripCalculator::calcStability(calc->Ms(), mode);
+                }
+            }
+        });
+    }
+
+    void runAdaptive()
+    {
+        const int threadCount = int(calcs.size());
+        StabilityMapRefiner refiner(valuesX.size(), valuesY.size(), tolerance, mode, resultsT.data(), resultsS.data());
+
+        auto pointCalculator = [this](int threadIndex) {
+            auto calc = calcs.at(threadIndex).get();
+            return [this, calc](int ix, int iy) {
+                calc->setParam(elemX, paramX, valuesX.at(ix));
+                calc->setParam(elemY, paramY, valuesY.at(iy));
+                calc->multMatrix();
+                return Z::PointTS(RoundTripCalculator::calcStability(calc->Mt(), mode),
+                                  RoundTripCalculator::calcStability(calc->Ms(), mode));
+            };
+        };
+
+        // Coarse grid, nodes are shared between cells so they are calculated before refinement
+        const auto& nodesX = refiner.nodesX();
+        const auto& nodesY = refiner.nodesY();
+        runThreads([&](int threadIndex) {
+            StabilityMapRefiner::CalcPoint calcPoint = pointCalculator(threadIndex);
+            for (int i = threadIndex; i < nodesX.size(); i += threadCount)
+            {
+                if (isCancelled()) return;
+                for (int iy : nodesY)
+                    refiner.calcPoint(nodesX.at(i), iy, calcPoint);
+            }
+        });
+
+        for (int group = 0; group < 4; group++)
+        {
+            if (isCancelled()) return;
+            runThreads([&](int threadIndex) {
+                StabilityMapRefiner::CalcPoint calcPoint = pointCalculator(threadIndex);
+                int cellIndex = 0;
+                for (int cx = 0; cx < refiner.cellsX(); cx++)
+                    for (int cy = 0; cy < refiner.cellsY(); cy++)
+                    {
+                        if (!StabilityMapRefiner::inGroup(cx, cy, group)) continue;
+                        if (cellIndex++ % threadCount != threadIndex) continue;
+                        if (isCancelled()) return;
+                        refiner.refineCell(cx, cy, calcPoint);
+                    }
+            });
+        }
+
+        calculatedCount = refiner.calculatedCount();
+    }
+};
+
+} // namespace
+
+bool StabilityMap2DFunction::prepareCalculation()
+{
+    _errorText.clear();
+
+    if (!checkArg(&_paramX)) return false;
+    if (!checkArg(&_paramY)) return false;
 
-    _rangeX = _paramX.range.plottingRange();
-    _rangeY = _paramY.range.plottingRange();
-    
     auto ref = _paramX.element;
     if (ref == _schema->globalParamsAsElem()) {
         // Use any non-locked element as the reference for round-trip
         auto activeElems = _schema->activeElements();
         if (activeElems.isEmpty()) {
             setError(qApp->translate("Calc error", "No active elements in the schema"));
-            return;
+            return false;
         }
         ref = activeElems.first();
     }
 
-    if (!prepareCalculator(ref)) return;
+    if (!prepareCalculator(ref)) return false;
     _calc->setStabilityCalcMode(stabilityCalcMode());
+    _calc->setVariedElements(Z::Utils::dependentElements(_paramX.parameter)
+                           + Z::Utils::dependentElements(_paramY.parameter));
+    return true;
+}
+
+void StabilityMap2DFunction::calculate(CalculationMode calcMode)
+{
+    if (!prepareCalculation()) return;
 
     if (calcMode != CALC_PLOT) return;
 
+    if (auto job = makeJob(); job)
+    {
+        job->run();
+        applyJob(job.get());
+        return;
+    }
+
+    _rangeX = _paramX.range.plottingRange();
+    _rangeY = _paramY.range.plottingRange();
+
     int nx = _rangeX.points();
     int ny = _rangeY.points();
     auto unitX = _rangeX.unit();
@@ -45,16 +351,43 @@ void StabilityMap2DFunction::calculate(CalculationMode calcMode)
         _resultsS.resize(pointsCount);
     }
 
+    ElementEventsLocker elemLockX(_paramX.parameter, "StabilityMap2DFunction::calculate");
+    ElementEventsLocker elemLockY(_paramY.parameter, "StabilityMap2DFunction::calculate");
+    ParamSweep sweepX(_paramX.parameter, "StabilityMap2DFunction::calculate");
+    ParamSweep sweepY(_paramY.parameter, "StabilityMap2DFunction::calculate");
+
     auto valuesX = _rangeX.values();
     auto valuesY = _rangeY.values();
 
+    double tolerance = refineTolerance();
+    if (tolerance > 0)
+    {
+        StabilityMapRefiner refiner(nx, ny, tolerance, stabilityCalcMode(), _resultsT.data(), _resultsS.data());
+        StabilityMapRefiner::CalcPoint calcPoint = [&](int ix, int iy){
+            sweepX.setValue({valuesX.at(ix), unitX});
+            sweepY.setValue({valuesY.at(iy), unitY});
+            _calc->multMatrix("StabilityMap2DFunction::calculate");
+            return _calc->stability();
+        };
+        for (int ix : refiner.nodesX())
+            for (int iy : refiner.nodesY())
+                refiner.calcPoint(ix, iy, calcPoint);
+        for (int cx = 0; cx < refiner.cellsX(); cx++)
+            for (int cy = 0; cy < refiner.cellsY(); cy++)
+                refiner.refineCell(cx, cy, calcPoint);
+        _calculatedPoints = refiner.calculatedCount();
+        Z_INFO("Calculated" << _calculatedPoints << "of" << pointsCount << "points")
+        return;
+    }
+
+    _calculatedPoints = pointsCount;
     for (int ix = 0; ix < nx; ix++)
     {
-        _paramX.parameter->setValue({valuesX.at(ix), unitX});
+        sweepX.setValue({valuesX.at(ix), unitX});
 
         for (int iy = 0; iy < ny; iy++)
         {
-            _paramY.parameter->setValue({valuesY.at(iy), unitY});
+            sweepY.setValue({valuesY.at(iy), unitY});
 
             _calc->multMatrix("StabilityMap2DFunction::calculate");
 
@@ -66,6 +399,76 @@ void StabilityMap2DFunction::calculate(CalculationMode calcMode)
     }
 }
 
+PlotFuncJobPtr StabilityMap2DFunction::prepareJob()
+{
+    if (!prepareCalculation()) return {};
+    return makeJob();
+}
+
+void StabilityMap2DFunction::applyJob(PlotFuncJob* job)
+{
+    auto mapJob = dynamic_cast<StabilityMap2DJob*>(job);
+    if (!mapJob) return;
+    _rangeX = mapJob->rangeX;
+    _rangeY = mapJob->rangeY;
+    _resultsT.swap(mapJob->resultsT);
+    _resultsS.swap(mapJob->resultsS);
+    _calculatedPoints = mapJob->calculatedCount;
+    if (mapJob->tolerance > 0)
+        Z_INFO("Calculated" << _calculatedPoints << "of" << _resultsT.size() << "points")
+}
+
+PlotFuncJobPtr StabilityMap2DFunction::makeJob()
+{
+    // Snapshot is not owned by the schema, so element parameters can't be changed
+    // via links or formulas there, such parameters can only be varied in the live schema
+    for (auto var : {&_paramX, &_paramY})
+    {
+        auto elems = Z::Utils::dependentElements(var->parameter);
+        if (elems.size() != 1 || elems.first() != var->element)
+            return {};
+    }
+
+    auto snapshot = std::make_shared<const SchemaSnapshot>(_schema);
+    auto roundTrip = snapshot->roundTrip(*_calc);
+    if (roundTrip.isEmpty())
+        return {};
+
+    auto job = std::make_shared<StabilityMap2DJob>();
+    job->elemX = snapshot->indexOf(_paramX.element);
+    job->elemY = snapshot->indexOf(_paramY.element);
+    job->paramX = snapshot->paramIndex(_paramX.element, _paramX.parameter);
+    job->paramY = snapshot->paramIndex(_paramY.element, _paramY.parameter);
+    if (job->paramX < 0 || job->paramY < 0)
+        return {};
+
+    job->rangeX = _paramX.range.plottingRange();
+    job->rangeY = _paramY.range.plottingRange();
+    const int nx = job->rangeX.points();
+    const int ny = job->rangeY.points();
+    for (auto v : job->rangeX.values())
+        job->valuesX << job->rangeX.unit()->toSi(v);
+    for (auto v : job->rangeY.values())
+        job->valuesY << job->rangeY.unit()->toSi(v);
+    job->resultsT.resize(nx * ny);
+    job->resultsS.resize(nx * ny);
+    job->mode = _calc->stabilityCalcMode();
+    job->tolerance = refineTolerance();
+
+    // Calculators are created in the main thread
+    // because element constructors are not thread-safe
+    const int threadCount = qMax(1, qMin(QThread::idealThreadCount(), nx));
+    for (int i = 0; i < threadCount; i++)
+    {
+        auto calc = std::make_unique<SnapshotCalculator>(snapshot);
+        if (!calc->canChangeParams(job->elemX) || !calc->canChangeParams(job->elemY))
+            return {};
+        calc->setRoundTrip(roundTrip, {job->elemX, job->elemY});
+        job->calcs.push_back(std::move(calc));
+    }
+    return job;
+}
+
 void StabilityMap2DFunction::loadPrefs()
 {
     _stabilityCalcMode = RecentData::getEnum("func_stab_2d_map_mode", Z::Enums::StabilityCalcMode::Normal);
@@ -92,14 +495,23 @@ Z::PointTS StabilityMap2DFunction::calculateAtXY(const Z::Value& x, const Z::Val
 {
     ElementEventsLocker elemLockX(_paramX.parameter, "StabilityMap2DFunction::calculateAtXY");
     ElementEventsLocker elemLockY(_paramY.parameter, "StabilityMap2DFunction::calculateAtXY");
-    Z::ParamValueBackup paramLockX(_paramX.parameter, "StabilityMap2DFunction::calculateAtXY");
-    Z::ParamValueBackup paramLockY(_paramY.parameter, "StabilityMap2DFunction::calculateAtXY");
-    _paramX.parameter->setValue(x);
-    _paramY.parameter->setValue(y);
+    ParamSweep sweepX(_paramX.parameter, "StabilityMap2DFunction::calculateAtXY");
+    ParamSweep sweepY(_paramY.parameter, "StabilityMap2DFunction::calculateAtXY");
+    sweepX.setValue(x);
+    sweepY.setValue(y);
     _calc->multMatrix("StabilityMap2DFunction::calculateAtXY");
     return _calc->stability();
 }
 
+double StabilityMap2DFunction::refineTolerance() const
+{
+    double tx = _paramX.range.tolerance;
+    double ty = _paramY.range.tolerance;
+    if (tx > 0 && ty > 0)
+        return qMin(tx, ty);
+    return qMax(tx, ty);
+}
+
 PlotFuncDeps StabilityMap2DFunction::dependsOn() const
 {
     return PlotFuncDeps {
@@ -22,14 +22,25 @@ public:
     const QVector<double>& resultsT() const { return _resultsT; }
     const QVector<double>& resultsS() const { return _resultsS; }
 
+    /// Number of points actually calculated at the last calculation,
+    /// the rest of results are interpolated in the adaptive mode.
+    int calculatedPoints() const { return _calculatedPoints; }
+
     void calculate(CalculationMode calcMode = CALC_PLOT) override;
     bool hasOptions() const override { return true; }
     bool hasDataTable() const override { return false; }
     void loadPrefs() override;
     PlotFuncDeps dependsOn() const override;
+    PlotFuncJobPtr prepareJob() override;
+    void applyJob(PlotFuncJob* job) override;
 
     Z::PointTS calculateAtXY(const Z::Value& x, const Z::Value& y);
 
+    /// Tolerance of adaptive refinement of the map, it's set in ranges of the variables.
+    /// When both ranges have tolerance, the more strict one is used.
+    /// Zero means the full grid is calculated.
+    double refineTolerance() const;
+
     Z::Enums::StabilityCalcMode stabilityCalcMode() const { return _stabilityCalcMode; }
     void setStabilityCalcMode(Z::Enums::StabilityCalcMode mode) { _stabilityCalcMode = mode; }
     
@@ -39,8 +50,11 @@ private:
     Z::Enums::StabilityCalcMode _stabilityCalcMode = Z::Enums::StabilityCalcMode::Normal;
     QVector<double> _resultsT, _resultsS;
     Z::PlottingRange _rangeX, _rangeY;
+    int _calculatedPoints = 0;
 
     bool checkArg(Z::Variable* arg);
+    bool prepareCalculation();
+    PlotFuncJobPtr makeJob();
 };
 
 #endif // STABILITY_MAP_2D_FUNCTION_H
@@ -3,13 +3,12 @@
 #include "../app/AppSettings.h"
 #include "../app/PersistentState.h"
 #include "../core/Schema.h"
+#include "../math/FunctionUtils.h"
 #include "../math/RoundTripCalculator.h"
 
 #include <QApplication>
 
-#ifdef Q_OS_LINUX
 #include <optional>
-#endif
 
 void StabilityMapFunction::calculate(CalculationMode calcMode)
 {
@@ -30,12 +29,13 @@ void StabilityMapFunction::calculate(CalculationMode calcMode)
         elem = activeElems.first();
     }
     ElementEventsLocker elemLock(param, "StabilityMapFunction::calculate");
-    Z::ParamValueBackup paramLock(param, "StabilityMapFunction::calculate");
+    ParamSweep sweep(param, "StabilityMapFunction::calculate");
 
     _plotRange = arg()->range.plottingRange();
     if (!prepareResults(_plotRange)) return;
     if (!prepareCalculator(elem)) return;
     _calc->setStabilityCalcMode(stabilityCalcMode());
+    _calc->setVariedElements(sweep.elems());
 
     if (calcMode != CALC_PLOT) return;
 
@@ -56,7 +56,7 @@ void StabilityMapFunction::calculate(CalculationMode calcMode)
 
     for (auto x : _plotRange.values())
     {
-        param->setValue({x, _plotRange.unit()});
+        sweep.setValue({x, _plotRange.unit()});
         _calc->multMatrix("StabilityMapFunction::calculate");
         addResultPoint(x, _calc->stability());
 
@@ -82,8 +82,8 @@ Z::PointTS StabilityMapFunction::calculateAt(const Z::Value& v)
     _calc->setStabilityCalcMode(stabilityCalcMode());
     auto param = arg()->parameter;
     ElementEventsLocker elemLock(param, "StabilityMapFunction::calculateAt");
-    Z::ParamValueBackup paramLock(param, "StabilityMapFunction::calculateAt");
-    param->setValue(v);
+    ParamSweep sweep(param, "StabilityMapFunction::calculateAt");
+    sweep.setValue(v);
     _calc->multMatrix("StabilityMapFunction::calculateAt");
     return _calc->stability();
 }
@@ -92,31 +92,21 @@ QVector<Z::RangeSi> StabilityMapFunction::findStabilityBounds(Z::WorkPlane ts) c
 {
     auto param = arg()->parameter;
     ElementEventsLocker elemLock(param, "StabilityMapFunction::findStabilityBounds");
-    Z::ParamValueBackup paramLock(param, "StabilityMapFunction::findStabilityBounds");
-    _calc->setStabilityCalcMode(Z::Enums::StabilityCalcMode::Squared);
+    ParamSweep sweep(param, "StabilityMapFunction::findStabilityBounds");
 
-    auto solve = [&](double x1, double x2) -> std::optional<double> {
-        const double eps = 1e-7;
-        const int maxIters = 100;
-        param->setValue({x1, _plotRange.unit()});
+    // Squared stability parameter 1-((A+D)/2)^2 changes its sign at stability bounds
+    auto stability = [&](double x) {
+        sweep.setValue({x, _plotRange.unit()});
         _calc->multMatrix("StabilityMapFunction::findStabilityBounds");
-        double p1 = _calc->stability(ts);
-        int iter = 0;
-        double p0, x0 = (x1 + x2) / 2.0;
-        while (qAbs(p1) > eps && iter < 100) {
-            param->setValue({x0, _plotRange.unit()});
-            _calc->multMatrix("StabilityMapFunction::findStabilityBounds");
-            p0 = _calc->stability(ts);
-            if (p1 * p0 < 0) x2 = x0;
-            else x1 = x0, p1 = p0;
-            x0 = (x1 + x2) / 2.0, iter++;
-        }
-        if (iter == maxIters) {
-            qWarning() << "StabilityMapFunction::calcStabilityBounds: "
-                       << "failed to solve bound after" << iter << "iterations";
-            return {};
-        }
-        return x1;
+        return RoundTripCalculator::calcStabilityCplx(_calc->M(ts), Z::Enums::StabilityCalcMode::Squared).real();
+    };
+
+    auto solve = [&](double x1, double x2) -> std::optional<double> {
+        auto x = FunctionUtils::findRoot(stability, x1, qMin(x2, _plotRange.stop()));
+        if (!x)
+            qWarning() << "StabilityMapFunction::findStabilityBounds: "
+                       << "failed to solve bound in range" << x1 << x2;
+        return x;
     };
 
     QVector<Z::RangeSi> res;
@@ -64,6 +64,7 @@ void TableFunction::calculate()
         setError(_beamCalc->error());
         return;
     }
+    _beamCalc->setReferenceSweep(!needsRoundTripMatrices());
 
     #define CHECK_ERR(f) {\
         QString res = f;\
@@ -143,6 +144,9 @@ void TableFunction::calculate()
 
     #undef CHECK_ERR
 
+    if (ok())
+        calculateResults(_results);
+
     if (!ok())
         _results.clear();
         
@@ -143,9 +143,15 @@ protected:
     void calculateAt(const CalcElem &calcElem, const ResultElem &resultElem, OptionalIor overrideIor = {});
 
     virtual bool prepare() { return true; }
+    /// Should return true if the function uses matrices the round-trip consists of,
+    /// otherwise round-trips at all positions are calculated in a single pass through the schema.
+    virtual bool needsRoundTripMatrices() const { return false; }
     virtual void unprepare() {}
     virtual QVector<Z::PointTS> calculatePumpBeforeSchema() { return {}; };
     virtual QVector<Z::PointTS> calculateInternal(const ResultElem &resultElem) = 0;
+    /// Called when all positions are passed through calculateInternal().
+    /// Can be used for calculating the values of all results at once.
+    virtual void calculateResults(QVector<Result>& results) { Q_UNUSED(results) }
     
 private:
     QVector<Result> _results;
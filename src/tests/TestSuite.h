@@ -23,6 +23,7 @@ USE_GROUP(SchemaTests)                             // test_Schema.cpp
 USE_GROUP(SchemaReaderIniTests)                    // test_SchemaReaderIni.cpp
 USE_GROUP(SchemaReaderJsonTests)                   // test_SchemaReaderJson.cpp
 USE_GROUP(RoundTripCalculatorTests)                // test_RoundTripCalculator.cpp
+USE_GROUP(SchemaSnapshotTests)                     // test_SchemaSnapshot.cpp
 USE_GROUP(GaussCalculatorTests)                    // test_GaussCalculator.cpp
 USE_GROUP(GrinCalculatorTests)                     // test_GrinCalculator.cpp
 USE_GROUP(PumpCalculatorTests)                     // test_PumpCalculator.cpp
@@ -31,14 +32,19 @@ USE_GROUP(BeamCalculatorTests)                     // test_BeamCalculator.cpp
 USE_GROUP(FunctionUtilsTests)                      // test_FunctionUtils.cpp
 USE_GROUP(InfoFunctionsTests)                      // test_InfoFunctions.cpp
 USE_GROUP(PlotFunctionsTests)                      // test_PlotFunctions.cpp
+USE_GROUP(PlotFuncWindowTests)                     // test_PlotFuncWindow.cpp
 USE_GROUP(TableFunctionTests)                      // test_TableFunction.cpp
 USE_GROUP(ElementSelectorWidgetTests)              // test_ElemSelectorWidget.cpp
 USE_GROUP(PumpWindowTests)                         // test_PumpWindow.cpp
 USE_GROUP(LuaHelperTests)                          // test_LuaHelper.cpp
+USE_GROUP(ExpressionTests)                         // test_Expression.cpp
 USE_GROUP(ProjectOperationsTests)                  // test_ProjectOperations.cpp
+USE_GROUP(BatchRunnerTests)                        // test_BatchRunner.cpp
 USE_GROUP(FormulaTests)                            // test_Formula.cpp
 USE_GROUP(UtilsTests)                              // test_Utils.cpp
 USE_GROUP(AdjusterTests)                           // test_Adjuster.cpp
+USE_GROUP(PerfTests)                               // test_Perf.cpp
+USE_GROUP(PyRunnerTests)                           // test_PyRunner.cpp
 
 TEST_SUITE(
     ADD_GROUP(Ori::Tests::All),
@@ -61,6 +67,7 @@ TEST_SUITE(
     ADD_GROUP(SchemaReaderIniTests),
     ADD_GROUP(SchemaReaderJsonTests),
     ADD_GROUP(RoundTripCalculatorTests),
+    ADD_GROUP(SchemaSnapshotTests),
     ADD_GROUP(GaussCalculatorTests),
     ADD_GROUP(GrinCalculatorTests),
     ADD_GROUP(PumpCalculatorTests),
@@ -69,14 +76,19 @@ TEST_SUITE(
     ADD_GROUP(FunctionUtilsTests),
     ADD_GROUP(InfoFunctionsTests),
     ADD_GROUP(PlotFunctionsTests),
+    ADD_GROUP(PlotFuncWindowTests),
     ADD_GROUP(TableFunctionTests),
     ADD_GROUP(ElementSelectorWidgetTests),
     ADD_GROUP(PumpWindowTests),
     ADD_GROUP(LuaHelperTests),
+    ADD_GROUP(ExpressionTests),
     ADD_GROUP(ProjectOperationsTests),
+    ADD_GROUP(BatchRunnerTests),
     ADD_GROUP(FormulaTests),
     ADD_GROUP(UtilsTests),
     ADD_GROUP(AdjusterTests),
+    ADD_GROUP(PerfTests),
+    ADD_GROUP(PyRunnerTests),
 )
 
 } // namespace Tests
@@ -0,0 +1,534 @@
+/*
+    Benchmark of the calculation core.
+
+    It times real calculations over synthetic schemas of several sizes
+    and over example schemas and prints results in machine-readable form,
+    so results of different builds can be compared to catch regressions.
+
+    Synthetic schema is a resonator made of a periodic lens guide folded by two flat mirrors:
+    M1, L/2, [F, L]..., F, L/2, M2. It is stable at any number of cells because each cell is stable.
+    The size of a case is the number of elements in the schema.
+
+    Build:
+    cmake -B build -DREZONATOR_BENCHMARK=ON
+    cmake --build build --target rezonator-bench
+
+    Run:
+    bin/rezonator-bench --format json --output bench_2.1.0.json
+    bin/rezonator-bench --baseline bench_2.1.0.json --threshold 1.2
+
+    Run with --help to see all options.
+*/
+
+#include "../app/AppSettings.h"
+#include "../core/ElementFormula.h"
+#include "../core/Elements.h"
+#include "../core/Format.h"
+#include "../core/Protocol.h"
+#include "../core/Schema.h"
+#include "../io/SchemaReaderJson.h"
+#include "../io/SchemaWriterJson.h"
+#include "../math/BeamParamsAtElemsFunction.h"
+#include "../math/CausticFunction.h"
+#include "../math/MultirangeCausticFunction.h"
+#include "../math/RoundTripCalculator.h"
+#include "../math/StabilityMap2DFunction.h"
+#include "../tests/TestUtils.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace {
+
+struct BenchResult
+{
+    QString name;
+    int size = 0;
+    /// Number of operations in one iteration, e.g. points of a plot.
+    int ops = 1;
+    int iterations = 0;
+    qint64 minNs = 0;
+    qint64 medianNs = 0;
+    qint64 meanNs = 0;
+    QString error;
+
+    double nsPerOp() const { return double(medianNs) / ops; }
+};
+
+/// Prepared benchmark iteration. It returns an error message if calculation fails.
+typedef std::function<QString()> BenchRun;
+
+struct BenchCase
+{
+    QString name;
+    int size;
+    int ops;
+    /// Makes all required data and returns a function doing one iteration.
+    /// Preparation is not timed.
+    std::function<BenchRun()> prepare;
+};
+
+struct BenchOptions
+{
+    qint64 minTimeNs = 500'000'000;
+    int minIterations = 5;
+    int maxIterations = 10000;
+};
+
+qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BenchResult runCase(const BenchCase& c, const BenchOptions& opts)
+{
+    BenchResult res;
+    res.name = c.name;
+    res.size = c.size;
+    res.ops = c.ops;
+
+    auto run = c.prepare();
+    // Warming up, it also checks if calculation is possible at all
+    res.error = run();
+    if (!res.error.isEmpty())
+        return res;
+
+    std::vector<qint64> times;
+    qint64 total = 0;
+    while (int(times.size()) < opts.maxIterations &&
+           (int(times.size()) < opts.minIterations || total < opts.minTimeNs))
+    {
+        qint64 start = now();
+        run();
+        qint64 time = now() - start;
+        times.push_back(time);
+        total += time;
+    }
+    std::sort(times.begin(), times.end());
+    res.iterations = int(times.size());
+    res.minNs = times.front();
+    res.medianNs = times.at(times.size() / 2);
+    res.meanNs = total / res.iterations;
+    return res;
+}
+
+//------------------------------------------------------------------------------
+//                              Synthetic schemas
+//------------------------------------------------------------------------------
+
+struct LensGuide
+{
+    std::shared_ptr<Schema> schema = std::make_shared<Schema>();
+    QVector<ElemEmptyRange*> ranges;
+    QVector<Element*> lenses;
+
+    /// Cells with lenses given by formula elements are used for benchmarking of formulas.
+    LensGuide(int cells, bool formulaLenses = false)
+    {
+        schema->setTripType(TripType::SW);
+        schema->wavelength().setValue(Z::Value(1064, Z::Units::nm()));
+        Elements elems;
+        elems << makeElem<ElemFlatMirror>("M1", "");
+        ranges << makeElem<ElemEmptyRange>("L0", "L = 50mm");
+        elems << ranges.last();
+        for (int i = 1; i <= cells; i++)
+        {
+            if (formulaLenses)
+            {
+                auto lens = new ElemFormula;
+                lens->setLabel(QString("F%1").arg(i));
+                auto f = new Z::Parameter(Z::Dims::none(), "f");
+                f->setValue(0.1);
+                lens->addParam(f);
+                lens->setHasMatricesTS(false);
+                lens->setFormula("A = 1; B = 0; C = -1/f; D = 1");
+                lenses << lens;
+            }
+            else
+                lenses << makeElem<ElemThinLens>(QString("F%1").arg(i), "F = 100mm");
+            elems << lenses.last();
+            ranges << makeElem<ElemEmptyRange>(QString("L%1").arg(i), i < cells ? "L = 100mm" : "L = 50mm");
+            elems << ranges.last();
+        }
+        elems << makeElem<ElemFlatMirror>("M2", "");
+        schema->insertElements(elems, -1, Arg::RaiseEvents(false));
+    }
+
+    int size() const { return schema->count(); }
+};
+
+const QVector<int> CELLS = { 1, 4, 16, 64 };
+
+void addRoundTripCases(QVector<BenchCase>& cases)
+{
+    for (int cells : CELLS)
+    {
+        const int ops = 1000;
+        LensGuide g(cells);
+        cases << BenchCase{ "RoundTripCalculator.multMatrix", g.size(), ops, [cells]{
+            auto g = std::make_shared<LensGuide>(cells);
+            auto calc = std::make_shared<RoundTripCalculator>(g->schema.get(), g->ranges.first());
+            calc->calcRoundTrip();
+            return [g, calc]{
+                for (int i = 0; i < ops; i++)
+                    calc->multMatrix("benchmark");
+                return calc->error();
+            };
+        }};
+    }
+}
+
+void addCausticCases(QVector<BenchCase>& cases)
+{
+    for (int cells : CELLS)
+    {
+        const int points = 1000;
+        LensGuide g(cells);
+        cases << BenchCase{ "CausticFunction", g.size(), points, [cells]{
+            auto g = std::make_shared<LensGuide>(cells);
+            auto func = std::make_shared<CausticFunction>(g->schema.get());
+            auto range = g->ranges.at(g->ranges.size() / 2);
+            func->arg()->element = range;
+            func->arg()->parameter = range->paramLength();
+            func->arg()->range = Z::VariableRange::withPoints(
+                Z::Value(0, Z::Units::mm()), range->paramLength()->value(), points);
+            return [g, func]{
+                func->calculate();
+                return func->errorText();
+            };
+        }};
+    }
+}
+
+void addMultirangeCausticCases(QVector<BenchCase>& cases)
+{
+    for (int cells : CELLS)
+    {
+        const int points = 100;
+        LensGuide g(cells);
+        cases << BenchCase{ "MultirangeCausticFunction", g.size(), points * int(g.ranges.size()), [cells]{
+            auto g = std::make_shared<LensGuide>(cells);
+            auto func = std::make_shared<MultirangeCausticFunction>(g->schema.get());
+            QVector<Z::Variable> args;
+            for (auto range : std::as_const(g->ranges))
+            {
+                Z::Variable arg;
+                arg.element = range;
+                arg.range = Z::VariableRange::withPoints(
+                    Z::Value(0, Z::Units::mm()), range->paramLength()->value(), points);
+                args << arg;
+            }
+            func->setArgs(args);
+            return [g, func]{
+                func->calculate();
+                return func->errorText();
+            };
+        }};
+    }
+}
+
+void addStabMap2DCases(QVector<BenchCase>& cases)
+{
+    for (int cells : CELLS)
+    {
+        const int points = 50;
+        LensGuide g(cells);
+        cases << BenchCase{ "StabilityMap2DFunction", g.size(), points*points, [cells]{
+            auto g = std::make_shared<LensGuide>(cells);
+            auto func = std::make_shared<StabilityMap2DFunction>(g->schema.get());
+            for (auto [var, range] : {
+                    std::make_pair(func->paramX(), g->ranges.first()),
+                    std::make_pair(func->paramY(), g->ranges.last()) })
+            {
+                var->element = range;
+                var->parameter = range->paramLength();
+                var->range = Z::VariableRange::withPoints(
+                    Z::Value(10, Z::Units::mm()), Z::Value(150, Z::Units::mm()), points);
+            }
+            return [g, func]{
+                func->calculate();
+                return func->errorText();
+            };
+        }};
+    }
+}
+
+void addBeamParamsAtElemsCases(QVector<BenchCase>& cases)
+{
+    for (int cells : CELLS)
+    {
+        LensGuide g(cells);
+        cases << BenchCase{ "BeamParamsAtElemsFunction", g.size(), 1, [cells]{
+            auto g = std::make_shared<LensGuide>(cells);
+            auto func = std::make_shared<BeamParamsAtElemsFunction>(g->schema.get());
+            return [g, func]{
+                func->calculate();
+                return func->errorText();
+            };
+        }};
+    }
+}
+
+void addElemFormulaCases(QVector<BenchCase>& cases)
+{
+    for (int cells : CELLS)
+    {
+        LensGuide g(cells, true);
+        cases << BenchCase{ "ElemFormula.calcMatrix", g.size(), cells, [cells]{
+            auto g = std::make_shared<LensGuide>(cells, true);
+            return [g]{
+                for (auto lens : std::as_const(g->lenses))
+                {
+                    lens->calcMatrix("benchmark");
+                    auto err = static_cast<ElemFormula*>(lens)->error();
+                    if (!err.isEmpty()) return err;
+                }
+                return QString();
+            };
+        }};
+    }
+}
+
+QString readSchema(const QByteArray& data)
+{
+    Schema schema;
+    SchemaReaderJson reader(&schema);
+    reader.skipFuncWindows = true;
+    reader.readFromUtf8(data);
+    return reader.report().hasErrors() ? reader.report().str() : QString();
+}
+
+void addSchemaReaderCases(QVector<BenchCase>& cases, const QString& tmpDir)
+{
+    for (int cells : CELLS)
+    {
+        LensGuide g(cells);
+        auto fileName = QDir(tmpDir).filePath(QString("lens_guide_%1.rez").arg(cells));
+        SchemaWriterJson writer(g.schema.get());
+        writer.writeToFile(fileName);
+        cases << BenchCase{ "SchemaReaderJson", g.size(), 1, [fileName]{
+            QFile file(fileName);
+            QByteArray data;
+            if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+                data = file.readAll();
+            return [data]{ return readSchema(data); };
+        }};
+    }
+
+    // Real schemas are benchmarked as is, their size is the number of elements
+    QDir examplesDir(qApp->applicationDirPath() + "/examples");
+    const auto files = examplesDir.entryInfoList({"*.rez"}, QDir::Files, QDir::Name);
+    for (const auto& fileInfo : files)
+    {
+        QFile file(fileInfo.filePath());
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            continue;
+        auto data = file.readAll();
+        Schema schema;
+        SchemaReaderJson reader(&schema);
+        reader.skipFuncWindows = true;
+        reader.readFromUtf8(data);
+        cases << BenchCase{ "SchemaReaderJson." + fileInfo.completeBaseName(), schema.count(), 1, [data]{
+            return [data]{ return readSchema(data); };
+        }};
+    }
+}
+
+//------------------------------------------------------------------------------
+//                                  Output
+//------------------------------------------------------------------------------
+
+QString resultKey(const QString& name, int size)
+{
+    return QString("%1/%2").arg(name).arg(size);
+}
+
+QJsonObject resultsToJson(const QVector<BenchResult>& results)
+{
+    QJsonArray resultsJson;
+    for (const auto& r : results)
+    {
+        QJsonObject obj({
+            { "name", r.name },
+            { "size", r.size },
+            { "ops", r.ops },
+        });
+        if (r.error.isEmpty())
+        {
+            obj["iterations"] = r.iterations;
+            obj["min_ns"] = double(r.minNs);
+            obj["median_ns"] = double(r.medianNs);
+            obj["mean_ns"] = double(r.meanNs);
+            obj["ns_per_op"] = r.nsPerOp();
+        }
+        else obj["error"] = r.error;
+        resultsJson.append(obj);
+    }
+    return QJsonObject({
+        { "app_version", Z::Strs::appVersion() },
+        { "qt_version", qVersion() },
+#ifdef QT_DEBUG
+        { "build", "debug" },
+#else
+        { "build", "release" },
+#endif
+        { "date", QDateTime::currentDateTime().toString(Qt::ISODate) },
+        { "os", QSysInfo::prettyProductName() },
+        { "cpu", QSysInfo::currentCpuArchitecture() },
+        { "threads", QThread::idealThreadCount() },
+        { "results", resultsJson },
+    });
+}
+
+QString resultsToCsv(const QVector<BenchResult>& results)
+{
+    QString csv;
+    QTextStream out(&csv);
+    out << "name,size,ops,iterations,min_ns,median_ns,mean_ns,ns_per_op,error\n";
+    for (const auto& r : results)
+        out << r.name << ',' << r.size << ',' << r.ops << ','
+            << r.iterations << ',' << r.minNs << ',' << r.medianNs << ',' << r.meanNs << ','
+            << QString::number(r.nsPerOp(), 'f', 1) << ',' << QString(r.error).replace(',', ';').replace('\n', ' ') << '\n';
+    return csv;
+}
+
+/// Compares median times with results of a previous run.
+/// Returns false if some case became slower than the threshold allows.
+bool compareWithBaseline(const QVector<BenchResult>& results, const QString& fileName, double threshold, QTextStream& log)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        log << "Unable to open baseline file " << fileName << ": " << file.errorString() << Qt::endl;
+        return false;
+    }
+    QMap<QString, double> baseline;
+    const auto baselineJson = QJsonDocument::fromJson(file.readAll()).object()["results"].toArray();
+    for (const auto& it : baselineJson)
+    {
+        auto obj = it.toObject();
+        if (obj.contains("median_ns"))
+            baseline[resultKey(obj["name"].toString(), obj["size"].toInt())] = obj["median_ns"].toDouble();
+    }
+
+    bool ok = true;
+    log << "Comparison with " << fileName << " (median time ratio, threshold " << threshold << "):" << Qt::endl;
+    for (const auto& r : results)
+    {
+        auto key = resultKey(r.name, r.size);
+        if (!r.error.isEmpty() || !baseline.contains(key) || baseline[key] <= 0)
+            continue;
+        double ratio = r.medianNs / baseline[key];
+        bool regressed = ratio > threshold;
+        if (regressed) ok = false;
+        log << (regressed ? "  SLOWER " : "         ") << key << ": " << QString::number(ratio, 'f', 2) << Qt::endl;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("reZonator");
+    app.setOrganizationName("orion-project.org");
+    app.setApplicationVersion(Z::Strs::appVersion());
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark of the reZonator calculation core.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption optionFilter("filter", "Run only cases whose names match the regular expression.", "regex");
+    QCommandLineOption optionMinTime("min-time", "Minimal time of running each case, ms. Default is 500.", "ms", "500");
+    QCommandLineOption optionFormat("format", "Result format: json or csv. Default is json.", "format", "json");
+    QCommandLineOption optionOutput("output", "File for results. Results are written to stdout if omitted.", "file");
+    QCommandLineOption optionBaseline("baseline", "Results of a previous run in json format to compare with.", "file");
+    QCommandLineOption optionThreshold("threshold", "Maximal allowed ratio of median time to baseline. Default is 1.2.", "ratio", "1.2");
+    QCommandLineOption optionList("list", "List cases without running them.");
+    parser.addOptions({optionFilter, optionMinTime, optionFormat, optionOutput, optionBaseline, optionThreshold, optionList});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream log(stderr);
+
+    Z::Protocol::isEnabled = false;
+    Z::Protocol::isDebugEnabled = false;
+    AppSettings::instance();
+
+    QTemporaryDir tmpDir;
+    QVector<BenchCase> cases;
+    addRoundTripCases(cases);
+    addCausticCases(cases);
+    addMultirangeCausticCases(cases);
+    addStabMap2DCases(cases);
+    addBeamParamsAtElemsCases(cases);
+    addElemFormulaCases(cases);
+    addSchemaReaderCases(cases, tmpDir.path());
+
+    if (parser.isSet(optionFilter))
+    {
+        QRegularExpression filter(parser.value(optionFilter));
+        cases.erase(std::remove_if(cases.begin(), cases.end(),
+            [&filter](const BenchCase& c){ return !filter.match(c.name).hasMatch(); }), cases.end());
+    }
+
+    if (parser.isSet(optionList))
+    {
+        for (const auto& c : std::as_const(cases))
+            out << resultKey(c.name, c.size) << Qt::endl;
+        return 0;
+    }
+
+    BenchOptions opts;
+    opts.minTimeNs = parser.value(optionMinTime).toLongLong() * 1'000'000;
+
+    QVector<BenchResult> results;
+    for (const auto& c : std::as_const(cases))
+    {
+        log << resultKey(c.name, c.size) << "... " << Qt::flush;
+        auto r = runCase(c, opts);
+        if (r.error.isEmpty())
+            log << QString::number(r.medianNs / 1e6, 'f', 3) << " ms, " << QString::number(r.nsPerOp(), 'f', 0) << " ns/op" << Qt::endl;
+        else
+            log << "FAILED: " << r.error << Qt::endl;
+        results << r;
+    }
+
+    QByteArray report = parser.value(optionFormat).toLower() == "csv"
+        ? resultsToCsv(results).toUtf8()
+        : QJsonDocument(resultsToJson(results)).toJson();
+    if (parser.isSet(optionOutput))
+    {
+        QFile file(parser.value(optionOutput));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            log << "Unable to open file for writing: " << file.fileName() << ": " << file.errorString() << Qt::endl;
+            return 1;
+        }
+        file.write(report);
+    }
+    else out << report << Qt::flush;
+
+    bool ok = std::all_of(results.cbegin(), results.cend(), [](const BenchResult& r){ return r.error.isEmpty(); });
+    if (parser.isSet(optionBaseline))
+        if (!compareWithBaseline(results, parser.value(optionBaseline), parser.value(optionThreshold).toDouble(), log))
+            return 2;
+    return ok ? 0 : 1;
+}
@@ -3,6 +3,8 @@
 
 #include "testing/OriTestBase.h"
 
+#include <QCoreApplication>
+
 // Access to private members of AdjusterWidget
 class AdjusterTester
 {
@@ -39,6 +41,7 @@ TEST_METHOD(must_raise_events_when_elem_param_chenged)
     AdjusterTester adjuster(&schema, e1->param("p1"));
     ASSERT_SCHEMA_STATE(STATE(New))
     adjuster.setValue(10);
+    QCoreApplication::processEvents(); // events are delivered on the next event loop turn
     ASSERT_SCHEMA_STATE(STATE(Modified))
     ASSERT_LISTENER_EVENTS(
         EVENT(ElemChanged),
@@ -64,15 +67,13 @@ TEST_METHOD(must_raise_events_when_custom_param_changed_1)
     ASSERT_SCHEMA_STATE(STATE(New))
     
     adjuster.setValue(10);
+    QCoreApplication::processEvents(); // events are delivered on the next event loop turn
     
     ASSERT_SCHEMA_STATE(STATE(Modified))
     ASSERT_LISTENER_EVENTS(
         EVENT(GlobalParamChanged),
-        EVENT(Changed),
-
         EVENT(ElemChanged),
         EVENT(Changed),
-
         EVENT(RecalRequred)
         )
 }
@@ -97,20 +98,36 @@ TEST_METHOD(must_raise_events_when_custom_param_changed_2)
     ASSERT_SCHEMA_STATE(STATE(New))
 
     adjuster.setValue(10);
+    QCoreApplication::processEvents(); // events are delivered on the next event loop turn
 
     ASSERT_SCHEMA_STATE(STATE(Modified))
     ASSERT_LISTENER_EVENTS(
         EVENT(GlobalParamChanged),
-        EVENT(Changed),
-
         EVENT(ElemChanged), // e1 changed
-        EVENT(Changed),
-
         EVENT(ElemChanged), // e2 changed
         EVENT(Changed),
+        EVENT(RecalRequred)
+        )
+}
 
+TEST_METHOD(must_coalesce_changes_made_in_one_event_loop_turn)
+{
+    SCHEMA_AND_LISTENER
+    auto e1 = new TestElement;
+    schema.insertElements({ e1 }, 0, Arg::RaiseEvents(false));
+    AdjusterTester adjuster(&schema, e1->param("p1"));
+    adjuster.setValue(10);
+    adjuster.setValue(20);
+    adjuster.setValue(30);
+    ASSERT_SCHEMA_STATE(STATE(Modified))
+    ASSERT_LISTENER_EVENTS()
+    QCoreApplication::processEvents();
+    ASSERT_LISTENER_EVENTS(
+        EVENT(ElemChanged),
+        EVENT(Changed),
         EVENT(RecalRequred)
         )
+    ASSERT_EQ_DBL(e1->param("p1")->value().value(), 30)
 }
 
 TEST_METHOD(must_be_disabled_when_param_is_linked_to_custom)
@@ -152,6 +169,7 @@ TEST_GROUP("Adjuster",
     ADD_GUI_TEST(must_raise_events_when_elem_param_chenged),
     ADD_GUI_TEST(must_raise_events_when_custom_param_changed_1),
     ADD_GUI_TEST(must_raise_events_when_custom_param_changed_2),
+    ADD_GUI_TEST(must_coalesce_changes_made_in_one_event_loop_turn),
     ADD_GUI_TEST(must_be_disabled_when_param_is_linked_to_custom),
     ADD_GUI_TEST(must_be_disabled_when_custom_param_is_driven_by_formula),
 )
@@ -0,0 +1,120 @@
+#include "../app/BatchRunner.h"
+#include "../tests/TestUtils.h"
+
+#include "testing/OriTestBase.h"
+
+#include <QJsonArray>
+
+namespace Z {
+namespace Tests {
+namespace BatchRunnerTests {
+
+#define ASSERT_NO_ERRORS(results) \
+    for (const auto& r : results) \
+        ASSERT_EQ_STR(r.error, "")
+
+TEST_METHOD(calcs_funcs_stored_in_file)
+{
+    TEST_FILE(fileName, "test_plot_funcs.rez")
+    BatchRunner runner({});
+    auto results = runner.processFile(fileName);
+    ASSERT_NO_ERRORS(results)
+    // StabMap and Caustic are supported, other stored functions are skipped
+    ASSERT_EQ_INT(results.size(), 2)
+    ASSERT_EQ_STR(results.at(0).funcAlias, "StabMap")
+    ASSERT_EQ_STR(results.at(1).funcAlias, "Caustic")
+    ASSERT_IS_TRUE(results.at(1).csv.startsWith("plane,segment,x,y\n"))
+    ASSERT_IS_FALSE(results.at(0).json["T"].toArray().isEmpty())
+}
+
+TEST_METHOD(overrides_args)
+{
+    TEST_FILE(fileName, "test_plot_funcs.rez")
+    BatchRunner runner({
+        .funcs = {"Caustic"},
+        .args = {{"mode", "BeamRadius"}, {"points", "5"}},
+    });
+    auto results = runner.processFile(fileName);
+    ASSERT_NO_ERRORS(results)
+    ASSERT_EQ_INT(results.size(), 1)
+    auto segmentsT = results.at(0).json["T"].toArray();
+    ASSERT_EQ_INT(segmentsT.size(), 1)
+    ASSERT_EQ_INT(segmentsT.first()["x"].toArray().size(), 5)
+}
+
+TEST_METHOD(overrides_args_of_several_funcs)
+{
+    TEST_FILE(fileName, "test_plot_funcs.rez")
+    // BeamParamsAtElems doesn't know `points` but it's not an error while other functions take it
+    BatchRunner runner({
+        .funcs = {"Caustic", "BeamParamsAtElems"},
+        .args = {{"points", "5"}},
+    });
+    auto results = runner.processFile(fileName);
+    ASSERT_NO_ERRORS(results)
+    ASSERT_EQ_INT(results.size(), 2)
+    ASSERT_EQ_STR(results.at(0).funcAlias, "Caustic")
+    ASSERT_EQ_INT(results.at(0).json["T"].toArray().first()["x"].toArray().size(), 5)
+
+    // Prefixed arguments are only for their function and override common ones
+    BatchRunner runner1({
+        .funcs = {"Caustic", "BeamParamsAtElems"},
+        .args = {{"points", "5"}, {"Caustic.points", "7"}, {"BeamParamsAtElems.calcSpaceMids", "true"}},
+    });
+    results = runner1.processFile(fileName);
+    ASSERT_NO_ERRORS(results)
+    ASSERT_EQ_INT(results.size(), 2)
+    ASSERT_EQ_INT(results.at(0).json["T"].toArray().first()["x"].toArray().size(), 7)
+
+    // Prefixed arguments must be known by the function
+    BatchRunner runner2({
+        .funcs = {"Caustic", "BeamParamsAtElems"},
+        .args = {{"BeamParamsAtElems.points", "5"}},
+    });
+    results = runner2.processFile(fileName);
+    ASSERT_EQ_INT(results.size(), 2)
+    ASSERT_EQ_STR(results.at(0).error, "")
+    ASSERT_EQ_STR(results.at(1).error, "Unknown arguments: points")
+}
+
+TEST_METHOD(calcs_funcs_not_stored_in_file)
+{
+    TEST_FILE(fileName, "test_plot_funcs.rez")
+    BatchRunner runner({ .funcs = {"BeamParamsAtElems"} });
+    auto results = runner.processFile(fileName);
+    ASSERT_NO_ERRORS(results)
+    ASSERT_EQ_INT(results.size(), 1)
+    ASSERT_IS_TRUE(results.at(0).csv.startsWith("element,position,"))
+    ASSERT_IS_FALSE(results.at(0).json["rows"].toArray().isEmpty())
+}
+
+TEST_METHOD(reports_invalid_args)
+{
+    TEST_FILE(fileName, "test_plot_funcs.rez")
+    BatchRunner runner({
+        .funcs = {"BeamParamsAtElems"},
+        .args = {{"mode", "BeamRadius"}},
+    });
+    auto results = runner.processFile(fileName);
+    ASSERT_EQ_INT(results.size(), 1)
+    ASSERT_EQ_STR(results.at(0).error, "Unknown arguments: mode")
+
+    BatchRunner runner1({ .params = {{"unknown", "1"}} });
+    results = runner1.processFile(fileName);
+    ASSERT_EQ_INT(results.size(), 1)
+    ASSERT_EQ_STR(results.at(0).error, "There is no global parameter 'unknown'")
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("BatchRunner",
+    ADD_TEST(calcs_funcs_stored_in_file),
+    ADD_TEST(overrides_args),
+    ADD_TEST(overrides_args_of_several_funcs),
+    ADD_TEST(calcs_funcs_not_stored_in_file),
+    ADD_TEST(reports_invalid_args),
+)
+
+} // namespace BatchRunnerTests
+} // namespace Tests
+} // namespace Z
@@ -17,6 +17,22 @@ DECLARE_ELEMENT(TestElement, Element)
         addParam(p);
     }
 DECLARE_ELEMENT_END
+
+class PositiveVerifier : public Z::ValueVerifier
+{
+public:
+    bool enabled() const override { return true; }
+    QString verify(const Z::Value& value) const override
+    {
+        return value.value() > 0 ? QString() : QStringLiteral("Must be positive");
+    }
+};
+
+struct FailureCounter : public Z::ParameterListener
+{
+    int count = 0;
+    void parameterFailed(Z::ParameterBase*) override { count++; }
+};
 }
 
 #define SCHEMA_AND_LISTENER_AND_ELEM \
@@ -184,6 +200,126 @@ TEST_METHOD(schema_not_modified_when_formula_parameter_changed_and_locked)
     }
 }
 
+TEST_METHOD(param_sweep_propagates_values_without_events)
+{
+    SCHEMA_AND_LISTENER_AND_ELEM
+
+    auto p0 = new Z::Parameter(Z::Dims::linear(), "p0");
+    auto p1 = new Z::Parameter(Z::Dims::linear(), "p1");
+    p1->setValue(1_m);
+
+    {
+        ElementEventsLocker locker(elem, "");
+        schema.addGlobalParam(p0);
+        schema.addGlobalParam(p1);
+        schema.addParamLink(p0, elem->params().byIndex(0));
+
+        auto f = new Z::Formula(p0);
+        f->setCode("p1*2");
+        f->addDep(p1);
+        schema.formulas()->put(f);
+    }
+
+    {
+        ParamSweep sweep(p1, "");
+        ASSERT_EQ_INT(sweep.elems().size(), 1)
+        ASSERT_IS_TRUE(sweep.elems().contains(elem))
+
+        int revision = elem->matrixRevision();
+        sweep.setValue(3_m);
+        ASSERT_EQ_DBL(p0->value().toSi(), 6)
+        ASSERT_EQ_DBL(elem->params().byIndex(0)->value().toSi(), 6)
+        ASSERT_IS_TRUE(elem->matrixRevision() > revision)
+        ASSERT_SCHEMA_STATE(STATE(New))
+        ASSERT_LISTENER_NO_EVENTS
+    }
+
+    // The original value is restored with usual notifications
+    ASSERT_EQ_DBL(p1->value().toSi(), 1)
+    ASSERT_EQ_DBL(elem->params().byIndex(0)->value().toSi(), 2)
+    ASSERT_LISTENER_EVENTS(
+        EVENT(GlobalParamChanged), // p1
+        EVENT(Changed),
+        EVENT(GlobalParamChanged), // p0
+        EVENT(Changed),
+        EVENT(ElemChanged),
+        EVENT(Changed))
+}
+
+TEST_METHOD(param_sweep_reports_link_errors_after_sweep)
+{
+    SCHEMA_AND_LISTENER_AND_ELEM
+
+    PositiveVerifier verifier;
+    auto target = elem->params().byIndex(0);
+    target->setVerifier(&verifier);
+
+    auto p0 = new Z::Parameter(Z::Dims::linear(), "p0");
+    p0->setValue(1_m);
+    {
+        ElementEventsLocker locker(elem, "");
+        schema.addGlobalParam(p0);
+        schema.addParamLink(p0, target);
+    }
+
+    FailureCounter failures;
+    target->addListener(&failures);
+
+    {
+        ParamSweep sweep(p0, "");
+
+        // Error is marked in the target but nobody is notified while the sweep goes
+        sweep.setValue(-1_m);
+        ASSERT_IS_TRUE(target->failed())
+        ASSERT_EQ_INT(failures.count, 0)
+        ASSERT_LISTENER_NO_EVENTS
+        ASSERT_EQ_INT(sweep.errors().size(), 1)
+        ASSERT_IS_TRUE(sweep.errors().contains(target))
+
+        // Next good value clears the error mark, but the error is still collected
+        sweep.setValue(2_m);
+        ASSERT_IS_FALSE(target->failed())
+        ASSERT_EQ_DBL(target->value().toSi(), 2)
+        ASSERT_EQ_INT(failures.count, 0)
+        ASSERT_EQ_INT(sweep.errors().size(), 1)
+    }
+
+    // The original value is valid, so the target is not failed after the sweep
+    ASSERT_IS_FALSE(target->failed())
+    ASSERT_EQ_DBL(target->value().toSi(), 1)
+    ASSERT_EQ_INT(failures.count, 0)
+
+    target->removeListener(&failures);
+    target->setVerifier(nullptr);
+}
+
+TEST_METHOD(param_sweep_respects_matrix_lock)
+{
+    SCHEMA_AND_LISTENER_AND_ELEM
+
+    auto p0 = new Z::Parameter(Z::Dims::linear(), "p0");
+    p0->setValue(1_m);
+    {
+        ElementEventsLocker locker(elem, "");
+        schema.addGlobalParam(p0);
+        schema.addParamLink(p0, elem->params().byIndex(0));
+    }
+
+    int revision = elem->matrixRevision();
+    {
+        ElementMatrixLocker matrixLocker(elem, "");
+        {
+            ParamSweep sweep(p0, "");
+            sweep.setValue(2_m);
+            sweep.setValue(3_m);
+            ASSERT_EQ_INT(elem->matrixRevision(), revision)
+        }
+        ASSERT_EQ_INT(elem->matrixRevision(), revision)
+    }
+    // Matrix is recalculated once when the lock is released
+    ASSERT_EQ_INT(elem->matrixRevision(), revision + 1)
+}
+
 //------------------------------------------------------------------------------
 
 TEST_GROUP("ElementEventsLocker",
@@ -195,6 +331,9 @@ TEST_GROUP("ElementEventsLocker",
     ADD_TEST(schema_not_modified_when_linked_parameter_changed_and_locked),
     ADD_TEST(schema_modified_when_formula_parameter_changed_and_not_locked),
     ADD_TEST(schema_not_modified_when_formula_parameter_changed_and_locked),
+    ADD_TEST(param_sweep_propagates_values_without_events),
+    ADD_TEST(param_sweep_reports_link_errors_after_sweep),
+    ADD_TEST(param_sweep_respects_matrix_lock),
 )
 
 } // namespace ElementEventsLockerTests
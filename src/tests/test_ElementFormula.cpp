@@ -84,6 +84,24 @@ TEST_METHOD(can_calculate_matrix_ts)
     ASSERT_MATRIX(s, 10, 20, 30, 40)
 }
 
+TEST_METHOD(can_recalculate_matrix)
+{
+    ElemFormula elem;
+
+    ADD_PARAM(a, 1)
+
+    elem.setHasMatricesTS(false);
+    CALC_TEST_MATRIX("A=a; B=2*a; C=3*a; D=4*a;")
+    ASSERT_MATRIX(t, 1, 2, 3, 4)
+
+    p_a->setValue(2);
+    elem.calcMatrix("test");
+    ASSERT_MATRIX(t, 2, 4, 6, 8)
+
+    CALC_TEST_MATRIX("A=-a; B=-2*a; C=-3*a; D=-4*a;")
+    ASSERT_MATRIX(t, -2, -4, -6, -8)
+}
+
 TEST_METHOD(matrix_must_be_unity_when_empty_formula)
 {
     ElemFormula elem;
@@ -265,6 +283,7 @@ TEST_METHOD(assign__must_destruct_old_params)
 TEST_GROUP("ElementFormula",
            ADD_TEST(can_calculate_matrix),
            ADD_TEST(can_calculate_matrix_ts),
+           ADD_TEST(can_recalculate_matrix),
            ADD_TEST(matrix_must_be_unity_when_empty_formula),
            ADD_TEST(matrix_must_be_unity_when_invalid_formula),
            ADD_TEST(matrix_must_be_unity_when_no_a),
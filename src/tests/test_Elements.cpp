@@ -935,6 +935,110 @@ TEST_METHOD(AxiconLens)
 
 //------------------------------------------------------------------------------
 
+TEST_METHOD(matrix_kernels)
+{
+    for (auto sample : ElementsCatalog::instance().elements())
+    {
+        QSharedPointer<Element> elem(ElementsCatalog::instance().create(sample->type()));
+        auto kernel = elem->matrixKernel();
+        if (dynamic_cast<ElementDynamic*>(elem.data()))
+        {
+            ASSERT_IS_FALSE(kernel.isValid())
+            continue;
+        }
+        ASSERT_IS_TRUE(kernel.isValid())
+
+        auto range = Z::Utils::asRange(elem.data());
+        ASSERT_IS_TRUE(bool(range) == bool(kernel.calcSubmatrices))
+    }
+}
+
+#define ASSERT_KERNEL_MATRIX(m, a, b, c, d)\
+    ASSERT_NEAR_DBL(m.A.real(), a, 1e-7)\
+    ASSERT_NEAR_DBL(m.B.real(), b, 1e-7)\
+    ASSERT_NEAR_DBL(m.C.real(), c, 1e-7)\
+    ASSERT_NEAR_DBL(m.D.real(), d, 1e-7)
+
+// Kernels are checked against the same reference values as elements themselves.
+// Calculation: $PROJECT/calc/Elements.py
+TEST_METHOD(matrix_kernels_Plate)
+{
+    const double p[] = { 0.088, 1.2 };
+    Z::KernelMatrices m;
+    ElemPlate::calcMatrixKernel(p, m);
+    ASSERT_KERNEL_MATRIX(m.mt, 1.0000000, 0.0733333, 0.0000000, 1.0000000)
+    ASSERT_KERNEL_MATRIX(m.ms, 1.0000000, 0.0733333, 0.0000000, 1.0000000)
+    ASSERT_KERNEL_MATRIX(m.mt_inv, 1.0000000, 0.0733333, 0.0000000, 1.0000000)
+    ASSERT_KERNEL_MATRIX(m.ms_inv, 1.0000000, 0.0733333, 0.0000000, 1.0000000)
+
+    ElemPlate::calcSubmatricesKernel(p, 0.0176, m);
+    ASSERT_KERNEL_MATRIX(m.mt1, 1.0000000, 0.0146667, 0.0000000, 0.8333333)
+    ASSERT_KERNEL_MATRIX(m.ms1, 1.0000000, 0.0146667, 0.0000000, 0.8333333)
+    ASSERT_KERNEL_MATRIX(m.mt2, 1.0000000, 0.0704000, 0.0000000, 1.2000000)
+    ASSERT_KERNEL_MATRIX(m.ms2, 1.0000000, 0.0704000, 0.0000000, 1.2000000)
+}
+
+TEST_METHOD(matrix_kernels_CurveMirror)
+{
+    const double p[] = { 0.1, 0.2617994 };
+    Z::KernelMatrices m;
+    ElemCurveMirror::calcMatrixKernel(p, m);
+    ASSERT_KERNEL_MATRIX(m.mt, 1, 0, -20.7055236, 1)
+    ASSERT_KERNEL_MATRIX(m.ms, 1, 0, -19.3185165, 1)
+    ASSERT_KERNEL_MATRIX(m.mt_inv, 1, 0, -20.7055236, 1)
+    ASSERT_KERNEL_MATRIX(m.ms_inv, 1, 0, -19.3185165, 1)
+}
+
+TEST_METHOD(matrix_kernels_ThermoLens)
+{
+    const double p[] = { 0.1, 1.7, 1.5 };
+    Z::KernelMatrices m;
+    ElemThermoLens::calcMatrixKernel(p, m);
+    ASSERT_KERNEL_MATRIX(m.mt, 0.9807082, 0.0584448, -0.6538055, 0.9807082)
+    ASSERT_KERNEL_MATRIX(m.ms, 0.9807082, 0.0584448, -0.6538055, 0.9807082)
+    ASSERT_IS_TRUE(m.derived.has_value())
+    ASSERT_NEAR_DBL(*m.derived, 6.580425421766774, 1e-7)
+
+    ElemThermoLens::calcSubmatricesKernel(p, 0.03, m);
+    ASSERT_KERNEL_MATRIX(m.mt1, 0.9982586, 0.0176368, -0.1160577, 0.5872110)
+    ASSERT_KERNEL_MATRIX(m.ms1, 0.9982586, 0.0176368, -0.1160577, 0.5872110)
+    ASSERT_KERNEL_MATRIX(m.mt2, 0.9905314, 0.0697789, -0.4591750, 1.6839034)
+    ASSERT_KERNEL_MATRIX(m.ms2, 0.9905314, 0.0697789, -0.4591750, 1.6839034)
+
+    // Sub-range kernel solves the gradient only when it's not known yet
+    Z::KernelMatrices m1;
+    ElemThermoLens::calcSubmatricesKernel(p, 0.03, m1);
+    ASSERT_IS_TRUE(m1.derived.has_value())
+    ASSERT_NEAR_DBL(*m1.derived, 6.580425421766774, 1e-7)
+    ASSERT_KERNEL_MATRIX(m1.mt1, 0.9982586, 0.0176368, -0.1160577, 0.5872110)
+
+    // and it uses the known value without solving,
+    // here it's the gradient for F = -1.5m while parameters still have F = 1.5m
+    Z::KernelMatrices m2;
+    m2.derived = -6.754730954420761;
+    ElemThermoLens::calcSubmatricesKernel(p, 0.03, m2);
+    ASSERT_KERNEL_MATRIX(m2.mt1, 1.0017885, 0.0176576, 0.1192722, 0.5892874)
+    ASSERT_KERNEL_MATRIX(m2.mt2, 1.0097506, 0.0702274, 0.4743670, 1.7165760)
+}
+
+TEST_METHOD(matrix_kernels_ThermoMedium)
+{
+    const double p[] = { 0.1, 1.7, 1.5 };
+    Z::KernelMatrices m;
+    ElemThermoMedium::calcMatrixKernel(p, m);
+    ASSERT_KERNEL_MATRIX(m.mt, 0.9807082, 0.0993561, -0.3845914, 0.9807082)
+    ASSERT_KERNEL_MATRIX(m.ms, 0.9807082, 0.0993561, -0.3845914, 0.9807082)
+    ASSERT_IS_TRUE(m.derived.has_value())
+
+    ElemThermoMedium::calcSubmatricesKernel(p, 0.03, m);
+    ASSERT_KERNEL_MATRIX(m.mt1, 0.9982586, 0.0299826, -0.1160577, 0.9982586)
+    ASSERT_KERNEL_MATRIX(m.ms1, 0.9982586, 0.0299826, -0.1160577, 0.9982586)
+    ASSERT_KERNEL_MATRIX(m.mt2, 0.9905314, 0.0697789, -0.2701030, 0.9905314)
+    ASSERT_KERNEL_MATRIX(m.ms2, 0.9905314, 0.0697789, -0.2701030, 0.9905314)
+}
+
+//------------------------------------------------------------------------------
+
 TEST_GROUP("Elements",
            ADD_TEST(EmptyRange),
            ADD_TEST(MediumRange),
@@ -974,6 +1078,11 @@ TEST_GROUP("Elements",
            ADD_TEST(SphericalInterface_flip),
            ADD_TEST(AxiconMirror),
            ADD_TEST(AxiconLens),
+           ADD_TEST(matrix_kernels),
+           ADD_TEST(matrix_kernels_Plate),
+           ADD_TEST(matrix_kernels_CurveMirror),
+           ADD_TEST(matrix_kernels_ThermoLens),
+           ADD_TEST(matrix_kernels_ThermoMedium),
            )
 
 } // namespace ElementsTests
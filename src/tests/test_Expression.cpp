@@ -0,0 +1,105 @@
+#include "../core/Expression.h"
+#include "../core/LuaHelper.h"
+
+#include "testing/OriTestBase.h"
+
+namespace Z {
+namespace Tests {
+namespace ExpressionTests {
+
+#define ASSERT_SAME_AS_LUA(code) { \
+    TEST_LOG(code) \
+    Z::Expression expr; \
+    ASSERT_IS_TRUE(expr.compile(code, vars)) \
+    auto res = lua.calculate(code); \
+    ASSERT_IS_TRUE(res.ok()) \
+    ASSERT_NEAR_DBL(expr.eval(), res.value(), 1e-15) \
+}
+
+#define ASSERT_NOT_COMPILED(code) { \
+    TEST_LOG(code) \
+    Z::Expression expr; \
+    ASSERT_IS_FALSE(expr.compile(code, vars)) \
+    ASSERT_IS_FALSE(expr.isValid()) \
+}
+
+TEST_METHOD(gives_same_results_as_lua)
+{
+    double a = 2, b = 3, L1 = 0.1;
+    QMap<QString, const double*> vars {{"a", &a}, {"b", &b}, {"L1", &L1}};
+
+    Z::Lua lua;
+    ASSERT_EQ_STR(lua.open(), "")
+    lua.setGlobalVar("a", a);
+    lua.setGlobalVar("b", b);
+    lua.setGlobalVar("L1", L1);
+
+    ASSERT_SAME_AS_LUA("1 + 2 * 3")
+    ASSERT_SAME_AS_LUA("(1 + 2) * 3")
+    ASSERT_SAME_AS_LUA("a - b - 1")
+    ASSERT_SAME_AS_LUA("a / b / 2")
+    ASSERT_SAME_AS_LUA("L1*2 + a/b")
+    ASSERT_SAME_AS_LUA("-a^2")
+    ASSERT_SAME_AS_LUA("a^b^2")
+    ASSERT_SAME_AS_LUA("a^-b")
+    ASSERT_SAME_AS_LUA("- -a * -b")
+    ASSERT_SAME_AS_LUA("2^-b^2")
+    ASSERT_SAME_AS_LUA(".5e1 + 1.5e-1 + 3E2")
+    ASSERT_SAME_AS_LUA("sin(a) + sqrt(b) * ln(L1) - abs(-a)")
+    ASSERT_SAME_AS_LUA("cot(a) + acot(b) + floor(-L1) + ceil(L1)")
+    ASSERT_SAME_AS_LUA("deg2rad(rad2deg(pi())) + lg(100)")
+}
+
+TEST_METHOD(uses_bound_variables)
+{
+    double a = 2;
+    QMap<QString, const double*> vars {{"a", &a}};
+
+    Z::Expression expr;
+    ASSERT_IS_TRUE(expr.compile("a*a + 1", vars))
+    ASSERT_EQ_DBL(expr.eval(), 5)
+    a = 3;
+    ASSERT_EQ_DBL(expr.eval(), 10)
+
+    ASSERT_IS_TRUE(expr.compile("-inf / a", vars))
+    ASSERT_IS_TRUE(qIsInf(expr.eval()))
+    ASSERT_IS_TRUE(expr.eval() < 0)
+}
+
+TEST_METHOD(does_not_compile_unsupported_code)
+{
+    double a = 2, sin = 1;
+    QMap<QString, const double*> vars {{"a", &a}, {"sin", &sin}};
+
+    ASSERT_NOT_COMPILED("")
+    ASSERT_NOT_COMPILED("a +")
+    ASSERT_NOT_COMPILED("(a + 1")
+    ASSERT_NOT_COMPILED("a % 2")
+    ASSERT_NOT_COMPILED("a // 2")
+    ASSERT_NOT_COMPILED("a--1")
+    ASSERT_NOT_COMPILED("+a")
+    ASSERT_NOT_COMPILED("ans = a")
+    ASSERT_NOT_COMPILED("b = a; ans = b*2")
+    ASSERT_NOT_COMPILED("a > 1 and 1 or 0")
+    ASSERT_NOT_COMPILED("unknown + 1")
+    ASSERT_NOT_COMPILED("unknown(a)")
+    ASSERT_NOT_COMPILED("sin(a)")
+    ASSERT_NOT_COMPILED("cos(a, 1)")
+    ASSERT_NOT_COMPILED("pi")
+    ASSERT_NOT_COMPILED("0x10")
+    ASSERT_NOT_COMPILED("2a")
+    ASSERT_NOT_COMPILED("1.2.3")
+    ASSERT_NOT_COMPILED("1e")
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("Expression",
+    ADD_TEST(gives_same_results_as_lua),
+    ADD_TEST(uses_bound_variables),
+    ADD_TEST(does_not_compile_unsupported_code),
+)
+
+} // namespace ExpressionTests
+} // namespace Tests
+} // namespace Z
@@ -55,6 +55,39 @@ TEST_METHOD(calculate_with_deps)
     ASSERT_EQ_DBL(tgt.value().value(), 7);
 }
 
+TEST_METHOD(calculate_native_or_lua)
+{
+    Z::Parameter tgt;
+    Z::Parameter dep1(Z::Dims::none(), "p1");
+    Z::Parameter dep2(Z::Dims::none(), "p2");
+    dep1.setValue(2);
+    dep2.setValue(3);
+
+    Z::Formula f(&tgt);
+    f.addDep(&dep1);
+    f.setCode("p1*2 + 1");
+    ASSERT_IS_TRUE(f.isNative())
+    f.calculate();
+    ASSERT_IS_TRUE(f.ok())
+    ASSERT_EQ_DBL(tgt.value().value(), 5)
+
+    dep1.setValue(3);
+    ASSERT_EQ_DBL(tgt.value().value(), 7)
+
+    // Dependencies are rebound when changed
+    f.setCode("p1*p2");
+    f.addDep(&dep2);
+    ASSERT_IS_TRUE(f.isNative())
+    f.calculate();
+    ASSERT_EQ_DBL(tgt.value().value(), 9)
+
+    f.setCode("x = p1*p2; ans = x + 1");
+    ASSERT_IS_FALSE(f.isNative())
+    f.calculate();
+    ASSERT_IS_TRUE(f.ok())
+    ASSERT_EQ_DBL(tgt.value().value(), 10)
+}
+
 TEST_METHOD(destructor_must_unlisten_deps)
 {
     Z::Parameter tgt;
@@ -331,12 +364,78 @@ TEST_METHOD(Formulas_dependsOn)
     ASSERT_IS_FALSE(fs.dependsOn(&d1_0, tgt.alias()))
 }
 
+namespace {
+struct ChangesCounter : public ParameterListener
+{
+    int count = 0;
+    void parameterChanged(ParameterBase*) override { count++; }
+};
+}
+
+//           +-- q <-- f1 <--+
+// s <-- f3 -|               |-- p
+//           +-- r <-- f2 <--+
+#define DIAMOND_FORMULAS \
+    Parameter p(Z::Dims::none(), "p"), q(Z::Dims::none(), "q"), \
+              r(Z::Dims::none(), "r"), s(Z::Dims::none(), "s"); \
+    Formula f1(&q); f1.setCode("p*2"); f1.addDep(&p); \
+    Formula f2(&r); f2.setCode("p*3"); f2.addDep(&p); \
+    Formula f3(&s); f3.setCode("q+r"); f3.addDep(&q); f3.addDep(&r); \
+    Formulas fs; fs.put(&f3); fs.put(&f2); fs.put(&f1);
+
+TEST_METHOD(Formulas_dependentFormulas)
+{
+    DIAMOND_FORMULAS
+
+    auto formulas = fs.dependentFormulas(&p);
+    ASSERT_EQ_INT(formulas.size(), 3)
+    ASSERT_IS_TRUE(formulas.last() == &f3)
+
+    formulas = fs.dependentFormulas(&q);
+    ASSERT_EQ_INT(formulas.size(), 1)
+    ASSERT_IS_TRUE(formulas.first() == &f3)
+
+    formulas = fs.dependentFormulas(&s);
+    ASSERT_IS_TRUE(formulas.isEmpty())
+
+    f3.removeDep(&q);
+    f3.removeDep(&r);
+    formulas = fs.dependentFormulas(&p);
+    ASSERT_EQ_INT(formulas.size(), 2)
+    ASSERT_IS_FALSE(formulas.contains(&f3))
+}
+
+TEST_METHOD(Formulas_calculate_each_formula_once)
+{
+    DIAMOND_FORMULAS
+
+    ChangesCounter counter;
+    s.addListener(&counter);
+
+    p.setValue(1);
+    ASSERT_EQ_DBL(q.value().value(), 2)
+    ASSERT_EQ_DBL(r.value().value(), 3)
+    ASSERT_EQ_DBL(s.value().value(), 5)
+    ASSERT_EQ_INT(counter.count, 1)
+
+    p.setValue(2);
+    ASSERT_EQ_DBL(s.value().value(), 10)
+    ASSERT_EQ_INT(counter.count, 2)
+
+    q.setValue(1);
+    ASSERT_EQ_DBL(s.value().value(), 7)
+    ASSERT_EQ_INT(counter.count, 3)
+
+    s.removeListener(&counter);
+}
+
 //------------------------------------------------------------------------------
 
 TEST_GROUP("Formula",
     ADD_TEST(isValidVariableName),
     ADD_TEST(calculate),
     ADD_TEST(calculate_with_deps),
+    ADD_TEST(calculate_native_or_lua),
     ADD_TEST(destructor_must_unlisten_deps),
     ADD_TEST(calculate_with_units),
     ADD_TEST(calculate_sets_error_when_empty),
@@ -361,6 +460,8 @@ TEST_GROUP("Formula",
     ADD_TEST(Formulas_dependentParams),
     ADD_TEST(Formulas_dependentParams_only_first_level),
     ADD_TEST(Formulas_dependsOn),
+    ADD_TEST(Formulas_dependentFormulas),
+    ADD_TEST(Formulas_calculate_each_formula_once),
 )
 
 } // namespace FormulaTests
@@ -142,19 +142,42 @@ TEST_METHOD(can_set_several_globals_after_code)
     ASSERT_LUA_EXEC(lua, "c", 7)
 }
 
-// TODO: read lua docs carefully and find out if is possible
-// to compile the code once and run it many times with different values
 TEST_METHOD(can_change_globals_with_the_same_code)
 {
     OPEN_LUA(lua)
 
-    lua.setCode("res=var1^2");
+    auto code = lua.compile("res=var1^2");
+    ASSERT_IS_TRUE(code.ok())
+    int var1 = lua.nameRef("var1");
+    int res = lua.nameRef("res");
 
-    lua.setGlobalVar("var1", 5);
-    ASSERT_LUA_EXEC(lua, "res", 25)
+    lua.setGlobalVar(var1, 5);
+    ASSERT_EQ_STR(lua.run(code.value()), "")
+    ASSERT_EQ_DBL(*lua.getGlobalVar(res), 25)
+
+    lua.setGlobalVar(var1, 6);
+    ASSERT_EQ_STR(lua.run(code.value()), "")
+    ASSERT_EQ_DBL(*lua.getGlobalVar(res), 36)
+
+    lua.release(code.value());
+}
+
+TEST_METHOD(compiled_code_errors)
+{
+    OPEN_LUA(lua)
+
+    auto code1 = lua.compile("res=var1^");
+    ASSERT_IS_FALSE(code1.ok())
+    TEST_LOG(code1.error())
+
+    auto code2 = lua.compile("res=var1^2");
+    ASSERT_IS_TRUE(code2.ok())
+    ASSERT_EQ_STR(lua.run(code2.value()), "Unknown variable 'var1'")
+    ASSERT_IS_FALSE(lua.getGlobalVar(lua.nameRef("res")).has_value())
 
-    lua.setGlobalVar("var1", 6);
-    ASSERT_LUA_EXEC(lua, "res", 36)
+    lua.setGlobalVar("var1", 3);
+    ASSERT_EQ_STR(lua.run(code2.value()), "")
+    ASSERT_EQ_DBL(*lua.getGlobalVar(lua.nameRef("res")), 9)
 }
 
 TEST_METHOD(can_reuse_globals_with_different_code)
@@ -220,7 +243,8 @@ TEST_GROUP("LuaHelper",
     ADD_TEST(can_set_one_global_after_code),
     ADD_TEST(can_set_several_globals_before_code),
     ADD_TEST(can_set_several_globals_after_code),
-    //ADD_TEST(can_change_globals_with_the_same_code),
+    ADD_TEST(can_change_globals_with_the_same_code),
+    ADD_TEST(compiled_code_errors),
     ADD_TEST(can_reuse_globals_with_different_code),
     ADD_TEST(can_calc_several_values),
     ADD_TEST(can_remove_global),
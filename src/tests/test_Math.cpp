@@ -73,6 +73,24 @@ TEST_METHOD(Matrix_multComplexBeam)
     ASSERT_NEAR_DBL(c2.imag(), -0.0095012, 1e-7)
 }
 
+TEST_METHOD(MatrixReal_multiply)
+{
+    Z::Matrix m1(5, 6, 7, 8);
+    Z::Matrix m2(Z::Complex(1, 0.1), 2, 3, Z::Complex(4, 0.2));
+
+    Z::MatrixReal m;
+    m *= &m1;
+    m *= &m2;
+    ASSERT_EQ_DBL(m.A, 23)
+    ASSERT_EQ_DBL(m.B, 34)
+    ASSERT_EQ_DBL(m.C, 31)
+    ASSERT_EQ_DBL(m.D, 46)
+
+    Z::Matrix m3;
+    Z::multMatrixArrayReal({&m2, &m1}, m3);
+    ASSERT_MATRIX_IS(m3, 19, 22, 43, 50)
+}
+
 //------------------------------------------------------------------------------
 
 #define ASSERT_VECTOR(vector, y, v)\
@@ -115,6 +133,7 @@ TEST_GROUP("Math",
     ADD_TEST(Matrix_multiply),
     ADD_TEST(Matrix_multiply_static),
     ADD_TEST(Matrix_multComplexBeam),
+    ADD_TEST(MatrixReal_multiply),
     ADD_TEST(RayVector_constructors),
     ADD_TEST(RayVector_set)
 )
@@ -0,0 +1,128 @@
+#include "../core/Perf.h"
+
+#include "testing/OriTestBase.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QTemporaryDir>
+
+#include <thread>
+
+namespace Z {
+namespace Tests {
+namespace PerfTests {
+
+TEST_METHOD(does_not_record_when_disabled)
+{
+    Z::Perf::setEnabled(false);
+    Z::Perf::clearTrace();
+    Z_PERF_BEGIN("block")
+    Z_PERF_END
+    ASSERT_EQ_INT(Z::Perf::traceSize(), 0)
+}
+
+TEST_METHOD(records_blocks_in_threads)
+{
+    Z::Perf::clearTrace();
+    Z::Perf::setEnabled(true);
+    Z_PERF_BEGIN("outer")
+    Z_PERF_BEGIN("inner")
+    Z_PERF_END
+    std::thread worker([]{
+        // Not closed block in another thread doesn't break the main thread stack
+        Z_PERF_BEGIN("worker")
+        Z_PERF_BEGIN("worker_inner")
+        Z_PERF_END
+    });
+    worker.join();
+    Z_PERF_END
+    Z_PERF_END // extra end is ignored
+    Z::Perf::setEnabled(false);
+    ASSERT_EQ_INT(Z::Perf::traceSize(), 3)
+
+    QTemporaryDir dir;
+    ASSERT_IS_TRUE(dir.isValid())
+    QString fileName = dir.filePath("trace.json");
+    ASSERT_EQ_STR(Z::Perf::saveTrace(fileName), "")
+
+    QFile file(fileName);
+    ASSERT_IS_TRUE(file.open(QIODevice::ReadOnly))
+    auto events = QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+    QMap<QString, QJsonObject> blocks;
+    for (const auto& it : std::as_const(events))
+    {
+        auto event = it.toObject();
+        if (event["ph"].toString() == "X")
+            blocks[event["name"].toString()] = event;
+    }
+    ASSERT_EQ_INT(blocks.size(), 3)
+    auto outer = blocks["outer"];
+    auto inner = blocks["inner"];
+    auto worker_inner = blocks["worker_inner"];
+    ASSERT_EQ_INT(outer["tid"].toInt(), inner["tid"].toInt())
+    ASSERT_IS_TRUE(outer["tid"].toInt() != worker_inner["tid"].toInt())
+    ASSERT_IS_TRUE(outer["ts"].toDouble() <= inner["ts"].toDouble())
+    ASSERT_IS_TRUE(outer["dur"].toDouble() >= inner["dur"].toDouble())
+    ASSERT_IS_TRUE(outer["dur"].toDouble() >= worker_inner["dur"].toDouble())
+
+    Z::Perf::clearTrace();
+}
+
+static QSet<int> savedThreadIds(const QString &fileName)
+{
+    QSet<int> ids;
+    if (!Z::Perf::saveTrace(fileName).isEmpty())
+        return ids;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return ids;
+    auto events = QJsonDocument::fromJson(file.readAll()).object()["traceEvents"].toArray();
+    for (const auto& it : std::as_const(events))
+    {
+        auto event = it.toObject();
+        if (event["ph"].toString() == "M")
+            ids << event["tid"].toInt();
+    }
+    return ids;
+}
+
+TEST_METHOD(clear_releases_finished_threads)
+{
+    QTemporaryDir dir;
+    ASSERT_IS_TRUE(dir.isValid())
+    QString fileName = dir.filePath("trace.json");
+
+    Z::Perf::clearTrace();
+    auto idsBefore = savedThreadIds(fileName);
+
+    Z::Perf::setEnabled(true);
+    std::thread worker([]{
+        Z_PERF_BEGIN("worker")
+        Z_PERF_END
+    });
+    worker.join();
+    Z::Perf::setEnabled(false);
+
+    // Events of a finished thread are still saved
+    auto idsRecorded = savedThreadIds(fileName);
+    ASSERT_EQ_INT(idsRecorded.size(), idsBefore.size() + 1)
+
+    Z::Perf::clearTrace();
+    auto idsCleared = savedThreadIds(fileName);
+    ASSERT_IS_TRUE(idsCleared == idsBefore)
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("Perf",
+    ADD_TEST(does_not_record_when_disabled),
+    ADD_TEST(records_blocks_in_threads),
+    ADD_TEST(clear_releases_finished_threads),
+)
+
+} // namespace PerfTests
+} // namespace Tests
+} // namespace Z
@@ -0,0 +1,79 @@
+#include "../core/Schema.h"
+#include "../funcs/PlotFuncWindow.h"
+#include "../math/PlotFunction.h"
+
+#include "testing/OriTestBase.h"
+
+namespace Z {
+namespace Tests {
+namespace PlotFuncWindowTests {
+
+namespace {
+DECLARE_ELEMENT(TestElement, Element)
+DECLARE_ELEMENT_END
+
+class TestFunction : public PlotFunction
+{
+public:
+    TestFunction(Schema *schema, Element *dependency) : PlotFunction(schema), _dependency(dependency) {}
+
+    QString name() const override { return "Test function"; }
+
+    void calculate(CalculationMode) override
+    {
+        calcCount++;
+        setError(fail ? QString("Test error") : QString());
+    }
+
+    std::optional<PlotFuncDeps> dependencyCone() const override
+    {
+        return PlotFuncDeps { .elems = { _dependency } };
+    }
+
+    int calcCount = 0;
+    bool fail = false;
+
+private:
+    Element *_dependency;
+};
+}
+
+TEST_METHOD(recalcs_on_any_change_after_failure)
+{
+    Schema schema;
+    auto e1 = new TestElement;
+    auto e2 = new TestElement;
+    schema.insertElements({e1, e2}, 0, Arg::RaiseEvents(false));
+
+    auto func = new TestFunction(&schema, e1);
+    PlotFuncWindow wnd(func);
+    wnd.update();
+    ASSERT_EQ_INT(func->calcCount, 1)
+
+    // Elements outside of the cone don't make the function recalculate
+    schema.events().raise(SchemaEvents::ElemChanged, e2, "test: out of cone");
+    schema.events().raise(SchemaEvents::RecalRequred, "test: out of cone");
+    ASSERT_EQ_INT(func->calcCount, 1)
+
+    func->fail = true;
+    wnd.update();
+    ASSERT_EQ_INT(func->calcCount, 2)
+    ASSERT_IS_FALSE(func->ok())
+
+    // Dependencies of failed calculation are unknown, so any change can fix it
+    func->fail = false;
+    schema.events().raise(SchemaEvents::ElemChanged, e2, "test: after failure");
+    schema.events().raise(SchemaEvents::RecalRequred, "test: after failure");
+    ASSERT_EQ_INT(func->calcCount, 3)
+    ASSERT_IS_TRUE(func->ok())
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("PlotFuncWindow",
+    ADD_GUI_TEST(recalcs_on_any_change_after_failure),
+)
+
+} // namespace PlotFuncWindowTests
+} // namespace Tests
+} // namespace Z
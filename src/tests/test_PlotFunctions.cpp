@@ -7,6 +7,8 @@
 #include "../math/BeamVariationFunction.h"
 #include "../math/MultirangeCausticFunction.h"
 #include "../math/MultibeamCausticFunction.h"
+#include "../math/PlotFuncRoundTripFunction.h"
+#include "../math/RoundTripCalculator.h"
 #include "../tests/TestUtils.h"
 
 #include "testing/OriTestBase.h"
@@ -200,6 +202,22 @@ TEST_METHOD(calculateAt)
     ASSERT_NEAR_TS(func.calculateAt(7_cm), -820.10025, -591.667213, 1e-6)
 }
 
+TEST_METHOD(findStabilityBounds)
+{
+    TEST_STAB_MAP_FUNC(Z::Enums::StabilityCalcMode::Squared)
+    for (auto ts : {Z::T, Z::S})
+    {
+        auto bounds = func.findStabilityBounds(ts);
+        ASSERT_EQ_INT(bounds.size(), 1)
+        auto b = bounds.first();
+        ASSERT_IS_TRUE(b.start > 0.052 && b.start < 0.056)
+        ASSERT_IS_TRUE(b.stop > 0.056 && b.stop < 0.06)
+        // Bounds must be refined up to the precision of stability parameter itself
+        ASSERT_NEAR_DBL(func.calculateAt(Z::Value(b.start, Z::Units::m()))[ts], 0, 1e-9)
+        ASSERT_NEAR_DBL(func.calculateAt(Z::Value(b.stop, Z::Units::m()))[ts], 0, 1e-9)
+    }
+}
+
 TEST_METHOD(calculate_with_global_param)
 {
     TEST_SCHEMA(TripType::SW)
@@ -257,6 +275,7 @@ TEST_GROUP("StabilityMapFunction",
            ADD_TEST(calculate_normal),
            ADD_TEST(calculate_squared),
            ADD_TEST(calculateAt),
+           ADD_TEST(findStabilityBounds),
            ADD_TEST(calculate_with_global_param),
            ADD_TEST(calculate_with_global_param_formula),
            )
@@ -415,12 +434,140 @@ TEST_METHOD(calculate_with_global_param_formula)
     ASSERT_STAB_MAP_2D_NORMAL
 }
 
+TEST_METHOD(calculate_in_job)
+{
+    TEST_SCHEMA(TripType::SW)
+    StabilityMap2DFunction func(s.schema);
+    func.setStabilityCalcMode(Z::Enums::StabilityCalcMode::Normal);
+    func.paramX()->element = s.elem_L_foc;
+    func.paramX()->parameter = s.elem_L_foc->paramLength();
+    func.paramX()->range = Z::VariableRange::withPoints(0_mm, 100_mm, 10);
+    func.paramY()->element = s.elem_L;
+    func.paramY()->parameter = s.elem_L->paramLength();
+    func.paramY()->range = Z::VariableRange::withPoints(0_mm, 500_mm, 10);
+
+    auto job = func.prepareJob();
+    ASSERT_IS_TRUE(job != nullptr)
+    // Results are not touched until the job is applied
+    ASSERT_IS_TRUE(func.resultsT().isEmpty())
+
+    job->run();
+    func.applyJob(job.get());
+    ASSERT_FUNC_OK
+    ASSERT_EQ_INT(func.rangeX().points(), 10)
+    ASSERT_STAB_MAP_2D_NORMAL
+}
+
+TEST_METHOD(calculate_adaptive)
+{
+    TEST_SCHEMA(TripType::SW)
+    StabilityMap2DFunction func(s.schema);
+    func.setStabilityCalcMode(Z::Enums::StabilityCalcMode::Normal);
+    func.paramX()->element = s.elem_L_foc;
+    func.paramX()->parameter = s.elem_L_foc->paramLength();
+    func.paramX()->range = Z::VariableRange::withPoints(0_mm, 100_mm, 129);
+    func.paramY()->element = s.elem_L;
+    func.paramY()->parameter = s.elem_L->paramLength();
+    func.paramY()->range = Z::VariableRange::withPoints(0_mm, 500_mm, 129);
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_EQ_INT(func.calculatedPoints(), 129*129)
+    auto denseT = func.resultsT();
+
+    func.paramX()->range.tolerance = 0.01;
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_IS_TRUE(func.calculatedPoints() < 129*129 / 2)
+
+    // Stability boundaries are resolved as in the full grid,
+    // values are only compared within the stable range as the color scale saturates outside of it
+    auto resT = func.resultsT();
+    ASSERT_EQ_INT(resT.size(), denseT.size())
+    int mismatched = 0;
+    for (int i = 0; i < resT.size(); i++)
+    {
+        bool stable = qAbs(resT.at(i)) <= 1;
+        bool denseStable = qAbs(denseT.at(i)) <= 1;
+        if (stable != denseStable)
+            mismatched++;
+        else if (stable)
+            ASSERT_NEAR_DBL(resT.at(i), denseT.at(i), 0.05)
+    }
+    ASSERT_EQ_INT(mismatched, 0)
+}
+
+TEST_METHOD(calculate_adaptive_in_job)
+{
+    TEST_SCHEMA(TripType::SW)
+    StabilityMap2DFunction func(s.schema);
+    func.setStabilityCalcMode(Z::Enums::StabilityCalcMode::Normal);
+    func.paramX()->element = s.elem_L_foc;
+    func.paramX()->parameter = s.elem_L_foc->paramLength();
+    func.paramX()->range = Z::VariableRange::withPoints(0_mm, 100_mm, 129);
+    func.paramX()->range.tolerance = 0.01;
+    func.paramY()->element = s.elem_L;
+    func.paramY()->parameter = s.elem_L->paramLength();
+    func.paramY()->range = Z::VariableRange::withPoints(0_mm, 500_mm, 129);
+
+    auto job = func.prepareJob();
+    ASSERT_IS_TRUE(job != nullptr)
+    job->run();
+    func.applyJob(job.get());
+    ASSERT_FUNC_OK
+    ASSERT_IS_TRUE(func.calculatedPoints() < 129*129 / 2)
+
+    // Variables driving elements via links can't be varied in a snapshot,
+    // so this function is calculated by calculate() in the schema itself
+    auto p1 = new Z::Parameter(Z::Dims::linear(), "p1");
+    auto p2 = new Z::Parameter(Z::Dims::linear(), "p2");
+    s.schema->addGlobalParam(p1);
+    s.schema->addGlobalParam(p2);
+    s.schema->addParamLink(p1, s.elem_L_foc->paramLength());
+    s.schema->addParamLink(p2, s.elem_L->paramLength());
+
+    StabilityMap2DFunction funcRef(s.schema);
+    funcRef.setStabilityCalcMode(Z::Enums::StabilityCalcMode::Normal);
+    funcRef.paramX()->element = (Element*)s.schema->globalParamsAsElem();
+    funcRef.paramX()->parameter = p1;
+    funcRef.paramX()->range = Z::VariableRange::withPoints(0_mm, 100_mm, 129);
+    funcRef.paramX()->range.tolerance = 0.01;
+    funcRef.paramY()->element = (Element*)s.schema->globalParamsAsElem();
+    funcRef.paramY()->parameter = p2;
+    funcRef.paramY()->range = Z::VariableRange::withPoints(0_mm, 500_mm, 129);
+    ASSERT_IS_TRUE(funcRef.prepareJob() == nullptr)
+    funcRef.calculate();
+    ASSERT_IS_TRUE(funcRef.ok())
+
+    // Whether a cell is subdivided depends only on values at its corners,
+    // so the job refining cells in parallel calculates the same points.
+    // Interpolated points on common edges of cells can take values
+    // from different neighbours, they are compared as in calculate_adaptive
+    ASSERT_EQ_INT(func.calculatedPoints(), funcRef.calculatedPoints())
+    for (auto results : {std::make_pair(func.resultsT(), funcRef.resultsT()),
+                         std::make_pair(func.resultsS(), funcRef.resultsS())})
+    {
+        const auto& res = results.first;
+        const auto& ref = results.second;
+        ASSERT_EQ_INT(res.size(), ref.size())
+        for (int i = 0; i < res.size(); i++)
+        {
+            bool stable = qAbs(res.at(i)) <= 1;
+            ASSERT_IS_TRUE(stable == (qAbs(ref.at(i)) <= 1))
+            if (stable)
+                ASSERT_NEAR_DBL(res.at(i), ref.at(i), 0.05)
+        }
+    }
+}
+
 TEST_GROUP("StabilityMap2DFunction",
            ADD_TEST(calculate_normal),
            ADD_TEST(calculate_squared),
            ADD_TEST(calculateAt),
            ADD_TEST(calculate_with_global_param),
            ADD_TEST(calculate_with_global_param_formula),
+           ADD_TEST(calculate_in_job),
+           ADD_TEST(calculate_adaptive),
+           ADD_TEST(calculate_adaptive_in_job),
            )
 } // namespace StabilityMap2
 
@@ -528,6 +675,127 @@ TEST_METHOD(calculateAt_SP_R)
     ASSERT_NEAR_TS(func.calculateAt(0.057_m), 0.0388935389, 0.0385073863, 1e-10)
 }
 
+TEST_METHOD(calculate_resonator_W_adaptive)
+{
+    TEST_SCHEMA(TripType::SW)
+    CausticFunction func(s.schema);
+    func.setMode(CausticFunction::Mode::BeamRadius);
+    func.arg()->element = s.elem_L_foc;
+    func.arg()->range.start = 0_m;
+    func.arg()->range.stop = 0_m;
+    func.arg()->range.step = 0_m;
+    func.arg()->range.points = 10;
+    func.arg()->range.tolerance = 0.001;
+    func.calculate();
+    ASSERT_FUNC_OK
+    ASSERT_FUNC_RESULT_COUNT(1)
+
+    auto res = func.result(Z::T, 0);
+    ASSERT_IS_TRUE(res.pointsCount() > 10)
+    ASSERT_EQ_DBL(res.x().first(), 0)
+    ASSERT_NEAR_DBL(res.x().last(), 0.056, 1e-9)
+    double minW = res.y().first();
+    for (int i = 1; i < res.pointsCount(); i++)
+    {
+        ASSERT_IS_TRUE(res.x().at(i) > res.x().at(i-1))
+        minW = qMin(minW, res.y().at(i));
+    }
+    // The waist is resolved better than with the uniform grid, see calculate_resonator_W
+    ASSERT_IS_TRUE(minW < 4.58850784e-05)
+
+    int i = res.pointsCount() / 2;
+    ASSERT_NEAR_DBL(func.calculateAt(Z::Value(res.x().at(i), Z::Units::m())).T, res.y().at(i), 1e-12)
+}
+
+TEST_METHOD(dependencyCone_SP)
+{
+    TEST_SCHEMA(TripType::SP)
+    auto p1 = new Z::Parameter(Z::Dims::linear(), "p1");
+    auto p2 = new Z::Parameter(Z::Dims::linear(), "p2");
+    s.schema->addGlobalParam(p1);
+    s.schema->addGlobalParam(p2);
+    s.schema->addParamLink(p1, s.elem_M_back->param("R"));
+    s.schema->addParamLink(p2, s.elem_L->paramLength());
+
+    CausticFunction func(s.schema);
+    func.arg()->element = s.elem_L_foc;
+    func.arg()->range = Z::VariableRange::withPoints(0_mm, 0_mm, 10);
+    ASSERT_IS_FALSE(func.dependencyCone().has_value())
+
+    func.calculate();
+    ASSERT_FUNC_OK
+    auto cone = func.dependencyCone();
+    ASSERT_IS_TRUE(cone.has_value())
+    // Elements behind the caustic range can't affect the result
+    ASSERT_IS_TRUE(cone->check(s.elem_M_back))
+    ASSERT_IS_TRUE(cone->check(s.elem_L_foc))
+    ASSERT_IS_FALSE(cone->check(s.elem_M_foc))
+    ASSERT_IS_FALSE(cone->check(s.elem_L))
+    ASSERT_IS_FALSE(cone->check(s.elem_M_out))
+    ASSERT_IS_TRUE(cone->check(p1))
+    ASSERT_IS_FALSE(cone->check(p2))
+}
+
+TEST_METHOD(dependencyCone_disabledElem)
+{
+    TEST_SCHEMA(TripType::SW)
+    s.elem_M_out->setDisabled(true);
+
+    CausticFunction func(s.schema);
+    func.arg()->element = s.elem_L_foc;
+    func.arg()->range = Z::VariableRange::withPoints(0_mm, 0_mm, 10);
+    func.calculate();
+    ASSERT_FUNC_OK
+    auto cone = func.dependencyCone();
+    ASSERT_IS_TRUE(cone.has_value())
+
+    // Disabled element is not in the round-trip and its changes don't matter
+    ASSERT_IS_FALSE(cone->check(s.elem_M_out))
+
+    // But enabling of it changes the round-trip
+    s.elem_M_out->setDisabled(false);
+    ASSERT_IS_TRUE(cone->check(s.elem_M_out))
+    ASSERT_IS_TRUE(cone->check(Elements({s.elem_M_out})))
+}
+
+TEST_METHOD(dependencyCone_resonator)
+{
+    TEST_CAUSTIC_FUNC(TripType::SW, CausticFunction::Mode::BeamRadius)
+    auto cone = func.dependencyCone();
+    ASSERT_IS_TRUE(cone.has_value())
+    for (auto elem : s.schema->elements())
+        ASSERT_IS_TRUE(cone->check(elem))
+}
+
+TEST_METHOD(calculate_in_job)
+{
+    for (auto tripType : {TripType::SW, TripType::SP})
+    {
+        TEST_CAUSTIC_FUNC(tripType, CausticFunction::Mode::FrontRadius)
+        CausticFunction funcJob(s.schema);
+        funcJob.setMode(CausticFunction::Mode::FrontRadius);
+        *funcJob.arg() = *func.arg();
+
+        auto job = funcJob.prepareJob();
+        ASSERT_IS_TRUE(job != nullptr)
+        // Results are not touched until the job is applied
+        ASSERT_EQ_INT(funcJob.resultCount(Z::T), 0)
+
+        job->run();
+        funcJob.applyJob(job.get());
+        ASSERT_IS_TRUE(funcJob.ok())
+        for (auto plane : {Z::T, Z::S})
+        {
+            ASSERT_EQ_INT(funcJob.resultCount(plane), func.resultCount(plane))
+            for (int i = 0; i < func.resultCount(plane); i++)
+            {
+                ASSERT_NEAR_DBL_ARR(funcJob.result(plane, i).x(), func.result(plane, i).x(), 1e-15)
+                ASSERT_NEAR_DBL_ARR(funcJob.result(plane, i).y(), func.result(plane, i).y(), 1e-10)
+            }
+        }
+    }
+}
+
 TEST_GROUP("CausticFunction",
            ADD_TEST(calculate_resonator_W),
            ADD_TEST(calculate_resonator_R),
@@ -537,6 +805,11 @@ TEST_GROUP("CausticFunction",
            ADD_TEST(calculate_SP_R),
            ADD_TEST(calculateAt_SP_W),
            ADD_TEST(calculateAt_SP_R),
+           ADD_TEST(calculate_resonator_W_adaptive),
+           ADD_TEST(dependencyCone_SP),
+           ADD_TEST(dependencyCone_disabledElem),
+           ADD_TEST(dependencyCone_resonator),
+           ADD_TEST(calculate_in_job),
            )
 
 } // namespace Caustic
@@ -760,14 +1033,106 @@ TEST_METHOD(calculateAt_SP_R)
     ASSERT_NEAR_TS(func.calculateAt(0.2), 0.0771479866, 0.0697118023, 1e-10)
 }
 
+TEST_METHOD(calculate_resonator_as_single_ranges)
+{
+    // In resonators, ranges are calculated using the reference sweep without their own round-trips,
+    // results must be the same as when each range is calculated by its own caustic function
+    for (auto mode : {CausticFunction::BeamRadius, CausticFunction::FrontRadius, CausticFunction::HalfAngle})
+    {
+        TEST_MULTIRANGE_CAUSTIC_FUNC(TripType::SW, mode)
+        CausticFunction f1(s.schema);
+        CausticFunction f2(s.schema);
+        for (auto [f, v] : {std::make_pair(&f1, v1), std::make_pair(&f2, v2)})
+        {
+            f->setMode(mode);
+            *f->arg() = v;
+            f->calculate();
+            ASSERT_IS_TRUE(f->ok())
+        }
+        for (auto plane : {Z::T, Z::S})
+        {
+            ASSERT_EQ_INT(func.resultCount(plane), f1.resultCount(plane) + f2.resultCount(plane))
+            for (int i = 0; i < func.resultCount(plane); i++)
+            {
+                bool isFirst = i < f1.resultCount(plane);
+                auto expected = isFirst ? f1.result(plane, i) : f2.result(plane, i - f1.resultCount(plane));
+                auto res = func.result(plane, i);
+                ASSERT_NEAR_DBL_ARR(res.x(), expected.x(), 1e-15)
+                ASSERT_NEAR_DBL_ARR(res.y(), expected.y(), 1e-9)
+            }
+        }
+
+        // Round-trips of ranges are not built but the cone is still known
+        auto cone = func.dependencyCone();
+        ASSERT_IS_TRUE(cone.has_value())
+        for (auto elem : s.schema->elements())
+            ASSERT_IS_TRUE(cone->check(elem))
+    }
+}
+
+TEST_METHOD(show_round_trip_of_range)
+{
+    TEST_MULTIRANGE_CAUSTIC_FUNC(TripType::SW, CausticFunction::Mode::BeamRadius)
+    for (auto f : func.funcs())
+    {
+        // Ranges are calculated using the reference sweep without their own round-trips
+        ASSERT_IS_TRUE(f->roundTripCalculator()->roundTrip().isEmpty())
+
+        PlotFuncRoundTripFunction rt("", f);
+        rt.calculate();
+        auto c = f->roundTripCalculator();
+        ASSERT_EQ_INT(c->roundTrip().size(), 8)
+        ASSERT_IS_TRUE(c->isStable().T)
+        ASSERT_IS_TRUE(c->isStable().S)
+
+        // The shown matrices are of the last plotted point, at the range end
+        RoundTripCalculator expected(s.schema, f->arg()->element);
+        expected.calcRoundTrip(true);
+        expected.multMatrix("test::show_round_trip_of_range");
+        ASSERT_NEAR_DBL(c->Mt().A.real(), expected.Mt().A.real(), 1e-12)
+        ASSERT_NEAR_DBL(c->Mt().B.real(), expected.Mt().B.real(), 1e-12)
+        ASSERT_NEAR_DBL(c->Ms().C.real(), expected.Ms().C.real(), 1e-12)
+        ASSERT_NEAR_DBL(c->Ms().D.real(), expected.Ms().D.real(), 1e-12)
+    }
+}
+
+TEST_METHOD(calculate_in_job)
+{
+    for (auto tripType : {TripType::SW, TripType::SP})
+    {
+        TEST_MULTIRANGE_CAUSTIC_FUNC(tripType, CausticFunction::Mode::BeamRadius)
+        MultirangeCausticFunction funcJob(s.schema);
+        funcJob.setArgs({v1, v2});
+        funcJob.setMode(CausticFunction::Mode::BeamRadius);
+
+        auto job = funcJob.prepareJob();
+        ASSERT_IS_TRUE(job != nullptr)
+        job->run();
+        funcJob.applyJob(job.get());
+        ASSERT_IS_TRUE(funcJob.ok())
+        for (auto plane : {Z::T, Z::S})
+        {
+            ASSERT_EQ_INT(funcJob.resultCount(plane), func.resultCount(plane))
+            for (int i = 0; i < func.resultCount(plane); i++)
+            {
+                ASSERT_NEAR_DBL_ARR(funcJob.result(plane, i).x(), func.result(plane, i).x(), 1e-15)
+                ASSERT_NEAR_DBL_ARR(funcJob.result(plane, i).y(), func.result(plane, i).y(), 1e-9)
+            }
+        }
+    }
+}
+
 TEST_GROUP("MultirangeCausticFunction",
            ADD_TEST(calculate_resonator_W),
+           ADD_TEST(calculate_resonator_as_single_ranges),
+           ADD_TEST(show_round_trip_of_range),
            ADD_TEST(calculateAt_resonator_W),
            ADD_TEST(calculateAt_resonator_R),
            ADD_TEST(calculate_SP_W),
            ADD_TEST(calculate_SP_R),
            ADD_TEST(calculateAt_SP_W),
            ADD_TEST(calculateAt_SP_R),
+           ADD_TEST(calculate_in_job),
            )
 } // namespace MultirangeCaustic
 
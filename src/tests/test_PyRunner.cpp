@@ -0,0 +1,92 @@
+#include "../core/Elements.h"
+#include "../core/PyRunner.h"
+#include "../core/Schema.h"
+#include "../funcs/FuncWindowHelpers.h"
+
+#include "testing/OriTestBase.h"
+
+#include <QApplication>
+#include <QThread>
+#include <QTimer>
+
+#include <atomic>
+
+namespace Z {
+namespace Tests {
+namespace PyRunnerTests {
+
+namespace {
+struct ThreadRecorder : public Z::ParameterListener
+{
+    QThread *thread = nullptr;
+    void parameterChanged(Z::ParameterBase*) override { thread = QThread::currentThread(); }
+};
+}
+
+TEST_METHOD(set_param_from_worker_is_applied_in_main_thread)
+{
+    Schema schema;
+    auto elem = new ElemEmptyRange;
+    elem->setLabel("d1");
+    elem->paramLength()->setValue(100_mm);
+    schema.insertElements({elem}, 0, Arg::RaiseEvents(false));
+
+    ThreadRecorder recorder;
+    elem->paramLength()->addListener(&recorder);
+
+    // Parameter listeners are usually widgets, they must be notified in the main thread
+    // even when the custom function runs in PyWorker
+    PyRunner py;
+    py.schema = &schema;
+    py.moduleName = "test_set_param_from_worker";
+    py.code = "import schema\n"
+              "def calculate():\n"
+              "    schema.elem('d1').set_param('L', 0.5)\n";
+    py.funcNames = { "calculate" };
+    bool done = false;
+    bool ok = FuncWindowHelpers::runCustomCode(nullptr, &schema, [&py, &done]{
+        done = py.load() && py.run("calculate", {}, {});
+    });
+    if (!py.errorLog.isEmpty())
+        TEST_LOG(py.errorLog.join('\n'))
+
+    elem->paramLength()->removeListener(&recorder);
+
+    ASSERT_IS_TRUE(ok)
+    ASSERT_IS_TRUE(done)
+    ASSERT_IS_TRUE(recorder.thread == qApp->thread())
+    ASSERT_EQ_DBL(elem->lengthSI(), 0.5)
+}
+
+TEST_METHOD(busy_worker_calls_retry_when_finished)
+{
+    Schema schema;
+    std::atomic<bool> release = false;
+    bool busyStarted = true;
+    int retryCount = 0;
+
+    // The second code is requested while the first one is still running in the worker
+    QTimer::singleShot(0, qApp, [&]{
+        busyStarted = FuncWindowHelpers::runCustomCode(nullptr, &schema, []{}, [&retryCount]{ retryCount++; });
+        release = true;
+    });
+    bool ok = FuncWindowHelpers::runCustomCode(nullptr, &schema, [&release]{
+        while (!release) QThread::msleep(1);
+    });
+    ASSERT_IS_TRUE(ok)
+    ASSERT_IS_FALSE(busyStarted)
+
+    QCoreApplication::processEvents();
+    ASSERT_EQ_INT(retryCount, 1)
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("PyRunner",
+    ADD_TEST(set_param_from_worker_is_applied_in_main_thread),
+    ADD_TEST(busy_worker_calls_retry_when_finished),
+)
+
+} // namespace PyRunnerTests
+} // namespace Tests
+} // namespace Z
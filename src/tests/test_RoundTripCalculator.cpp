@@ -389,6 +389,167 @@ TEST_METHOD(multMatrix)
     ASSERT_MATRIX_NEAR(c.Ms(), -1.3899498, 0.1731843, -9.8480800, 0.5075960, 1e-7)
 }
 
+TEST_METHOD(multMatrix_real)
+{
+    TestData d(SW, RefIndex(0), {
+                   makeElem<ElemCurveMirror>("M1", "R = 100mm"),
+                   makeElem<ElemEmptyRange>("L1", "L = 50mm"),
+                   makeElem<ElemPlate>("Cr", "L = 10mm; n = 1.5"),
+                   makeElem<ElemEmptyRange>("L2", "L = 70mm"),
+                   makeElem<ElemCurveMirror>("M2", "R = 150mm"),
+               });
+    d.calc->calcRoundTrip();
+    ASSERT_IS_TRUE(d.calc->isReal())
+    d.calc->multMatrix("test::multMatrix_real");
+
+    Matrix mt, ms;
+    for (auto m : d.calc->matrsT()) mt *= m;
+    for (auto m : d.calc->matrsS()) ms *= m;
+    ASSERT_EQ_MATRIX(d.calc->Mt(), mt)
+    ASSERT_EQ_MATRIX(d.calc->Ms(), ms)
+}
+
+TEST_METHOD(multMatrix_complex)
+{
+    TestData d(SW, RefIndex(0), {
+                   makeElem<ElemFlatMirror>("M1", ""),
+                   makeElem<ElemEmptyRange>("L1", "L = 50mm"),
+                   makeElem<ElemGaussAperture>("GA", "alpha2t = 1; alpha2s = 2"),
+                   makeElem<ElemFlatMirror>("M2", ""),
+               });
+    d.calc->calcRoundTrip();
+    ASSERT_IS_FALSE(d.calc->isReal())
+}
+
+TEST_METHOD(multMatrix_cached)
+{
+    auto m1 = makeElem<ElemCurveMirror>("M1", "R = 100mm");
+    auto l2 = makeElem<ElemEmptyRange>("L2", "L = 70mm");
+    TestData d(SW, RefIndex(0), {
+                   m1,
+                   makeElem<ElemEmptyRange>("L1", "L = 50mm"),
+                   makeElem<ElemThinLens>("F", "F = 80mm"),
+                   l2,
+                   makeElem<ElemCurveMirror>("M2", "R = 150mm"),
+               });
+    RoundTripCalculator c(d.schema.data(), m1);
+    c.calcRoundTrip();
+    c.setVariedElements({m1});
+    d.calc->calcRoundTrip();
+
+    #define ASSERT_SAME_PRODUCTS \
+        c.multMatrix("test::multMatrix_cached"); \
+        d.calc->multMatrix("test::multMatrix_cached"); \
+        ASSERT_MATRIX_NEAR(c.Mt(), d.calc->Mt().A.real(), d.calc->Mt().B.real(), d.calc->Mt().C.real(), d.calc->Mt().D.real(), 1e-12) \
+        ASSERT_MATRIX_NEAR(c.Ms(), d.calc->Ms().A.real(), d.calc->Ms().B.real(), d.calc->Ms().C.real(), d.calc->Ms().D.real(), 1e-12)
+
+    ASSERT_SAME_PRODUCTS
+
+    // varied element changed
+    m1->param("R")->setValue(200_mm);
+    ASSERT_SAME_PRODUCTS
+
+    // fixed element changed, cache must be invalidated
+    l2->param("L")->setValue(90_mm);
+    ASSERT_SAME_PRODUCTS
+
+    #undef ASSERT_SAME_PRODUCTS
+}
+
+static void assertSubrangeSweep(Ori::Testing::TestBase* test, TripType tripType, ElementRange* range)
+{
+    TestData d(tripType, RefIndex(1), {
+                   makeElem<ElemCurveMirror>("M1", "R = 100mm; Alpha = 10deg"),
+                   range,
+                   makeElem<ElemThinLens>("F", "F = 80mm"),
+                   makeElem<ElemEmptyRange>("L2", "L = 70mm"),
+                   makeElem<ElemCurveMirror>("M2", "R = 150mm"),
+               });
+    RoundTripCalculator c(d.schema.data(), range);
+    c.calcRoundTrip(true);
+    ASSERT_IS_TRUE(c.beginSubrangeSweep())
+    // The same sweep but starting from a round-trip given by another calculator,
+    // the own round-trip is not needed then
+    RoundTripCalculator refSweep(d.schema.data(), d.schema->elements().last());
+    refSweep.calcRoundTrip();
+    ASSERT_IS_TRUE(refSweep.beginReferenceSweep())
+    RoundTripCalculator c1(d.schema.data(), range);
+    ASSERT_IS_TRUE(c1.beginSubrangeSweep(&refSweep))
+    d.calc->calcRoundTrip(true);
+    for (double x : {0.0, 0.003, 0.01, 0.017})
+    {
+        c.multMatrixAtSubrange(x);
+        c1.multMatrixAtSubrange(x);
+        range->setSubRangeSI(x);
+        d.calc->multMatrix("test::multMatrixAtSubrange");
+        ASSERT_MATRIX_NEAR(c.Mt(), d.calc->Mt().A.real(), d.calc->Mt().B.real(), d.calc->Mt().C.real(), d.calc->Mt().D.real(), 1e-12)
+        ASSERT_MATRIX_NEAR(c.Ms(), d.calc->Ms().A.real(), d.calc->Ms().B.real(), d.calc->Ms().C.real(), d.calc->Ms().D.real(), 1e-12)
+        ASSERT_MATRIX_NEAR(c1.Mt(), d.calc->Mt().A.real(), d.calc->Mt().B.real(), d.calc->Mt().C.real(), d.calc->Mt().D.real(), 1e-12)
+        ASSERT_MATRIX_NEAR(c1.Ms(), d.calc->Ms().A.real(), d.calc->Ms().B.real(), d.calc->Ms().C.real(), d.calc->Ms().D.real(), 1e-12)
+    }
+}
+
+TEST_METHOD(multMatrixAtSubrange_SW)
+{
+    assertSubrangeSweep(test, SW, makeElem<ElemTiltedCrystal>("Cr", "L = 20mm; n = 1.7; Alpha = 15deg"));
+}
+
+TEST_METHOD(multMatrixAtSubrange_SP)
+{
+    assertSubrangeSweep(test, SP, makeElem<ElemBrewsterCrystal>("Cr", "L = 20mm; n = 1.7"));
+}
+
+TEST_METHOD(multMatrixAtSubrange_grin)
+{
+    assertSubrangeSweep(test, SW, makeElem<ElemGrinLens>("G", "L = 20mm; n = 1.7; n2t = 100; n2s = 100"));
+}
+
+static void assertReferenceSweep(Ori::Testing::TestBase* test, TripType tripType)
+{
+    TestData d(tripType, RefIndex(6), {
+                   makeElem<ElemCurveMirror>("M1", "R = 100mm; Alpha = 10deg"),
+                   makeElem<ElemEmptyRange>("L1", "L = 50mm"),
+                   makeElem<ElemTiltedCrystal>("Cr", "L = 20mm; n = 1.7; Alpha = 15deg"),
+                   makeElem<ElemEmptyRange>("L2", "L = 30mm"),
+                   makeElem<ElemThinLens>("F", "F = 80mm"),
+                   makeElem<ElemEmptyRange>("L3", "L = 70mm"),
+                   makeElem<ElemCurveMirror>("M2", "R = 150mm"),
+               });
+    d.calc->calcRoundTrip();
+    ASSERT_IS_TRUE(d.calc->beginReferenceSweep())
+    for (auto elem : d.schema->elements())
+    {
+        auto range = Z::Utils::asRange(elem);
+        for (bool split : {false, true})
+        {
+            if (split && !range) continue;
+            if (split) range->setSubRangeSI(0.007);
+            RoundTripCalculator c(d.schema.data(), elem);
+            c.calcRoundTrip(split);
+            c.multMatrix("test::multMatrixAtReference");
+            ASSERT_IS_TRUE(d.calc->multMatrixAtReference(elem, split))
+            ASSERT_MATRIX_NEAR(d.calc->Mt(), c.Mt().A.real(), c.Mt().B.real(), c.Mt().C.real(), c.Mt().D.real(), 1e-12)
+            ASSERT_MATRIX_NEAR(d.calc->Ms(), c.Ms().A.real(), c.Ms().B.real(), c.Ms().C.real(), c.Ms().D.real(), 1e-12)
+        }
+    }
+    ASSERT_IS_FALSE(d.calc->multMatrixAtReference(nullptr, false))
+}
+
+TEST_METHOD(multMatrixAtReference_SW)
+{
+    assertReferenceSweep(test, SW);
+}
+
+TEST_METHOD(multMatrixAtReference_RR)
+{
+    assertReferenceSweep(test, RR);
+}
+
+TEST_METHOD(multMatrixAtReference_SP)
+{
+    assertReferenceSweep(test, SP);
+}
+
 #define ASSERT_STABILITY(c, expected_t, expected_s) \
 {\
     auto s = c.isStable();\
@@ -467,6 +628,15 @@ TEST_METHOD(stability_unstable)
 
 TEST_GROUP("General functionality",
            ADD_TEST(multMatrix),
+           ADD_TEST(multMatrix_real),
+           ADD_TEST(multMatrix_complex),
+           ADD_TEST(multMatrix_cached),
+           ADD_TEST(multMatrixAtSubrange_SW),
+           ADD_TEST(multMatrixAtSubrange_SP),
+           ADD_TEST(multMatrixAtSubrange_grin),
+           ADD_TEST(multMatrixAtReference_SW),
+           ADD_TEST(multMatrixAtReference_RR),
+           ADD_TEST(multMatrixAtReference_SP),
            ADD_TEST(stability_stable),
            ADD_TEST(stability_unstable_S),
            ADD_TEST(stability_unstable_T),
@@ -417,6 +417,48 @@ TEST_METHOD(insertElements__must_raise_events_for_all_elems)
 
 //------------------------------------------------------------------------------
 
+TEST_METHOD(eventsBatch__must_deduplicate_events)
+{
+    SCHEMA_AND_LISTENER
+    auto el1 = new TestElement;
+    auto el2 = new TestElement;
+    schema.insertElements({el1, el2}, -1, Arg::RaiseEvents(false));
+    {
+        SchemaEventsBatch batch(&schema);
+        schema.events().raise(SchemaEvents::ElemChanged, el1, "");
+        schema.events().raise(SchemaEvents::ElemChanged, el2, "");
+        schema.events().raise(SchemaEvents::ElemChanged, el1, "");
+        schema.events().raise(SchemaEvents::RecalRequred, "");
+        schema.events().raise(SchemaEvents::ElemChanged, el2, "");
+        schema.events().raise(SchemaEvents::RecalRequred, "");
+        ASSERT_SCHEMA_STATE(STATE(Modified))
+        ASSERT_LISTENER_NO_EVENTS
+    }
+    ASSERT_LISTENER_EVENTS(EVENT(ElemChanged), EVENT(ElemChanged), EVENT(Changed), EVENT(RecalRequred))
+    ASSERT_LISTENER_EVENT_PARAMS(el1, el2, nullptr, nullptr)
+}
+
+TEST_METHOD(eventsBatch__must_deliver_collected_events_before_non_batchable_one)
+{
+    SCHEMA_AND_LISTENER
+    auto el1 = new TestElement;
+    auto el2 = new TestElement;
+    schema.insertElements({el1}, -1, Arg::RaiseEvents(false));
+    {
+        SchemaEventsBatch batch(&schema);
+        {
+            SchemaEventsBatch nestedBatch(&schema);
+            schema.events().raise(SchemaEvents::ElemChanged, el1, "");
+        }
+        ASSERT_LISTENER_NO_EVENTS
+        schema.insertElements({el2}, -1, Arg::RaiseEvents(true));
+        ASSERT_LISTENER_EVENTS(EVENT(ElemChanged), EVENT(Changed), EVENT(ElemCreated), EVENT(Changed))
+    }
+    ASSERT_LISTENER_EVENTS(EVENT(ElemChanged), EVENT(Changed), EVENT(ElemCreated), EVENT(Changed), EVENT(RecalRequred))
+}
+
+//------------------------------------------------------------------------------
+
 TEST_METHOD(deleteElements__must_not_fail_when_invalid_elem)
 {
     PREPARE_SCHEMA_ELEMS(1)
@@ -659,6 +701,8 @@ TEST_GROUP("Schema",
     ADD_TEST(insertElements__must_raise_events_and_change_state),
     ADD_TEST(insertElements__must_not_raise_events_when_they_disabled_by_param),
     ADD_TEST(insertElements__must_raise_events_for_all_elems),
+    ADD_TEST(eventsBatch__must_deduplicate_events),
+    ADD_TEST(eventsBatch__must_deliver_collected_events_before_non_batchable_one),
     ADD_TEST(deleteElements__must_not_fail_when_invalid_elem),
     ADD_TEST(deleteElements__must_remove_element_from_schema),
     ADD_TEST(deleteElements__must_reset_element_owner),
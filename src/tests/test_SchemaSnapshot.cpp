@@ -0,0 +1,108 @@
+#include "../core/Elements.h"
+#include "../core/Schema.h"
+#include "../math/RoundTripCalculator.h"
+#include "../math/SchemaSnapshot.h"
+#include "../tests/TestUtils.h"
+
+#include "testing/OriTestBase.h"
+
+namespace Z {
+namespace Tests {
+namespace SchemaSnapshotTests {
+
+#define ASSERT_SAME_MATRIX(m, expected, eps) \
+    ASSERT_MATRIX_NEAR(m, (expected).A.real(), (expected).B.real(), (expected).C.real(), (expected).D.real(), eps)
+
+struct TestSchema
+{
+    Schema schema;
+    ElemCurveMirror *m1;
+    ElemEmptyRange *l1;
+    ElemTiltedCrystal *cr;
+    ElemEmptyRange *l2;
+    ElemCurveMirror *m2;
+
+    TestSchema()
+    {
+        m1 = makeElem<ElemCurveMirror>("M1", "R = 100mm; Alpha = 10deg");
+        l1 = makeElem<ElemEmptyRange>("L1", "L = 50mm");
+        cr = makeElem<ElemTiltedCrystal>("Cr", "L = 10mm; n = 1.7; Alpha = 15deg");
+        l2 = makeElem<ElemEmptyRange>("L2", "L = 70mm");
+        m2 = makeElem<ElemCurveMirror>("M2", "R = 150mm");
+        schema.setTripType(TripType::SW);
+        schema.insertElements({m1, l1, cr, l2, m2}, -1, Arg::RaiseEvents(false));
+    }
+};
+
+TEST_METHOD(snapshot_data)
+{
+    TestSchema s;
+    s.l2->setDisabled(true);
+    SchemaSnapshot snapshot(&s.schema);
+
+    ASSERT_EQ_INT(snapshot.elems().size(), 4)
+    ASSERT_EQ_INT(snapshot.indexOf(s.cr), 2)
+    ASSERT_EQ_INT(snapshot.indexOf(s.l2), -1)
+    ASSERT_IS_TRUE(snapshot.tripType() == TripType::SW)
+
+    const auto& cr = snapshot.elems().at(2);
+    ASSERT_EQ_STR(cr.type, s.cr->type())
+    ASSERT_IS_TRUE(cr.isRange)
+    ASSERT_EQ_INT(cr.paramsCount, s.cr->params().size())
+    ASSERT_EQ_DBL(snapshot.params().at(cr.paramsOffset), 0.01)
+    ASSERT_SAME_MATRIX(cr.matrs.at(SchemaSnapshot::MT), s.cr->Mt(), 0)
+    ASSERT_SAME_MATRIX(cr.matrs.at(SchemaSnapshot::MS_INV), s.cr->Ms_inv(), 0)
+}
+
+TEST_METHOD(calculator_gives_same_round_trip)
+{
+    TestSchema s;
+    RoundTripCalculator c(&s.schema, s.l1);
+    c.calcRoundTrip(true);
+    c.multMatrix("test::calculator_gives_same_round_trip");
+
+    auto snapshot = std::make_shared<const SchemaSnapshot>(&s.schema);
+    auto roundTrip = snapshot->roundTrip(c);
+    ASSERT_EQ_INT(roundTrip.items.size(), c.matrsT().size())
+
+    SnapshotCalculator calc(snapshot);
+    calc.setRoundTrip(roundTrip);
+    calc.multMatrix();
+    ASSERT_SAME_MATRIX(calc.Mt(), c.Mt(), 1e-12)
+    ASSERT_SAME_MATRIX(calc.Ms(), c.Ms(), 1e-12)
+}
+
+TEST_METHOD(calculator_does_not_change_schema)
+{
+    TestSchema s;
+    RoundTripCalculator c(&s.schema, s.m1);
+    c.calcRoundTrip();
+
+    auto snapshot = std::make_shared<const SchemaSnapshot>(&s.schema);
+    int elemIndex = snapshot->indexOf(s.cr);
+    int paramIndex = snapshot->paramIndex(s.cr, s.cr->param("L"));
+
+    SnapshotCalculator calc(snapshot);
+    ASSERT_IS_TRUE(calc.canChangeParams(elemIndex))
+    calc.setRoundTrip(snapshot->roundTrip(c), {elemIndex});
+    calc.setParam(elemIndex, paramIndex, 0.025);
+    calc.multMatrix();
+    ASSERT_EQ_DBL(s.cr->param("L")->value().toSi(), 0.01)
+
+    s.cr->param("L")->setValue(25_mm);
+    c.multMatrix("test::calculator_does_not_change_schema");
+    ASSERT_SAME_MATRIX(calc.Mt(), c.Mt(), 1e-12)
+    ASSERT_SAME_MATRIX(calc.Ms(), c.Ms(), 1e-12)
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP("Schema Snapshot",
+    ADD_TEST(snapshot_data),
+    ADD_TEST(calculator_gives_same_round_trip),
+    ADD_TEST(calculator_does_not_change_schema),
+)
+
+} // namespace SchemaSnapshotTests
+} // namespace Tests
+} // namespace Z
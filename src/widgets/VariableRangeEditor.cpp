@@ -8,6 +8,8 @@
 #include "helpers/OriWidgets.h"
 
 #include <QApplication>
+#include <QCheckBox>
+#include <QDoubleSpinBox>
 #include <QLabel>
 #include <QMessageBox>
 #include <QRadioButton>
@@ -16,6 +18,11 @@
 static const int MIN_POINTS_COUNT = 3;
 static const int MAX_POINTS_COUNT = 10000;
 
+// Tolerance is shown in percents of the plot value span
+static const double MIN_TOLERANCE = 0.01;
+static const double MAX_TOLERANCE = 10;
+static const double DEFAULT_TOLERANCE = 0.5;
+
 //------------------------------------------------------------------------------
 //                                PointsEditor
 //------------------------------------------------------------------------------
@@ -63,11 +70,58 @@ struct StepEditor
     }
 };
 
+//------------------------------------------------------------------------------
+//                               ToleranceEditor
+//------------------------------------------------------------------------------
+
+struct ToleranceEditor
+{
+    QDoubleSpinBox* editor;
+    QBoxLayout* layout;
+    QCheckBox* flag;
+
+    ToleranceEditor()
+    {
+        flag = new QCheckBox(qApp->tr("Refine adaptively", "Variable range editor"));
+        flag->setToolTip(qApp->tr("Points are used as initial grid which is refined "
+                                  "where the plot bends, changes its sign or breaks", "Variable range editor"));
+
+        editor = new QDoubleSpinBox;
+        editor->setAlignment(Qt::AlignRight);
+        editor->setRange(MIN_TOLERANCE, MAX_TOLERANCE);
+        editor->setDecimals(2);
+        editor->setSingleStep(0.1);
+        editor->setSuffix(" %");
+        editor->setValue(DEFAULT_TOLERANCE);
+        editor->setFont(Z::Gui::ValueFont().get());
+
+        layout = new QHBoxLayout;
+        layout->setContentsMargins(0, 0, 0, 0);
+        layout->setSpacing(0);
+        layout->addWidget(editor);
+        layout->addSpacing(Ori::Gui::borderWidth() + Z::Gui::unitsSelectorWidth());
+
+        qApp->connect(editor, qOverload<double>(&QDoubleSpinBox::valueChanged), flag, [cb = flag]{ cb->setChecked(true); });
+    }
+
+    static void setTolerance(QCheckBox* flag, QDoubleSpinBox* editor, double tolerance)
+    {
+        if (tolerance > 0)
+            editor->setValue(tolerance * 100);
+        flag->setChecked(tolerance > 0);
+    }
+
+    static double tolerance(QCheckBox* flag, QDoubleSpinBox* editor)
+    {
+        return flag->isChecked() ? editor->value() / 100.0 : 0;
+    }
+};
+
 //------------------------------------------------------------------------------
 //                             GeneralRangeEditor
 //------------------------------------------------------------------------------
 
-GeneralRangeEditor::GeneralRangeEditor() : QGridLayout()
+GeneralRangeEditor::GeneralRangeEditor(bool withTolerance) : QGridLayout()
 {
     edStart = new ValueEditor;
     edStop = new ValueEditor;
@@ -89,6 +143,15 @@ GeneralRangeEditor::GeneralRangeEditor() : QGridLayout()
     addLayout(points.layout, 3, 1);
     addWidget(rbStep, 2, 0);
     addWidget(rbPoints, 3, 0);
+
+    if (withTolerance)
+    {
+        ToleranceEditor tolerance;
+        seTolerance = tolerance.editor;
+        cbTolerance = tolerance.flag;
+        addLayout(tolerance.layout, 4, 1);
+        addWidget(cbTolerance, 4, 0);
+    }
 }
 
 void GeneralRangeEditor::setRange(const Z::VariableRange& var)
@@ -101,6 +164,8 @@ void GeneralRangeEditor::setRange(const Z::VariableRange& var)
         rbStep->setChecked(true);
     else
         rbPoints->setChecked(true);
+    if (cbTolerance)
+        ToleranceEditor::setTolerance(cbTolerance, seTolerance, var.tolerance);
 }
 
 Z::VariableRange GeneralRangeEditor::range()
@@ -111,6 +176,8 @@ Z::VariableRange GeneralRangeEditor::range()
     range.step = edStep->value();
     range.points = sePoints->value();
     range.useStep = rbStep->isChecked();
+    if (cbTolerance)
+        range.tolerance = ToleranceEditor::tolerance(cbTolerance, seTolerance);
     return range;
 }
 
@@ -144,9 +211,14 @@ PointsRangeEditor::PointsRangeEditor() : QGridLayout()
     sePoints = points.editor;
     rbPoints = points.flag;
 
+    ToleranceEditor tolerance;
+    seTolerance = tolerance.editor;
+    cbTolerance = tolerance.flag;
+
     const int row0 = 0;
     const int row1 = 1;
     const int row2 = 2;
+    const int row3 = 3;
     const int col0 = 0;
     const int col1 = 1;
 
@@ -161,6 +233,8 @@ PointsRangeEditor::PointsRangeEditor() : QGridLayout()
     addLayout(points.layout, row2, col1);
     addWidget(rbStep, row1, col0);
     addWidget(rbPoints, row2, col0);
+    addLayout(tolerance.layout, row3, col1);
+    addWidget(cbTolerance, row3, col0);
 }
 
 void PointsRangeEditor::setRange(const Z::VariableRange& var)
@@ -176,6 +250,7 @@ void PointsRangeEditor::setRange(const Z::VariableRange& var)
         rbStep->setChecked(true);
     else
         rbPoints->setChecked(true);
+    ToleranceEditor::setTolerance(cbTolerance, seTolerance, var.tolerance);
 }
 
 Z::VariableRange PointsRangeEditor::range()
@@ -186,6 +261,7 @@ Z::VariableRange PointsRangeEditor::range()
     range.step = edStep->value();
     range.points = sePoints->value();
     range.useStep = rbStep->isChecked();
+    range.tolerance = ToleranceEditor::tolerance(cbTolerance, seTolerance);
     return range;
 }
 
@@ -8,6 +8,8 @@
 #include "WidgetResult.h"
 
 QT_BEGIN_NAMESPACE
+class QCheckBox;
+class QDoubleSpinBox;
 class QLabel;
 class QRadioButton;
 class QSpinBox;
@@ -26,13 +28,14 @@ namespace Widgets {
 /**
     The full variable range editor that allows to assign
      starting and ending value of the range and the number of points.
+    Tolerance of adaptive refinement is only shown for functions supporting it.
 */
 class GeneralRangeEditor : public QGridLayout
 {
     Q_OBJECT
 
 public:
-    GeneralRangeEditor();
+    explicit GeneralRangeEditor(bool withTolerance = false);
 
     Z::VariableRange range();
     void setRange(const Z::VariableRange& var);
@@ -43,6 +46,8 @@ private:
     QSpinBox *sePoints;
     QRadioButton *rbStep, *rbPoints;
     ValueEditor *edStart, *edStop, *edStep;
+    QCheckBox *cbTolerance = nullptr;
+    QDoubleSpinBox *seTolerance = nullptr;
 };
 
 /**
@@ -67,6 +72,8 @@ private:
     QRadioButton *rbStep, *rbPoints;
     ValueEditor *edStep;
     QLabel *_stopValueLabel;
+    QCheckBox *cbTolerance;
+    QDoubleSpinBox *seTolerance;
 };
 
 #endif // VARIABLE_RANGE_EDITOR_H
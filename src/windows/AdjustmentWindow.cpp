@@ -337,6 +337,8 @@ void AdjusterWidget::changeValue()
     auto res = _param->verify(_currentValue);
     if (res.isEmpty())
     {
+        // Steps made by wheel or keys during the same event loop turn are delivered as a single change
+        SchemaEventsBatch batch(_schema, Arg::DeferEvents(true));
         _isValueChanging = true;
         _param->setValue(_currentValue);
         _isValueChanging = false;
@@ -112,8 +112,16 @@ QWidget* AppSettingsDialog::createGeneralPage2()
         tr("Automatically check for updates"),
         _updateCheckInterval,
     }).makeGroupBox(tr("Updates"));
+
+    _pythonTimeout = new QSpinBox;
+    _pythonTimeout->setRange(0, 24*3600);
+    _pythonTimeout->setSpecialValueText(tr("None"));
+    _pythonTimeout->setSuffix(tr(" s"));
+    auto groupPython = LayoutV({
+        LayoutH({new QLabel(tr("Interrupt custom code running longer than")), _pythonTimeout, Stretch()}),
+    }).makeGroupBox(tr("Custom functions"));
     
-    page->add({groupUpdates, page->stretch()});
+    page->add({groupUpdates, groupPython, page->stretch()});
     return page;
 }
 
@@ -266,6 +274,7 @@ void AppSettingsDialog::populate()
     _groupOptions->setOption("useOnlineHelp", settings.useOnlineHelp);
     
     Ori::Gui::setSelectedId(_updateCheckInterval, (int)settings.updateCheckInterval);
+    _pythonTimeout->setValue(settings.pythonTimeoutSec);
 
     // view
     _groupView->setOption("smallToolbarImages", settings.smallToolbarImages);
@@ -317,6 +326,7 @@ bool AppSettingsDialog::collect()
     
     settings.updateCheckInterval = (UpdateCheckInterval)Ori::Gui::getSelectedId(
         _updateCheckInterval, (int)UpdateCheckInterval::Weekly);
+    settings.pythonTimeoutSec = _pythonTimeout->value();
 
     // view
     settings.smallToolbarImages = _groupView->option("smallToolbarImages");
@@ -48,6 +48,7 @@ private:
     QCheckBox *_showImagUnitAsJ, *_showImagUnitAtEnd;
     QCPL::PenEditorWidget *_elemBoundMarkersPen, *_stabBoundMarkerPen, *_cursorPen, *_graphPenT, *_graphPenS;
     QComboBox *_updateCheckInterval;
+    QSpinBox *_pythonTimeout;
 
     QWidget* createGeneralPage();
     QWidget* createGeneralPage2();
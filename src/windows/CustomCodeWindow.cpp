@@ -1,6 +1,7 @@
 #include "CustomCodeWindow.h"
 
 #include "../core/PyRunner.h"
+#include "../funcs/FuncWindowHelpers.h"
 #include "../math/CustomFuncUtils.h"
 
 #include "helpers/OriDialogs.h"
@@ -75,8 +76,16 @@ void CustomCodeWindow::runCode()
     py.funcNamesOptional = { CustomFuncUtils::funcNameMeta() };
     py.moduleName = _moduleName;
     py.printFunc = [this](const QString& s){ logInfo(s); };
+
+    bool loaded = false, done = false;
+    auto calc = [&py, &loaded, &done]{
+        loaded = py.load();
+        done = loaded && py.run(FUNC_CALC, {}, {});
+    };
+    if (!FuncWindowHelpers::runCustomCode(this, schema(), calc))
+        return;
     
-    if (!py.load()) {
+    if (!loaded) {
         logError(py.errorLog, py.errorLine);
         return;
     }
@@ -85,7 +94,7 @@ void CustomCodeWindow::runCode()
         _customTitle = py.codeTitle;
         updateWindowTitle();
     }
-    if (!py.run(FUNC_CALC, {}, {})) {
+    if (!done) {
         logError(py.errorLog, py.errorLine);
         return;
     }
@@ -197,6 +197,11 @@ void ElementPropsDialog::collect()
     
     auto schema = dynamic_cast<Schema*>(_element->owner()); 
 
+    // Params are changed one by one, each of them can raise events
+    std::optional<SchemaEventsBatch> batch;
+    if (schema)
+        batch.emplace(schema);
+
     _element->setLabel(_editorLabel->text());
     _element->setTitle(_editorTitle->text());
     _element->setDisabled(_elemDisabled->isChecked());
@@ -6,6 +6,7 @@
 #include "../app/ProjectOperations.h"
 #include "../app/PersistentState.h"
 #include "../core/Format.h"
+#include "../core/Perf.h"
 #include "../math/RoundTripCalculator.h"
 #include "../tools/CalculatorWindow.h"
 #include "../tools/GaussCalculatorWindow.h"
@@ -39,6 +40,7 @@
 #include <QClipboard>
 #include <QCloseEvent>
 #include <QDir>
+#include <QFileDialog>
 #include <QFormLayout>
 #include <QLabel>
 #include <QMenu>
@@ -258,7 +260,14 @@ void ProjectWindow::createMenuBar()
           //actnToolIris
         });
     if (AppSettings::instance().isDevMode)
+    {
         menuTools->addAction(QIcon(":/toolbar/palette"), tr("Edit App Style Sheet"), this, []{ Z::Gui::editAppStyleSheet(); });
+        menuTools->addSeparator();
+        auto actnProfiling = menuTools->addAction("Enable Profiling", this, &ProjectWindow::devToggleProfiling);
+        actnProfiling->setCheckable(true);
+        actnProfiling->setChecked(Z::Perf::isEnabled());
+        menuTools->addAction("Save Profiling Trace...", this, &ProjectWindow::devSaveProfilingTrace);
+    }
 
     menuWindow = Ori::Gui::menu(tr("Window"), this,
         { actnWndSchema, actnWndParams, actnWndPumps, actnWndProtocol, actnWndMemos, nullptr,
@@ -757,3 +766,27 @@ void ProjectWindow::devCopyImgMdiChild()
     if (!child) return;
     qApp->clipboard()->setPixmap(child->grab());
 }
+
+void ProjectWindow::devToggleProfiling(bool on)
+{
+    if (on) Z::Perf::clearTrace();
+    Z::Perf::setEnabled(on);
+}
+
+void ProjectWindow::devSaveProfilingTrace()
+{
+    if (Z::Perf::traceSize() == 0)
+    {
+        Ori::Dlg::info("There are no recorded events, enable profiling and repeat the calculation");
+        return;
+    }
+    QString recentPath = RecentData::getDir("profiling_trace_path");
+    auto fileName = QFileDialog::getSaveFileName(
+        this, "Save Profiling Trace", recentPath, "Chrome trace files (*.json)\nAll files (*.*)");
+    if (fileName.isEmpty())
+        return;
+    RecentData::setDir("profiling_trace_path", fileName);
+    QString err = Z::Perf::saveTrace(fileName);
+    if (!err.isEmpty())
+        Ori::Dlg::error(err);
+}
@@ -158,6 +158,8 @@ private slots:
     void devMaximizeMdiChild();
     void devCopyImgMdiChild();
     void devShowMdiChildSize();
+    void devToggleProfiling(bool on);
+    void devSaveProfilingTrace();
 
     void addEditAction(QAction* action, IEditableWindow* wnd, IEditableWindow::SupportedCommand cmd);
 };
@@ -163,10 +163,13 @@ void SchemaParamsWindow::setParameterValue()
                 })
                 .withContentToButtonsSpacingFactor(2)
                 .withOnDlgShown([&editor]{ editor.focus(); })
-                .connectOkToContentApply()
                 .exec();
     if (ok)
     {
+        // Value of the param can be propagated to many elements via links and formulas,
+        // let listeners get a single change set
+        SchemaEventsBatch batch(schema());
+        editor.apply();
         schema()->events().raise(SchemaEvents::RecalRequred, "Params window: param value set");
     }
 
@@ -217,6 +220,7 @@ void SchemaParamsWindow::editParameter()
         edited = true;
         changed = true;
     }
+    SchemaEventsBatch batch(schema());
     if (edited)
         schema()->events().raise(SchemaEvents::GlobalParamEdited, param, "Params window: param edited");
     if (changed) {
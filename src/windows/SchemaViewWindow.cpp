@@ -126,6 +126,7 @@ void SchemaViewWindow::editElement(Element* elem)
     bool wasDisabled = elem->disabled();
     if (ElementPropsDialog::editElement(elem))
     {
+        SchemaEventsBatch batch(schema());
         if (wasDisabled != elem->disabled())
             schema()->relinkInterfaces();
 